@@ -0,0 +1,466 @@
+// Workstation benchmarks for the firmware's portable modules (pio run -e native).
+//
+//   .pio/build/native/program parse            JSON status parse cost and heap traffic
+//   .pio/build/native/program command          SDCP command frame encode cost
+//   .pio/build/native/program detect           movement detection delay and loop cost
+//   .pio/build/native/program settings         settings save/load round trip
+//   .pio/build/native/program metrics          /metrics render cost
+//   .pio/build/native/program profile          loop profiler overhead, disabled and enabled
+//   .pio/build/native/program live <ip> [s] [stall-ms] [adaptive]
+//                                              run against a printer (or the SDCP simulator),
+//                                              stop the filament and measure pause latency;
+//                                              stall-ms adds random stalls to every loop(),
+//                                              adaptive learns the movement timeout
+//   .pio/build/native/program split <ip> [s] [stall-ms] [adaptive]
+//                                              same, with detection on the sensor thread
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <time.h>
+
+#include "Logger.h"
+#include "LoopProfiler.h"
+#include "Metrics.h"
+#include "NativeHal.h"
+#include "PrinterManager.h"
+#include "SdcpCommand.h"
+#include "SdcpParser.h"
+#include "SettingsManager.h"
+
+#define BENCH_ITERATIONS 20000
+#define BENCH_EDGE_INTERVAL_US 40000  // 72 mm/s of filament with a 2.88 mm/pulse sensor
+
+// Provided by main.cpp on the device
+unsigned long getTime()
+{
+    return (unsigned long) time(nullptr);
+}
+
+static const char *sampleStatus =
+    "{\"Status\":{\"CurrentStatus\":[1],\"TimeLapseStatus\":0,\"PlatFormType\":0,"
+    "\"TempOfHotbed\":60.02,\"TempOfNozzle\":220.15,\"TempOfBox\":31.4,\"TempTargetHotbed\":60,"
+    "\"TempTargetNozzle\":220,\"TempTargetBox\":0,\"CurrenCoord\":\"152.34,98.10,12.40\","
+    "\"CurrentFanSpeed\":{\"ModelFan\":100,\"ModeFan\":100,\"AuxiliaryFan\":0,\"BoxFan\":0},"
+    "\"ZOffset\":0.0,\"LightStatus\":{\"SecondLight\":1},\"PrintInfo\":{\"Status\":13,"
+    "\"CurrentLayer\":62,\"TotalLayer\":250,\"CurrentTicks\":1834,\"TotalTicks\":7420,"
+    "\"Filename\":\"benchy_pla_0.2mm.gcode\",\"ErrorNumber\":0,\"TaskId\":"
+    "\"0a6c1e3e-7d4c-4b3c-9a3f-6c1b2a9e4f10\",\"PrintSpeedPct\":100,\"Progress\":24}},"
+    "\"MainboardID\":\"4c1f0b2a0e6c000000000000\",\"TimeStamp\":1728000000,"
+    "\"Topic\":\"sdcp/status/4c1f0b2a0e6c000000000000\"}";
+
+static void printAllocDelta(const char *label, const hal_alloc_stats_t &before,
+                            const hal_alloc_stats_t &after, int iterations)
+{
+    printf("%-28s %8.2f allocs/iter   peak %zu bytes\n", label,
+           (double) (after.allocations - before.allocations) / iterations,
+           after.peakBytes - before.liveBytes);
+}
+
+static void benchParse()
+{
+    size_t length = strlen(sampleStatus);
+    int    layer  = 0;
+
+    hal_alloc_reset_peak();
+    hal_alloc_stats_t before = hal_alloc_stats();
+    uint64_t          start  = hal_host_nanos();
+    for (int i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        StaticJsonDocument<2048> doc;
+        DeserializationError     error = deserializeJson(doc, sampleStatus, length);
+        if (!error)
+        {
+            layer += doc["Status"]["PrintInfo"]["CurrentLayer"].as<int>();
+            String coords = doc["Status"]["CurrenCoord"].as<String>();
+            layer += (int) coords.substring(coords.lastIndexOf(',') + 1).toFloat();
+        }
+    }
+    uint64_t          elapsed = hal_host_nanos() - start;
+    hal_alloc_stats_t after   = hal_alloc_stats();
+
+    printf("status payload               %zu bytes\n", length);
+    printf("%-28s %8.0f ns/iter\n", "deserializeJson + fields", (double) elapsed / BENCH_ITERATIONS);
+    printAllocDelta("deserializeJson + fields", before, after, BENCH_ITERATIONS);
+
+    // The streaming parser ElegooCC uses
+    int streamed = 0;
+    hal_alloc_reset_peak();
+    before = hal_alloc_stats();
+    start  = hal_host_nanos();
+    for (int i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        sdcp_message_t message;
+        if (parseSdcpMessage(sampleStatus, length, message))
+        {
+            streamed += message.currentLayer + (int) message.currentZ;
+        }
+    }
+    elapsed = hal_host_nanos() - start;
+    after   = hal_alloc_stats();
+
+    printf("%-28s %8.0f ns/iter\n", "parseSdcpMessage", (double) elapsed / BENCH_ITERATIONS);
+    printAllocDelta("parseSdcpMessage", before, after, BENCH_ITERATIONS);
+
+    // What a repeated status costs instead
+    uint32_t hash = 0;
+    start         = hal_host_nanos();
+    for (int i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        hash += hashSdcpPayload(sampleStatus, length) + isSdcpStatusPush(sampleStatus, length);
+    }
+    elapsed = hal_host_nanos() - start;
+    printf("%-28s %8.0f ns/iter\n", "hash + status push check", (double) elapsed / BENCH_ITERATIONS);
+
+    // Only the timestamp differs, the hash has to match
+    String later = sampleStatus;
+    later.replace("1728000000", "1728000042");
+    if (hashSdcpPayload(later.c_str(), later.length()) != hashSdcpPayload(sampleStatus, length))
+    {
+        printf("hash covers TimeStamp\n");
+    }
+    later.replace("\"CurrentTicks\":1834", "\"CurrentTicks\":1835");
+    if (hashSdcpPayload(later.c_str(), later.length()) == hashSdcpPayload(sampleStatus, length))
+    {
+        printf("hash misses CurrentTicks\n");
+    }
+    if (!isSdcpStatusPush(sampleStatus, length))
+    {
+        printf("status push not recognized\n");
+    }
+    if (layer == 0 || streamed != layer)
+    {
+        printf("parse failed\n");
+    }
+}
+
+static void benchCommand()
+{
+    SdcpCommandEncoder encoder;
+    encoder.setMainboardID("4c1f0b2a0e6c000000000000");
+
+    hal_alloc_reset_peak();
+    hal_alloc_stats_t before = hal_alloc_stats();
+    uint64_t          start  = hal_host_nanos();
+    for (int i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        encoder.encode(i % 8 ? SDCP_COMMAND_PAUSE_PRINT : SDCP_COMMAND_STATUS, getTime());
+    }
+    uint64_t          elapsed = hal_host_nanos() - start;
+    hal_alloc_stats_t after   = hal_alloc_stats();
+
+    printf("%-28s %8.0f ns/iter\n", "encode command", (double) elapsed / BENCH_ITERATIONS);
+    printAllocDelta("encode command", before, after, BENCH_ITERATIONS);
+    printf("%s\n", encoder.frame());
+}
+
+static void benchDetect()
+{
+    hal_clock_use_virtual(true);
+    settingsManager.load();
+    printerManager.beginSensors();
+    ElegooCC &printer = printerManager.get(0);
+
+    // Filament moving: toggle the movement pin at a steady rate while looping every millisecond
+    int level = HIGH;
+    for (uint64_t t = 0; t < 10ULL * 1000 * 1000; t += 1000)
+    {
+        if (t % BENCH_EDGE_INTERVAL_US == 0)
+        {
+            level = !level;
+            hal_gpio_set(MOVEMENT_SENSOR_PIN, level);
+        }
+        printerManager.loop();
+        hal_clock_advance_us(1000);
+    }
+
+    // Filament stops: loop until detection flips, measuring cost per iteration
+    hal_alloc_reset_peak();
+    hal_alloc_stats_t before     = hal_alloc_stats();
+    uint64_t          stoppedAt  = hal_clock_now_us();
+    uint64_t          hostStart  = hal_host_nanos();
+    int               iterations = 0;
+    while (!printer.getCurrentInformation().filamentStopped && iterations < 60000)
+    {
+        printerManager.loop();
+        hal_clock_advance_us(1000);
+        iterations++;
+    }
+    uint64_t          hostElapsed = hal_host_nanos() - hostStart;
+    hal_alloc_stats_t after       = hal_alloc_stats();
+
+    printf("%-28s %8.1f ms (timeout %d ms)\n", "stop -> filamentStopped",
+           (hal_clock_now_us() - stoppedAt) / 1000.0, settingsManager.getFirstLayerTimeout());
+    printf("%-28s %8.0f ns/iter\n", "PrinterManager::loop",
+           (double) hostElapsed / (iterations ? iterations : 1));
+    printAllocDelta("PrinterManager::loop", before, after, iterations ? iterations : 1);
+    hal_clock_use_virtual(false);
+}
+
+static void benchSettings()
+{
+    settingsManager.load();
+
+    hal_alloc_reset_peak();
+    hal_alloc_stats_t before = hal_alloc_stats();
+    uint64_t          start  = hal_host_nanos();
+    const int         rounds = 200;
+    for (int i = 0; i < rounds; i++)
+    {
+        settingsManager.setTimeout(4000 + i);
+        settingsManager.save(true);
+        settingsManager.flush();
+        settingsManager.load();
+    }
+    uint64_t          elapsed = hal_host_nanos() - start;
+    hal_alloc_stats_t after   = hal_alloc_stats();
+
+    printf("%-28s %8.0f us/iter\n", "settings save + load", elapsed / 1000.0 / rounds);
+    printAllocDelta("settings save + load", before, after, rounds);
+    printf("filesystem root              %s\n", hal_fs_root());
+}
+
+static void benchMetrics()
+{
+    // Pulled in chunks the size of a TCP segment, the way the chunked response asks for it
+    static MetricsStreamState state;
+    static uint8_t            chunk[1436];
+    size_t                    length = 0;
+
+    hal_alloc_reset_peak();
+    hal_alloc_stats_t before = hal_alloc_stats();
+    uint64_t          start  = hal_host_nanos();
+    const int         rounds = 2000;
+    for (int i = 0; i < rounds; i++)
+    {
+        metrics.beginMetricsStream(state);
+        length = 0;
+        size_t size;
+        while ((size = metrics.streamMetrics(state, chunk, sizeof(chunk))) > 0)
+        {
+            length += size;
+        }
+    }
+    uint64_t          elapsed = hal_host_nanos() - start;
+    hal_alloc_stats_t after   = hal_alloc_stats();
+
+    printf("%-28s %8.0f ns/iter (%u bytes, %u byte state)\n", "Metrics stream",
+           (double) elapsed / rounds, (unsigned) length, (unsigned) sizeof(state));
+    printAllocDelta("Metrics stream", before, after, rounds);
+}
+
+// One iteration instrumented the way main.cpp's loop() is
+static void profiledIteration()
+{
+    loopProfiler.beginIteration();
+    for (int stage = 0; stage < LOOP_STAGE_TOTAL; stage++)
+    {
+        loopProfiler.lap((loop_stage_t) stage);
+    }
+    loopProfiler.endIteration();
+}
+
+static void benchProfile()
+{
+    const int rounds = 200000;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        bool enable = pass == 1;
+        loopProfiler.setEnabled(enable);
+
+        hal_alloc_reset_peak();
+        hal_alloc_stats_t before = hal_alloc_stats();
+        uint64_t          start  = hal_host_nanos();
+        for (int i = 0; i < rounds; i++)
+        {
+            profiledIteration();
+        }
+        uint64_t          elapsed = hal_host_nanos() - start;
+        hal_alloc_stats_t after   = hal_alloc_stats();
+
+        const char *label = enable ? "loop profiler enabled" : "loop profiler disabled";
+        printf("%-28s %8.1f ns/iter\n", label, (double) elapsed / rounds);
+        printAllocDelta(label, before, after, rounds);
+    }
+
+    DynamicJsonDocument profile(LOOP_PROFILE_JSON_SIZE);
+    loopProfiler.toJson(profile);
+    printf("%-28s %8lu iterations, total p99 %lu us, max %lu us\n", "loop profile",
+           profile["iterations"].as<unsigned long>(),
+           profile["stages"]["total"]["p99_us"].as<unsigned long>(),
+           profile["stages"]["total"]["max_us"].as<unsigned long>());
+    loopProfiler.setEnabled(false);
+}
+
+// Stands in for a slow web request or NTP sync holding up the main loop
+static void stallLoop(int stallMs)
+{
+    if (stallMs > 0)
+    {
+        delay(random(stallMs + 1));
+    }
+}
+
+static void benchLive(const char *ip, int seconds, int stallMs, bool useSensorTask, bool adaptive)
+{
+    settingsManager.load();
+    settingsManager.setElegooIP(ip);
+    settingsManager.setStartPrintTimeout(1000);
+    settingsManager.setAdaptiveTimeout(adaptive);
+    printerManager.beginSensors();
+    if (useSensorTask)
+    {
+        printerManager.startSensorTask();
+    }
+    printerManager.setup();
+    ElegooCC &printer = printerManager.get(0);
+
+    // Feed filament until the printer reports printing and the start window has passed
+    int           level     = HIGH;
+    unsigned long lastEdge  = 0;
+    unsigned long feedUntil = millis() + (unsigned long) seconds * 1000;
+    while (millis() < feedUntil)
+    {
+        if (micros() - lastEdge >= BENCH_EDGE_INTERVAL_US)
+        {
+            lastEdge = micros();
+            level    = !level;
+            hal_gpio_set(MOVEMENT_SENSOR_PIN, level);
+        }
+        printerManager.loop();
+        stallLoop(stallMs);
+    }
+
+    printer_info_t info = printer.getCurrentInformation();
+    if (!info.isWebsocketConnected || !info.isPrinting)
+    {
+        printf("printer at %s is not connected and printing, aborting\n", ip);
+        printerManager.stopSensorTask();
+        return;
+    }
+    printf("%-28s %8.1f mm/s\n", "feed rate while feeding", info.feedRate);
+
+    // Stop the filament and wait for the printer to report the pause
+    uint64_t stoppedAt  = hal_host_nanos();
+    uint64_t detectedAt = 0;
+    while (hal_host_nanos() - stoppedAt < 60ULL * 1000 * 1000 * 1000)
+    {
+        printerManager.loop();
+        stallLoop(stallMs);
+        info = printer.getCurrentInformation();
+        if (!detectedAt && info.filamentStopped)
+        {
+            detectedAt = hal_host_nanos();
+        }
+        if (info.printStatus == SDCP_PRINT_STATUS_PAUSING ||
+            info.printStatus == SDCP_PRINT_STATUS_PAUSED)
+        {
+            uint64_t pausedAt = hal_host_nanos();
+            printf("%-28s %8.1f ms\n", "stop -> filamentStopped", (detectedAt - stoppedAt) / 1e6);
+            printf("%-28s %8.1f ms\n", "filamentStopped -> paused", (pausedAt - detectedAt) / 1e6);
+            printf("%-28s %8d ms\n", "movement timeout", info.movementTimeout);
+
+            // Let the PAUSED status arrive so every stage has been recorded
+            while (info.printStatus != SDCP_PRINT_STATUS_PAUSED &&
+                   hal_host_nanos() - pausedAt < 10ULL * 1000 * 1000 * 1000)
+            {
+                printerManager.loop();
+                info = printer.getCurrentInformation();
+            }
+            DynamicJsonDocument latency(PAUSE_LATENCY_JSON_SIZE);
+            printer.getPauseLatency().toJson(latency);
+            for (JsonVariant stage : latency["stages"].as<JsonArray>())
+            {
+                const char *name = stage.as<const char *>();
+                printf("stage %-22s %8.1f ms\n", name, latency["last_us"][name].as<long>() / 1e3);
+            }
+            printerManager.stopSensorTask();
+            return;
+        }
+    }
+    printf("printer never reported a pause\n");
+    printerManager.stopSensorTask();
+}
+
+// Time until the printer is connected again after its address changed: the settings point at
+// staleIp and discovery has to find mainboardId elsewhere. Without them the printer has no address
+// yet and has to be found at all.
+static void benchRediscover(const char *staleIp, const char *mainboardId)
+{
+    settingsManager.load();
+    settingsManager.setElegooIP(staleIp);
+    settingsManager.setMainboardID(mainboardId);
+    printerManager.beginSensors();
+    printerManager.setup();
+    ElegooCC &printer = printerManager.get(0);
+
+    unsigned long start = millis();
+    while (millis() - start < 60000)
+    {
+        printerManager.loop();
+        delay(1);
+        if (printer.getCurrentInformation().isWebsocketConnected)
+        {
+            printf("%-28s %8lu ms\n", "connected again", millis() - start);
+            printf("%-28s %s\n", "printer address", settingsManager.getElegooIP().c_str());
+            return;
+        }
+    }
+    printf("printer was not found again\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *mode = argc > 1 ? argv[1] : "all";
+
+    // The runout switches read HIGH while filament is present, PrinterManager::beginSensors()
+    // sets up the pull-ups the same way main.cpp does
+    LittleFS.begin();
+
+    bool split = strcmp(mode, "split") == 0;
+    if (split || strcmp(mode, "live") == 0)
+    {
+        if (argc < 3)
+        {
+            printf("usage: %s %s <printer-ip> [feed-seconds] [stall-ms] [adaptive]\n", argv[0],
+                   mode);
+            return 1;
+        }
+        benchLive(argv[2], argc > 3 ? atoi(argv[3]) : 15, argc > 4 ? atoi(argv[4]) : 0, split,
+                  argc > 5 && strcmp(argv[5], "adaptive") == 0);
+        return 0;
+    }
+
+    if (strcmp(mode, "rediscover") == 0)
+    {
+        benchRediscover(argc > 3 ? argv[2] : "", argc > 3 ? argv[3] : "");
+        return 0;
+    }
+
+    bool all = strcmp(mode, "all") == 0;
+    if (all || strcmp(mode, "parse") == 0)
+    {
+        benchParse();
+    }
+    if (all || strcmp(mode, "command") == 0)
+    {
+        benchCommand();
+    }
+    if (all || strcmp(mode, "settings") == 0)
+    {
+        benchSettings();
+    }
+    if (all || strcmp(mode, "detect") == 0)
+    {
+        benchDetect();
+    }
+    if (all || strcmp(mode, "metrics") == 0)
+    {
+        benchMetrics();
+    }
+    if (all || strcmp(mode, "profile") == 0)
+    {
+        benchProfile();
+    }
+    return 0;
+}
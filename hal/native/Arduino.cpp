@@ -0,0 +1,558 @@
+#include "Arduino.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "NativeHal.h"
+
+HardwareSerial Serial;
+EspClass       ESP;
+
+// Clock
+
+static std::atomic<bool>     useVirtualClock(false);
+static std::atomic<uint64_t> virtualMicros(0);
+
+static uint64_t realMicros()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                 start)
+        .count();
+}
+
+uint64_t hal_host_nanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void hal_clock_use_virtual(bool enable)
+{
+    virtualMicros = realMicros();
+    useVirtualClock = enable;
+}
+
+void hal_clock_advance_us(uint64_t us)
+{
+    virtualMicros += us;
+}
+
+uint64_t hal_clock_now_us()
+{
+    return useVirtualClock ? virtualMicros.load() : realMicros();
+}
+
+unsigned long millis()
+{
+    return (unsigned long) (hal_clock_now_us() / 1000);
+}
+
+unsigned long micros()
+{
+    // micros() is 32 bits wide on the ESP32, keep the same wrap-around behaviour
+    return (unsigned long) (uint32_t) hal_clock_now_us();
+}
+
+int64_t esp_timer_get_time()
+{
+    return (int64_t) hal_clock_now_us();
+}
+
+void delay(unsigned long ms)
+{
+    if (useVirtualClock)
+    {
+        hal_clock_advance_us((uint64_t) ms * 1000);
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    if (useVirtualClock)
+    {
+        hal_clock_advance_us(us);
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield()
+{
+    std::this_thread::yield();
+}
+
+long random(long max)
+{
+    return max > 0 ? rand() % max : 0;
+}
+
+long random(long min, long max)
+{
+    return min >= max ? min : min + random(max - min);
+}
+
+// GPIO
+
+#define NATIVE_GPIO_COUNT 64
+
+typedef struct
+{
+    int  level;
+    int  mode;
+    int  interruptMode;
+    void (*handler)(void);
+    void (*handlerArg)(void *);
+    void *arg;
+} native_gpio_t;
+
+static native_gpio_t gpio[NATIVE_GPIO_COUNT];
+static std::mutex    gpioMutex;
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (pin >= NATIVE_GPIO_COUNT)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    gpio[pin].mode = mode;
+    if (mode == INPUT_PULLUP)
+    {
+        gpio[pin].level = HIGH;
+    }
+}
+
+int digitalRead(uint8_t pin)
+{
+    return pin < NATIVE_GPIO_COUNT ? gpio[pin].level : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+    hal_gpio_set(pin, val);
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode)
+{
+    if (pin >= NATIVE_GPIO_COUNT)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    gpio[pin].handler       = handler;
+    gpio[pin].handlerArg    = nullptr;
+    gpio[pin].arg           = nullptr;
+    gpio[pin].interruptMode = mode;
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode)
+{
+    if (pin >= NATIVE_GPIO_COUNT)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    gpio[pin].handler       = nullptr;
+    gpio[pin].handlerArg    = handler;
+    gpio[pin].arg           = arg;
+    gpio[pin].interruptMode = mode;
+}
+
+void detachInterrupt(uint8_t pin)
+{
+    if (pin >= NATIVE_GPIO_COUNT)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    gpio[pin].handler       = nullptr;
+    gpio[pin].handlerArg    = nullptr;
+    gpio[pin].interruptMode = 0;
+}
+
+void hal_gpio_set(uint8_t pin, int level)
+{
+    if (pin >= NATIVE_GPIO_COUNT)
+    {
+        return;
+    }
+    // Interrupts are serialised like on a single interrupt controller
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    native_gpio_t              &p    = gpio[pin];
+    int                         prev = p.level;
+    p.level                          = level ? HIGH : LOW;
+    if (prev == p.level)
+    {
+        return;
+    }
+
+    bool fire = p.interruptMode == CHANGE || (p.interruptMode == RISING && p.level == HIGH) ||
+                (p.interruptMode == FALLING && p.level == LOW);
+    if (!fire)
+    {
+        return;
+    }
+    if (p.handlerArg)
+    {
+        p.handlerArg(p.arg);
+    }
+    else if (p.handler)
+    {
+        p.handler();
+    }
+}
+
+// String
+
+String::String(int value, unsigned char base) : String((long) value, base) {}
+
+String::String(unsigned int value, unsigned char base) : String((unsigned long) value, base) {}
+
+String::String(long value, unsigned char base)
+{
+    if (value < 0 && base == 10)
+    {
+        buffer = "-" + String((unsigned long) -value, base).buffer;
+        return;
+    }
+    *this = String((unsigned long) value, base);
+}
+
+String::String(unsigned long value, unsigned char base)
+{
+    char  tmp[33];
+    char *p = tmp + sizeof(tmp) - 1;
+    *p      = '\0';
+    if (base < 2)
+    {
+        base = 10;
+    }
+    do
+    {
+        unsigned long digit = value % base;
+        *--p                = (char) (digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value);
+    buffer = p;
+}
+
+String::String(float value, unsigned char decimalPlaces) : String((double) value, decimalPlaces)
+{
+}
+
+String::String(double value, unsigned char decimalPlaces)
+{
+    char tmp[64];
+    snprintf(tmp, sizeof(tmp), "%.*f", decimalPlaces, value);
+    buffer = tmp;
+}
+
+bool String::startsWith(const String &prefix) const
+{
+    return buffer.compare(0, prefix.buffer.length(), prefix.buffer) == 0;
+}
+
+bool String::endsWith(const String &suffix) const
+{
+    return buffer.length() >= suffix.buffer.length() &&
+           buffer.compare(buffer.length() - suffix.buffer.length(), suffix.buffer.length(),
+                          suffix.buffer) == 0;
+}
+
+int String::indexOf(char c, unsigned int fromIndex) const
+{
+    size_t pos = buffer.find(c, fromIndex);
+    return pos == std::string::npos ? -1 : (int) pos;
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const
+{
+    size_t pos = buffer.find(str.buffer, fromIndex);
+    return pos == std::string::npos ? -1 : (int) pos;
+}
+
+int String::lastIndexOf(char c) const
+{
+    size_t pos = buffer.rfind(c);
+    return pos == std::string::npos ? -1 : (int) pos;
+}
+
+String String::substring(unsigned int beginIndex) const
+{
+    return substring(beginIndex, buffer.length());
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const
+{
+    if (beginIndex > endIndex)
+    {
+        std::swap(beginIndex, endIndex);
+    }
+    if (beginIndex >= buffer.length())
+    {
+        return String();
+    }
+    return String(buffer.substr(beginIndex, endIndex - beginIndex));
+}
+
+void String::replace(const String &find, const String &replace)
+{
+    if (find.buffer.empty())
+    {
+        return;
+    }
+    size_t pos = 0;
+    while ((pos = buffer.find(find.buffer, pos)) != std::string::npos)
+    {
+        buffer.replace(pos, find.buffer.length(), replace.buffer);
+        pos += replace.buffer.length();
+    }
+}
+
+void String::trim()
+{
+    size_t begin = buffer.find_first_not_of(" \t\r\n");
+    size_t end   = buffer.find_last_not_of(" \t\r\n");
+    buffer       = begin == std::string::npos ? "" : buffer.substr(begin, end - begin + 1);
+}
+
+void String::toLowerCase()
+{
+    for (char &c : buffer)
+    {
+        c = (char) tolower((unsigned char) c);
+    }
+}
+
+void String::toUpperCase()
+{
+    for (char &c : buffer)
+    {
+        c = (char) toupper((unsigned char) c);
+    }
+}
+
+long String::toInt() const
+{
+    return atol(buffer.c_str());
+}
+
+float String::toFloat() const
+{
+    return (float) atof(buffer.c_str());
+}
+
+double String::toDouble() const
+{
+    return atof(buffer.c_str());
+}
+
+StringSumHelper operator+(const String &lhs, const String &rhs)
+{
+    StringSumHelper result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+StringSumHelper operator+(const String &lhs, const char *rhs)
+{
+    StringSumHelper result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+StringSumHelper operator+(const char *lhs, const String &rhs)
+{
+    StringSumHelper result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+// Print / Stream
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t n = 0;
+    while (size--)
+    {
+        n += write(*buffer++);
+    }
+    return n;
+}
+
+size_t Print::print(const char *str)
+{
+    return write(str);
+}
+
+size_t Print::print(const String &str)
+{
+    return write((const uint8_t *) str.c_str(), str.length());
+}
+
+size_t Print::print(char c)
+{
+    return write((uint8_t) c);
+}
+
+size_t Print::print(int value)
+{
+    return printf("%d", value);
+}
+
+size_t Print::print(unsigned int value)
+{
+    return printf("%u", value);
+}
+
+size_t Print::print(long value)
+{
+    return printf("%ld", value);
+}
+
+size_t Print::print(unsigned long value)
+{
+    return printf("%lu", value);
+}
+
+size_t Print::print(double value, int digits)
+{
+    return printf("%.*f", digits, value);
+}
+
+size_t Print::println()
+{
+    return write("\r\n");
+}
+
+size_t Print::println(const char *str)
+{
+    return print(str) + println();
+}
+
+size_t Print::println(const String &str)
+{
+    return print(str) + println();
+}
+
+size_t Print::println(int value)
+{
+    return print(value) + println();
+}
+
+size_t Print::println(unsigned long value)
+{
+    return print(value) + println();
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    char    buf[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len < 0)
+    {
+        return 0;
+    }
+    if ((size_t) len < sizeof(buf))
+    {
+        return write((const uint8_t *) buf, len);
+    }
+
+    std::string big(len + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&big[0], big.size(), format, args);
+    va_end(args);
+    return write((const uint8_t *) big.data(), len);
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length)
+    {
+        int c = read();
+        if (c < 0)
+        {
+            break;
+        }
+        *buffer++ = (char) c;
+        count++;
+    }
+    return count;
+}
+
+String Stream::readString()
+{
+    String result;
+    int    c;
+    while ((c = read()) >= 0)
+    {
+        result += (char) c;
+    }
+    return result;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    return fwrite(buffer, 1, size, stdout);
+}
+
+// ESP
+
+// Pretend to have the internal heap of an ESP32-S3 so free-heap numbers are comparable
+#define NATIVE_HEAP_SIZE (320 * 1024)
+
+uint32_t EspClass::getHeapSize()
+{
+    return NATIVE_HEAP_SIZE;
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+    size_t live = hal_alloc_stats().liveBytes;
+    return live >= NATIVE_HEAP_SIZE ? 0 : (uint32_t) (NATIVE_HEAP_SIZE - live);
+}
+
+uint32_t EspClass::getMinFreeHeap()
+{
+    size_t peak = hal_alloc_stats().peakBytes;
+    return peak >= NATIVE_HEAP_SIZE ? 0 : (uint32_t) (NATIVE_HEAP_SIZE - peak);
+}
+
+uint32_t EspClass::getMaxAllocHeap()
+{
+    return getFreeHeap();
+}
+
+uint32_t EspClass::getCycleCount()
+{
+    // One "cycle" per host nanosecond
+    return (uint32_t) hal_host_nanos();
+}
+
+uint32_t EspClass::getCpuFreqMHz()
+{
+    return 1000;
+}
+
+void EspClass::restart()
+{
+    fflush(stdout);
+    exit(0);
+}
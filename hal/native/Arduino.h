@@ -0,0 +1,299 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Minimal Arduino core for the host-native build. Only the parts of the API used by the
+// firmware's portable modules are provided; everything is backed by the C++ standard library.
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+using std::max;
+using std::min;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define PULLUP 0x04
+#define INPUT_PULLUP 0x05
+#define PULLDOWN 0x08
+#define INPUT_PULLDOWN 0x09
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define IRAM_ATTR
+
+#define digitalPinToInterrupt(p) (p)
+
+typedef bool    boolean;
+typedef uint8_t byte;
+
+// Clock
+unsigned long millis();
+unsigned long micros();
+int64_t       esp_timer_get_time();  // the 64-bit clock micros() is the low half of
+void          delay(unsigned long ms);
+void          delayMicroseconds(unsigned int us);
+void          yield();
+
+// GPIO
+void pinMode(uint8_t pin, uint8_t mode);
+int  digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t val);
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+long random(long max);
+long random(long min, long max);
+
+class String
+{
+   private:
+    std::string buffer;
+
+   public:
+    String() {}
+    String(const char *cstr) : buffer(cstr ? cstr : "") {}
+    String(const char *cstr, size_t length) : buffer(cstr, length) {}
+    String(const std::string &str) : buffer(str) {}
+    String(char c) : buffer(1, c) {}
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimalPlaces = 2);
+    explicit String(double value, unsigned char decimalPlaces = 2);
+
+    const char *c_str() const
+    {
+        return buffer.c_str();
+    }
+    unsigned int length() const
+    {
+        return buffer.length();
+    }
+    bool isEmpty() const
+    {
+        return buffer.empty();
+    }
+    bool reserve(unsigned int size)
+    {
+        buffer.reserve(size);
+        return true;
+    }
+
+    bool concat(const String &str)
+    {
+        buffer += str.buffer;
+        return true;
+    }
+    bool concat(const char *cstr)
+    {
+        if (cstr)
+        {
+            buffer += cstr;
+        }
+        return true;
+    }
+    bool concat(const char *cstr, unsigned int length)
+    {
+        buffer.append(cstr, length);
+        return true;
+    }
+    bool concat(char c)
+    {
+        buffer += c;
+        return true;
+    }
+
+    String &operator+=(const String &rhs)
+    {
+        concat(rhs);
+        return *this;
+    }
+    String &operator+=(const char *rhs)
+    {
+        concat(rhs);
+        return *this;
+    }
+    String &operator+=(char rhs)
+    {
+        concat(rhs);
+        return *this;
+    }
+
+    char operator[](unsigned int index) const
+    {
+        return index < buffer.length() ? buffer[index] : 0;
+    }
+    char charAt(unsigned int index) const
+    {
+        return (*this)[index];
+    }
+
+    bool equals(const String &rhs) const
+    {
+        return buffer == rhs.buffer;
+    }
+    bool equals(const char *rhs) const
+    {
+        return buffer == (rhs ? rhs : "");
+    }
+    bool operator==(const String &rhs) const
+    {
+        return equals(rhs);
+    }
+    bool operator==(const char *rhs) const
+    {
+        return equals(rhs);
+    }
+    bool operator!=(const String &rhs) const
+    {
+        return !equals(rhs);
+    }
+    bool operator!=(const char *rhs) const
+    {
+        return !equals(rhs);
+    }
+    bool operator<(const String &rhs) const
+    {
+        return buffer < rhs.buffer;
+    }
+
+    bool startsWith(const String &prefix) const;
+    bool endsWith(const String &suffix) const;
+    int  indexOf(char c, unsigned int fromIndex = 0) const;
+    int  indexOf(const String &str, unsigned int fromIndex = 0) const;
+    int  lastIndexOf(char c) const;
+
+    String substring(unsigned int beginIndex) const;
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+    void   replace(const String &find, const String &replace);
+    void   trim();
+    void   toLowerCase();
+    void   toUpperCase();
+
+    long   toInt() const;
+    float  toFloat() const;
+    double toDouble() const;
+};
+
+// Arduino's String concatenation operators return a StringSumHelper, which some libraries
+// (ArduinoJson) refer to by name.
+class StringSumHelper : public String
+{
+   public:
+    StringSumHelper(const String &s) : String(s) {}
+    StringSumHelper(const char *p) : String(p) {}
+};
+
+StringSumHelper operator+(const String &lhs, const String &rhs);
+StringSumHelper operator+(const String &lhs, const char *rhs);
+StringSumHelper operator+(const char *lhs, const String &rhs);
+
+class Print
+{
+   public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t         write(const char *str)
+    {
+        return str ? write((const uint8_t *) str, strlen(str)) : 0;
+    }
+    virtual void flush() {}
+
+    size_t print(const char *str);
+    size_t print(const String &str);
+    size_t print(char c);
+    size_t print(int value);
+    size_t print(unsigned int value);
+    size_t print(long value);
+    size_t print(unsigned long value);
+    size_t print(double value, int digits = 2);
+
+    size_t println();
+    size_t println(const char *str);
+    size_t println(const String &str);
+    size_t println(int value);
+    size_t println(unsigned long value);
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print
+{
+   public:
+    virtual int available() = 0;
+    virtual int read()      = 0;
+    virtual int peek()      = 0;
+
+    virtual size_t readBytes(char *buffer, size_t length);
+    size_t         readBytes(uint8_t *buffer, size_t length)
+    {
+        return readBytes((char *) buffer, length);
+    }
+    String readString();
+};
+
+// Serial goes to stdout; input is never available on the host.
+class HardwareSerial : public Stream
+{
+   public:
+    void begin(unsigned long) {}
+    void end() {}
+
+    int available() override
+    {
+        return 0;
+    }
+    int read() override
+    {
+        return -1;
+    }
+    int peek() override
+    {
+        return -1;
+    }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+
+    operator bool() const
+    {
+        return true;
+    }
+};
+
+extern HardwareSerial Serial;
+
+// Subset of the ESP32 system API
+class EspClass
+{
+   public:
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getHeapSize();
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz();
+    void     restart();
+};
+
+extern EspClass ESP;
+
+#endif  // NATIVE_ARDUINO_H
@@ -0,0 +1,115 @@
+#include "AsyncUDP.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define UDP_POLL_MS 100
+#define UDP_MAX_PACKET 1472
+
+AsyncUDP::AsyncUDP()
+{
+    fd           = -1;
+    stopReceiver = false;
+}
+
+AsyncUDP::~AsyncUDP()
+{
+    close();
+}
+
+bool AsyncUDP::listen(uint16_t port)
+{
+    close();
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    int enable = 1;
+    setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &enable, sizeof(enable));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port        = htons(port);
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+    {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    stopReceiver = false;
+    receiver     = std::thread(&AsyncUDP::receiveMain, this);
+    return true;
+}
+
+void AsyncUDP::onPacket(AuPacketHandlerFunction cb, void * /*arg*/)
+{
+    handler = cb;
+}
+
+void AsyncUDP::receiveMain()
+{
+    uint8_t buffer[UDP_MAX_PACKET + 1];
+    while (!stopReceiver)
+    {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, UDP_POLL_MS) != 1)
+        {
+            continue;
+        }
+        ssize_t length = recv(fd, buffer, UDP_MAX_PACKET, 0);
+        if (length <= 0 || !handler)
+        {
+            continue;
+        }
+        buffer[length] = '\0';
+        AsyncUDPPacket packet(buffer, length);
+        handler(packet);
+    }
+}
+
+size_t AsyncUDP::broadcastTo(uint8_t *data, size_t len, uint16_t port)
+{
+    if (fd < 0)
+    {
+        return 0;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_BROADCAST);
+    addr.sin_port        = htons(port);
+    ssize_t sent = sendto(fd, data, len, 0, (struct sockaddr *) &addr, sizeof(addr));
+    return sent < 0 ? 0 : sent;
+}
+
+size_t AsyncUDP::broadcastTo(const char *data, uint16_t port)
+{
+    return broadcastTo((uint8_t *) data, strlen(data), port);
+}
+
+void AsyncUDP::close()
+{
+    if (receiver.joinable())
+    {
+        stopReceiver = true;
+        receiver.join();
+    }
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool AsyncUDP::connected()
+{
+    return fd >= 0;
+}
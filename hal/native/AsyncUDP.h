@@ -0,0 +1,61 @@
+#ifndef NATIVE_ASYNC_UDP_H
+#define NATIVE_ASYNC_UDP_H
+
+// UDP socket with the same interface as the ESP32 core's AsyncUDP, for the host-native build.
+// Packets are handed to the onPacket() handler from a receive thread, the way AsyncUDP calls it
+// from its own task on the device.
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+class AsyncUDPPacket
+{
+   private:
+    uint8_t *payload;
+    size_t   size;
+
+   public:
+    AsyncUDPPacket(uint8_t *data, size_t length) : payload(data), size(length) {}
+
+    uint8_t *data()
+    {
+        return payload;
+    }
+
+    size_t length()
+    {
+        return size;
+    }
+};
+
+typedef std::function<void(AsyncUDPPacket &packet)> AuPacketHandlerFunction;
+
+class AsyncUDP
+{
+   private:
+    int                     fd;
+    AuPacketHandlerFunction handler;
+    std::thread             receiver;
+    std::atomic<bool>       stopReceiver;
+
+    void receiveMain();
+
+   public:
+    AsyncUDP();
+    ~AsyncUDP();
+
+    // Port 0 picks a free one, replies to broadcastTo() come back to it
+    bool listen(uint16_t port);
+    void onPacket(AuPacketHandlerFunction cb, void *arg = nullptr);
+
+    size_t broadcastTo(uint8_t *data, size_t len, uint16_t port);
+    size_t broadcastTo(const char *data, uint16_t port);
+
+    void close();
+    bool connected();
+};
+
+#endif  // NATIVE_ASYNC_UDP_H
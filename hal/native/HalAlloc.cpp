@@ -0,0 +1,180 @@
+// Heap accounting for the native build. On glibc the allocator entry points are interposed so
+// that ArduinoJson's malloc() calls are counted alongside String's operator new; elsewhere only
+// operator new/delete are tracked.
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+#include "NativeHal.h"
+
+static std::atomic<uint64_t> allocCount(0);
+static std::atomic<uint64_t> freeCount(0);
+static std::atomic<size_t>   liveBytes(0);
+static std::atomic<size_t>   peakBytes(0);
+
+static void trackAlloc(size_t size)
+{
+    allocCount++;
+    size_t live = liveBytes += size;
+    size_t peak = peakBytes.load();
+    while (live > peak && !peakBytes.compare_exchange_weak(peak, live))
+    {
+    }
+}
+
+static void trackFree(size_t size)
+{
+    freeCount++;
+    liveBytes -= size;
+}
+
+hal_alloc_stats_t hal_alloc_stats()
+{
+    hal_alloc_stats_t stats;
+    stats.allocations = allocCount;
+    stats.frees       = freeCount;
+    stats.liveBytes   = liveBytes;
+    stats.peakBytes   = peakBytes;
+    return stats;
+}
+
+void hal_alloc_reset_peak()
+{
+    peakBytes = liveBytes.load();
+}
+
+#if defined(__GLIBC__)
+
+#include <errno.h>
+#include <malloc.h>
+
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+    void *__libc_memalign(size_t alignment, size_t size);
+    void  __libc_free(void *ptr);
+
+    void *malloc(size_t size)
+    {
+        void *ptr = __libc_malloc(size);
+        if (ptr)
+        {
+            trackAlloc(malloc_usable_size(ptr));
+        }
+        return ptr;
+    }
+
+    void *calloc(size_t count, size_t size)
+    {
+        void *ptr = __libc_calloc(count, size);
+        if (ptr)
+        {
+            trackAlloc(malloc_usable_size(ptr));
+        }
+        return ptr;
+    }
+
+    void *realloc(void *ptr, size_t size)
+    {
+        size_t oldSize = ptr ? malloc_usable_size(ptr) : 0;
+        void  *newPtr  = __libc_realloc(ptr, size);
+        if (newPtr)
+        {
+            if (ptr)
+            {
+                trackFree(oldSize);
+            }
+            trackAlloc(malloc_usable_size(newPtr));
+        }
+        return newPtr;
+    }
+
+    void *memalign(size_t alignment, size_t size)
+    {
+        void *ptr = __libc_memalign(alignment, size);
+        if (ptr)
+        {
+            trackAlloc(malloc_usable_size(ptr));
+        }
+        return ptr;
+    }
+
+    void *aligned_alloc(size_t alignment, size_t size)
+    {
+        return memalign(alignment, size);
+    }
+
+    int posix_memalign(void **memptr, size_t alignment, size_t size)
+    {
+        void *ptr = memalign(alignment, size);
+        if (!ptr)
+        {
+            return ENOMEM;
+        }
+        *memptr = ptr;
+        return 0;
+    }
+
+    void free(void *ptr)
+    {
+        if (ptr)
+        {
+            trackFree(malloc_usable_size(ptr));
+        }
+        __libc_free(ptr);
+    }
+}
+
+#else
+
+// Without allocator interposition, prefix each block with its size so frees can be accounted
+static const size_t allocHeader = alignof(std::max_align_t);
+
+void *operator new(size_t size)
+{
+    char *block = (char *) malloc(size + allocHeader);
+    if (!block)
+    {
+        throw std::bad_alloc();
+    }
+    *(size_t *) block = size;
+    trackAlloc(size);
+    return block + allocHeader;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (!ptr)
+    {
+        return;
+    }
+    char *block = (char *) ptr - allocHeader;
+    trackFree(*(size_t *) block);
+    free(block);
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+#endif
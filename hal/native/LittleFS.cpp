@@ -0,0 +1,194 @@
+#include "LittleFS.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "NativeHal.h"
+
+LittleFSFS LittleFS;
+
+const char *hal_fs_root()
+{
+    static std::string root;
+    if (root.empty())
+    {
+        const char *env = getenv("CC_SFS_FS_ROOT");
+        if (env && *env)
+        {
+            root = env;
+            ::mkdir(root.c_str(), 0755);
+        }
+        else
+        {
+            char tmpl[] = "/tmp/cc_sfs_fs_XXXXXX";
+            root        = mkdtemp(tmpl) ? tmpl : "/tmp";
+        }
+    }
+    return root.c_str();
+}
+
+static std::string hostPath(const char *path)
+{
+    std::string full = hal_fs_root();
+    if (!path || path[0] != '/')
+    {
+        full += '/';
+    }
+    full += path ? path : "";
+    return full;
+}
+
+File::File(FILE *fp, const String &filePath) : handle(fp, fclose), path(filePath) {}
+
+size_t File::write(uint8_t c)
+{
+    return handle ? fwrite(&c, 1, 1, handle.get()) : 0;
+}
+
+size_t File::write(const uint8_t *buffer, size_t size)
+{
+    return handle ? fwrite(buffer, 1, size, handle.get()) : 0;
+}
+
+void File::flush()
+{
+    if (handle)
+    {
+        fflush(handle.get());
+    }
+}
+
+int File::available()
+{
+    if (!handle)
+    {
+        return 0;
+    }
+    long remaining = (long) size() - (long) position();
+    return remaining > 0 ? (int) remaining : 0;
+}
+
+int File::read()
+{
+    return handle ? fgetc(handle.get()) : -1;
+}
+
+int File::peek()
+{
+    if (!handle)
+    {
+        return -1;
+    }
+    int c = fgetc(handle.get());
+    if (c != EOF)
+    {
+        ungetc(c, handle.get());
+    }
+    return c;
+}
+
+size_t File::readBytes(char *buffer, size_t length)
+{
+    return handle ? fread(buffer, 1, length, handle.get()) : 0;
+}
+
+size_t File::read(uint8_t *buffer, size_t size)
+{
+    return readBytes((char *) buffer, size);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode)
+{
+    int whence = mode == SeekCur ? SEEK_CUR : (mode == SeekEnd ? SEEK_END : SEEK_SET);
+    return handle && fseek(handle.get(), pos, whence) == 0;
+}
+
+size_t File::position() const
+{
+    if (!handle)
+    {
+        return 0;
+    }
+    long pos = ftell(handle.get());
+    return pos < 0 ? 0 : (size_t) pos;
+}
+
+size_t File::size() const
+{
+    if (!handle)
+    {
+        return 0;
+    }
+    fflush(handle.get());
+    struct stat st;
+    return fstat(fileno(handle.get()), &st) == 0 ? (size_t) st.st_size : 0;
+}
+
+void File::close()
+{
+    handle.reset();
+}
+
+const char *File::name() const
+{
+    int slash = path.lastIndexOf('/');
+    return path.c_str() + (slash < 0 ? 0 : slash + 1);
+}
+
+bool LittleFSFS::begin(bool /*formatOnFail*/, const char * /*basePath*/, uint8_t /*maxOpenFiles*/,
+                       const char * /*partitionLabel*/)
+{
+    return hal_fs_root() != nullptr;
+}
+
+File LittleFSFS::open(const char *path, const char *mode, bool /*create*/)
+{
+    std::string full = hostPath(path);
+    // Match LittleFS semantics: "r" never creates, "w"/"a" create the file
+    const char *hostMode = mode;
+    if (strcmp(mode, "r") == 0)
+    {
+        hostMode = "rb";
+    }
+    else if (strcmp(mode, "w") == 0)
+    {
+        hostMode = "wb";
+    }
+    else if (strcmp(mode, "a") == 0)
+    {
+        hostMode = "ab";
+    }
+    FILE *fp = fopen(full.c_str(), hostMode);
+    return fp ? File(fp, path) : File();
+}
+
+bool LittleFSFS::exists(const char *path)
+{
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool LittleFSFS::remove(const char *path)
+{
+    return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool LittleFSFS::rename(const char *pathFrom, const char *pathTo)
+{
+    return ::rename(hostPath(pathFrom).c_str(), hostPath(pathTo).c_str()) == 0;
+}
+
+bool LittleFSFS::mkdir(const char *path)
+{
+    return ::mkdir(hostPath(path).c_str(), 0755) == 0 || exists(path);
+}
+
+size_t LittleFSFS::totalBytes()
+{
+    return 1536 * 1024;
+}
+
+size_t LittleFSFS::usedBytes()
+{
+    return 0;
+}
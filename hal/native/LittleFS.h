@@ -0,0 +1,95 @@
+#ifndef NATIVE_LITTLEFS_H
+#define NATIVE_LITTLEFS_H
+
+// LittleFS for the host-native build, backed by a directory on the workstation (see hal_fs_root).
+
+#include <Arduino.h>
+
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+enum SeekMode
+{
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class File : public Stream
+{
+   private:
+    std::shared_ptr<FILE> handle;
+    String                path;
+
+   public:
+    File() {}
+    File(FILE *fp, const String &filePath);
+
+    operator bool() const
+    {
+        return handle != nullptr;
+    }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    void flush() override;
+
+    int    available() override;
+    int    read() override;
+    int    peek() override;
+    size_t readBytes(char *buffer, size_t length) override;
+    using Stream::readBytes;
+    size_t read(uint8_t *buffer, size_t size);
+
+    bool        seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t      position() const;
+    size_t      size() const;
+    void        close();
+    const char *name() const;
+};
+
+class LittleFSFS
+{
+   public:
+    bool begin(bool formatOnFail = false, const char *basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+               const char *partitionLabel = "spiffs");
+    void end() {}
+
+    File open(const char *path, const char *mode = FILE_READ, bool create = false);
+    File open(const String &path, const char *mode = FILE_READ, bool create = false)
+    {
+        return open(path.c_str(), mode, create);
+    }
+
+    bool exists(const char *path);
+    bool exists(const String &path)
+    {
+        return exists(path.c_str());
+    }
+    bool remove(const char *path);
+    bool remove(const String &path)
+    {
+        return remove(path.c_str());
+    }
+    bool rename(const char *pathFrom, const char *pathTo);
+    bool rename(const String &pathFrom, const String &pathTo)
+    {
+        return rename(pathFrom.c_str(), pathTo.c_str());
+    }
+    bool mkdir(const char *path);
+    bool mkdir(const String &path)
+    {
+        return mkdir(path.c_str());
+    }
+
+    size_t totalBytes();
+    size_t usedBytes();
+};
+
+extern LittleFSFS LittleFS;
+
+#endif  // NATIVE_LITTLEFS_H
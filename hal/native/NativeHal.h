@@ -0,0 +1,41 @@
+#ifndef NATIVE_HAL_H
+#define NATIVE_HAL_H
+
+// Host-side controls for the native HAL. Benchmarks and simulations use these to drive inputs
+// and read counters that only exist off-target.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Drive an input pin. Fires any interrupt attached to the pin in the caller's context, the same
+// way a GPIO interrupt would preempt the firmware.
+void hal_gpio_set(uint8_t pin, int level);
+
+// Switch millis()/micros() to a virtual clock that only moves when advanced, so scenarios can
+// run much faster than real time and produce repeatable numbers.
+void     hal_clock_use_virtual(bool enable);
+void     hal_clock_advance_us(uint64_t us);
+uint64_t hal_clock_now_us();
+
+// Monotonic nanoseconds of the host, independent of the virtual clock. Used for measuring cost.
+uint64_t hal_host_nanos();
+
+typedef struct
+{
+    uint64_t allocations;  // malloc/new calls since start
+    uint64_t frees;        // free/delete calls since start
+    size_t   liveBytes;    // bytes currently allocated
+    size_t   peakBytes;    // high-water mark of liveBytes since the last reset
+} hal_alloc_stats_t;
+
+hal_alloc_stats_t hal_alloc_stats();
+void              hal_alloc_reset_peak();
+
+// Directory backing LittleFS. Defaults to a fresh temp directory, or $CC_SFS_FS_ROOT if set.
+const char *hal_fs_root();
+
+// Directory backing Preferences (NVS), one subdirectory per namespace. Defaults to hal_fs_root()
+// with an "_nvs" suffix, or $CC_SFS_NVS_ROOT if set.
+const char *hal_nvs_root();
+
+#endif  // NATIVE_HAL_H
@@ -0,0 +1,135 @@
+#include "Preferences.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <string>
+
+#include "NativeHal.h"
+
+// NVS namespaces and keys are limited to 15 characters on the device
+#define NVS_KEY_NAME_MAX 15
+
+const char *hal_nvs_root()
+{
+    static std::string root;
+    if (root.empty())
+    {
+        const char *env = getenv("CC_SFS_NVS_ROOT");
+        root            = (env && *env) ? env : std::string(hal_fs_root()) + "_nvs";
+        ::mkdir(root.c_str(), 0755);
+    }
+    return root.c_str();
+}
+
+bool Preferences::begin(const char *name, bool readOnly, const char * /*partitionLabel*/)
+{
+    if (!name || strlen(name) > NVS_KEY_NAME_MAX)
+    {
+        return false;
+    }
+    space          = String(hal_nvs_root()) + "/" + name;
+    this->readOnly = readOnly;
+    ::mkdir(space.c_str(), 0755);
+    opened = true;
+    return true;
+}
+
+void Preferences::end()
+{
+    opened = false;
+}
+
+String Preferences::keyPath(const char *key)
+{
+    return space + "/" + key;
+}
+
+bool Preferences::clear()
+{
+    if (!opened || readOnly)
+    {
+        return false;
+    }
+    DIR *dir = opendir(space.c_str());
+    if (!dir)
+    {
+        return false;
+    }
+    while (struct dirent *entry = readdir(dir))
+    {
+        if (entry->d_name[0] != '.')
+        {
+            ::remove(keyPath(entry->d_name).c_str());
+        }
+    }
+    closedir(dir);
+    return true;
+}
+
+bool Preferences::remove(const char *key)
+{
+    if (!opened || readOnly)
+    {
+        return false;
+    }
+    return ::remove(keyPath(key).c_str()) == 0;
+}
+
+bool Preferences::isKey(const char *key)
+{
+    struct stat info;
+    return opened && stat(keyPath(key).c_str(), &info) == 0;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t length)
+{
+    if (!opened || readOnly || !key || strlen(key) > NVS_KEY_NAME_MAX)
+    {
+        return 0;
+    }
+
+    String temp = keyPath(key) + ".tmp";
+    FILE  *fp   = fopen(temp.c_str(), "wb");
+    if (!fp)
+    {
+        return 0;
+    }
+    size_t written = fwrite(value, 1, length, fp);
+    fclose(fp);
+    if (written != length || rename(temp.c_str(), keyPath(key).c_str()) != 0)
+    {
+        ::remove(temp.c_str());
+        return 0;
+    }
+    return written;
+}
+
+size_t Preferences::getBytesLength(const char *key)
+{
+    struct stat info;
+    if (!opened || stat(keyPath(key).c_str(), &info) != 0)
+    {
+        return 0;
+    }
+    return info.st_size;
+}
+
+size_t Preferences::getBytes(const char *key, void *buffer, size_t maxLength)
+{
+    size_t length = getBytesLength(key);
+    if (length == 0 || length > maxLength)
+    {
+        return 0;
+    }
+    FILE *fp = fopen(keyPath(key).c_str(), "rb");
+    if (!fp)
+    {
+        return 0;
+    }
+    size_t read = fread(buffer, 1, length, fp);
+    fclose(fp);
+    return read;
+}
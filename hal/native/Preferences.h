@@ -0,0 +1,32 @@
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+// Preferences (NVS) for the host-native build. Each key is a file under
+// hal_nvs_root()/<namespace>/, written through a temp file and rename like NVS commits.
+
+#include <Arduino.h>
+
+class Preferences
+{
+   private:
+    String space;
+    bool   opened;
+    bool   readOnly;
+
+    String keyPath(const char *key);
+
+   public:
+    Preferences() : opened(false), readOnly(false) {}
+
+    bool begin(const char *name, bool readOnly = false, const char *partitionLabel = nullptr);
+    void end();
+
+    bool   clear();
+    bool   remove(const char *key);
+    bool   isKey(const char *key);
+    size_t putBytes(const char *key, const void *value, size_t length);
+    size_t getBytesLength(const char *key);
+    size_t getBytes(const char *key, void *buffer, size_t maxLength);
+};
+
+#endif  // NATIVE_PREFERENCES_H
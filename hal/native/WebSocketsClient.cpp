@@ -0,0 +1,389 @@
+#include "WebSocketsClient.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define WS_CONNECT_TIMEOUT_MS 500
+
+WebSocketsClient::WebSocketsClient()
+{
+    port              = 0;
+    fd                = -1;
+    state             = WS_IDLE;
+    enabled           = false;
+    reconnectInterval = 500;
+    lastAttempt       = 0;
+}
+
+WebSocketsClient::~WebSocketsClient()
+{
+    closeSocket(false);
+}
+
+void WebSocketsClient::begin(const char *hostName, uint16_t hostPort, const char *path,
+                             const char * /*protocol*/)
+{
+    closeSocket(false);
+    host        = hostName;
+    port        = hostPort;
+    url         = path;
+    enabled     = true;
+    lastAttempt = 0;
+    openSocket();
+}
+
+void WebSocketsClient::begin(String hostName, uint16_t hostPort, String path, String protocol)
+{
+    begin(hostName.c_str(), hostPort, path.c_str(), protocol.c_str());
+}
+
+void WebSocketsClient::onEvent(WebSocketClientEvent cbEvent)
+{
+    callback = cbEvent;
+}
+
+bool WebSocketsClient::sendTXT(uint8_t *payload, size_t length, bool /*headerToPayload*/)
+{
+    if (length == 0)
+    {
+        length = strlen((const char *) payload);
+    }
+    return sendFrame(0x1, payload, length);
+}
+
+bool WebSocketsClient::sendTXT(const uint8_t *payload, size_t length)
+{
+    return sendTXT((uint8_t *) payload, length);
+}
+
+bool WebSocketsClient::sendTXT(char *payload, size_t length, bool headerToPayload)
+{
+    return sendTXT((uint8_t *) payload, length, headerToPayload);
+}
+
+bool WebSocketsClient::sendTXT(const char *payload, size_t length)
+{
+    return sendTXT((uint8_t *) payload, length);
+}
+
+bool WebSocketsClient::sendTXT(String &payload)
+{
+    return sendTXT((uint8_t *) payload.c_str(), payload.length());
+}
+
+void WebSocketsClient::disconnect()
+{
+    if (state == WS_CONNECTED)
+    {
+        sendFrame(0x8, nullptr, 0);
+    }
+    closeSocket(true);
+}
+
+void WebSocketsClient::setReconnectInterval(unsigned long time)
+{
+    reconnectInterval = time;
+}
+
+bool WebSocketsClient::isConnected()
+{
+    return state == WS_CONNECTED;
+}
+
+void WebSocketsClient::loop()
+{
+    if (fd < 0)
+    {
+        if (enabled && millis() - lastAttempt >= reconnectInterval)
+        {
+            openSocket();
+        }
+        return;
+    }
+
+    if (!receive())
+    {
+        closeSocket(true);
+        return;
+    }
+
+    if (state == WS_HANDSHAKE)
+    {
+        processHandshake();
+    }
+    if (state == WS_CONNECTED)
+    {
+        processFrames();
+    }
+}
+
+void WebSocketsClient::openSocket()
+{
+    lastAttempt = millis();
+
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *result = nullptr;
+    if (getaddrinfo(host.c_str(), service, &hints, &result) != 0 || !result)
+    {
+        return;
+    }
+
+    fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (fd < 0)
+    {
+        freeaddrinfo(result);
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    int noDelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    int rc = connect(fd, result->ai_addr, result->ai_addrlen);
+    freeaddrinfo(result);
+    if (rc != 0 && errno == EINPROGRESS)
+    {
+        struct pollfd pfd = {fd, POLLOUT, 0};
+        int           err = 0;
+        socklen_t     len = sizeof(err);
+        if (poll(&pfd, 1, WS_CONNECT_TIMEOUT_MS) == 1 &&
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0)
+        {
+            rc = 0;
+        }
+    }
+    if (rc != 0)
+    {
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+
+    char request[512];
+    int  len = snprintf(request, sizeof(request),
+                        "GET %s HTTP/1.1\r\n"
+                        "Host: %s:%u\r\n"
+                        "Upgrade: websocket\r\n"
+                        "Connection: Upgrade\r\n"
+                        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                        "Sec-WebSocket-Version: 13\r\n"
+                        "\r\n",
+                        url.c_str(), host.c_str(), port);
+    if (send(fd, request, len, MSG_NOSIGNAL) != len)
+    {
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+    rxBuffer.clear();
+    state = WS_HANDSHAKE;
+}
+
+void WebSocketsClient::closeSocket(bool notify)
+{
+    bool wasConnected = state == WS_CONNECTED;
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+    state = WS_IDLE;
+    rxBuffer.clear();
+    lastAttempt = millis();
+    if (notify && wasConnected)
+    {
+        emit(WStype_DISCONNECTED, nullptr, 0);
+    }
+}
+
+bool WebSocketsClient::sendFrame(uint8_t opcode, const uint8_t *payload, size_t length)
+{
+    if (fd < 0 || (state != WS_CONNECTED && opcode != 0x8))
+    {
+        return false;
+    }
+
+    // Client frames are always masked; a zero mask keeps the payload readable in captures
+    uint8_t header[14];
+    size_t  headerLength = 0;
+    header[headerLength++] = 0x80 | opcode;
+    if (length < 126)
+    {
+        header[headerLength++] = 0x80 | (uint8_t) length;
+    }
+    else if (length <= 0xFFFF)
+    {
+        header[headerLength++] = 0x80 | 126;
+        header[headerLength++] = (uint8_t) (length >> 8);
+        header[headerLength++] = (uint8_t) length;
+    }
+    else
+    {
+        header[headerLength++] = 0x80 | 127;
+        for (int i = 7; i >= 0; i--)
+        {
+            header[headerLength++] = (uint8_t) ((uint64_t) length >> (8 * i));
+        }
+    }
+    memset(header + headerLength, 0, 4);
+    headerLength += 4;
+
+    std::string frame((const char *) header, headerLength);
+    if (length)
+    {
+        frame.append((const char *) payload, length);
+    }
+
+    size_t sent = 0;
+    while (sent < frame.size())
+    {
+        ssize_t n = send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                struct pollfd pfd = {fd, POLLOUT, 0};
+                poll(&pfd, 1, 10);
+                continue;
+            }
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+bool WebSocketsClient::receive()
+{
+    char buffer[4096];
+    while (true)
+    {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n > 0)
+        {
+            rxBuffer.append(buffer, n);
+            continue;
+        }
+        if (n == 0)
+        {
+            return false;
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+}
+
+void WebSocketsClient::processHandshake()
+{
+    size_t end = rxBuffer.find("\r\n\r\n");
+    if (end == std::string::npos)
+    {
+        return;
+    }
+    bool upgraded = rxBuffer.compare(0, 12, "HTTP/1.1 101") == 0;
+    rxBuffer.erase(0, end + 4);
+    if (!upgraded)
+    {
+        closeSocket(false);
+        return;
+    }
+    state = WS_CONNECTED;
+    emit(WStype_CONNECTED, (uint8_t *) url.c_str(), url.length());
+}
+
+void WebSocketsClient::processFrames()
+{
+    while (state == WS_CONNECTED && rxBuffer.size() >= 2)
+    {
+        const uint8_t *data    = (const uint8_t *) rxBuffer.data();
+        uint8_t        opcode  = data[0] & 0x0F;
+        bool           masked  = data[1] & 0x80;
+        uint64_t       length  = data[1] & 0x7F;
+        size_t         offset  = 2;
+        if (length == 126)
+        {
+            if (rxBuffer.size() < 4)
+            {
+                return;
+            }
+            length = ((uint64_t) data[2] << 8) | data[3];
+            offset = 4;
+        }
+        else if (length == 127)
+        {
+            if (rxBuffer.size() < 10)
+            {
+                return;
+            }
+            length = 0;
+            for (int i = 0; i < 8; i++)
+            {
+                length = (length << 8) | data[2 + i];
+            }
+            offset = 10;
+        }
+        uint8_t mask[4] = {0, 0, 0, 0};
+        if (masked)
+        {
+            if (rxBuffer.size() < offset + 4)
+            {
+                return;
+            }
+            memcpy(mask, data + offset, 4);
+            offset += 4;
+        }
+        if (rxBuffer.size() < offset + length)
+        {
+            return;
+        }
+
+        // Payloads are delivered NUL-terminated, like the embedded library does
+        std::string payload = rxBuffer.substr(offset, length);
+        rxBuffer.erase(0, offset + length);
+        for (size_t i = 0; masked && i < payload.size(); i++)
+        {
+            payload[i] ^= mask[i & 3];
+        }
+
+        switch (opcode)
+        {
+            case 0x1:
+                emit(WStype_TEXT, (uint8_t *) &payload[0], payload.size());
+                break;
+            case 0x2:
+                emit(WStype_BIN, (uint8_t *) &payload[0], payload.size());
+                break;
+            case 0x8:
+                closeSocket(true);
+                break;
+            case 0x9:
+                sendFrame(0xA, (const uint8_t *) payload.data(), payload.size());
+                emit(WStype_PING, (uint8_t *) &payload[0], payload.size());
+                break;
+            case 0xA:
+                emit(WStype_PONG, (uint8_t *) &payload[0], payload.size());
+                break;
+            default:
+                emit(WStype_FRAGMENT, (uint8_t *) &payload[0], payload.size());
+                break;
+        }
+    }
+}
+
+void WebSocketsClient::emit(WStype_t type, uint8_t *payload, size_t length)
+{
+    if (callback)
+    {
+        callback(type, payload, length);
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef NATIVE_WEBSOCKETS_CLIENT_H
+#define NATIVE_WEBSOCKETS_CLIENT_H
+
+// Plain-socket WebSocket client with the same interface as links2004/WebSockets, for the
+// host-native build. Supports what SDCP needs: unfragmented text frames, ping/pong and close.
+
+#include <Arduino.h>
+
+#include <functional>
+#include <string>
+
+typedef enum
+{
+    WStype_ERROR,
+    WStype_DISCONNECTED,
+    WStype_CONNECTED,
+    WStype_TEXT,
+    WStype_BIN,
+    WStype_FRAGMENT_TEXT_START,
+    WStype_FRAGMENT_BIN_START,
+    WStype_FRAGMENT,
+    WStype_FRAGMENT_FIN,
+    WStype_PING,
+    WStype_PONG,
+} WStype_t;
+
+class WebSocketsClient
+{
+   public:
+    typedef std::function<void(WStype_t type, uint8_t *payload, size_t length)> WebSocketClientEvent;
+
+    WebSocketsClient();
+    ~WebSocketsClient();
+
+    void begin(const char *host, uint16_t port, const char *url = "/",
+               const char *protocol = "arduino");
+    void begin(String host, uint16_t port, String url = "/", String protocol = "arduino");
+
+    void onEvent(WebSocketClientEvent cbEvent);
+
+    bool sendTXT(uint8_t *payload, size_t length = 0, bool headerToPayload = false);
+    bool sendTXT(const uint8_t *payload, size_t length = 0);
+    bool sendTXT(char *payload, size_t length = 0, bool headerToPayload = false);
+    bool sendTXT(const char *payload, size_t length = 0);
+    bool sendTXT(String &payload);
+
+    void disconnect();
+    void setReconnectInterval(unsigned long time);
+    bool isConnected();
+    void loop();
+
+   private:
+    typedef enum
+    {
+        WS_IDLE,
+        WS_HANDSHAKE,
+        WS_CONNECTED,
+    } ws_state_t;
+
+    WebSocketClientEvent callback;
+
+    std::string   host;
+    uint16_t      port;
+    std::string   url;
+    int           fd;
+    ws_state_t    state;
+    bool          enabled;
+    unsigned long reconnectInterval;
+    unsigned long lastAttempt;
+    std::string   rxBuffer;
+
+    void openSocket();
+    void closeSocket(bool notify);
+    bool sendFrame(uint8_t opcode, const uint8_t *payload, size_t length);
+    bool receive();
+    void processHandshake();
+    void processFrames();
+    void emit(WStype_t type, uint8_t *payload, size_t length);
+};
+
+#endif  // NATIVE_WEBSOCKETS_CLIENT_H
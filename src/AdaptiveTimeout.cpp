@@ -0,0 +1,95 @@
+#include "AdaptiveTimeout.h"
+
+static const char *speedNames[ADAPTIVE_SPEED_BUCKETS] = {"silent", "balanced", "sport",
+                                                         "ludicrous"};
+
+AdaptiveTimeout::AdaptiveTimeout()
+{
+    quantile = 0.99f;
+    marginMs = 500;
+    for (int slot = 0; slot < ADAPTIVE_SLOTS; slot++)
+    {
+        quantiles[slot].setQuantile(quantile);
+        learned[slot] = 0;
+    }
+}
+
+int AdaptiveTimeout::slotFor(bool firstLayer, int printSpeedPct)
+{
+    // Split halfway between the printer's speed modes
+    int bucket = printSpeedPct < 75 ? 0 : printSpeedPct < 115 ? 1 : printSpeedPct < 145 ? 2 : 3;
+    return (firstLayer ? 0 : ADAPTIVE_SPEED_BUCKETS) + bucket;
+}
+
+void AdaptiveTimeout::configure(float quantilePercent, int margin)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    marginMs = margin;
+
+    float newQuantile = quantilePercent / 100.0f;
+    if (newQuantile == quantile)
+    {
+        return;
+    }
+    quantile = newQuantile;
+    for (int slot = 0; slot < ADAPTIVE_SLOTS; slot++)
+    {
+        quantiles[slot].setQuantile(quantile);
+        learned[slot] = 0;
+    }
+}
+
+void AdaptiveTimeout::addInterval(int slot, uint32_t intervalMs)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    P2Quantile &estimate = quantiles[slot];
+    estimate.add((float) intervalMs);
+    if (estimate.samples() >= ADAPTIVE_MIN_SAMPLES)
+    {
+        learned[slot] = (uint32_t) lroundf(estimate.value()) + marginMs;
+    }
+}
+
+int AdaptiveTimeout::timeoutFor(int slot, int configured)
+{
+    int timeout = (int) learned[slot].load(std::memory_order_relaxed);
+    if (timeout == 0 || timeout > configured)
+    {
+        return configured;
+    }
+    if (timeout < ADAPTIVE_TIMEOUT_FLOOR_MS)
+    {
+        return configured < ADAPTIVE_TIMEOUT_FLOOR_MS ? configured : ADAPTIVE_TIMEOUT_FLOOR_MS;
+    }
+    return timeout;
+}
+
+void AdaptiveTimeout::reset()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (int slot = 0; slot < ADAPTIVE_SLOTS; slot++)
+    {
+        quantiles[slot].reset();
+        learned[slot] = 0;
+    }
+}
+
+void AdaptiveTimeout::toJson(JsonDocument &doc)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    doc["quantile"]    = quantile * 100.0f;
+    doc["margin_ms"]   = marginMs;
+    doc["min_samples"] = ADAPTIVE_MIN_SAMPLES;
+
+    JsonArray slots = doc.createNestedArray("slots");
+    for (int slot = 0; slot < ADAPTIVE_SLOTS; slot++)
+    {
+        JsonObject out     = slots.createNestedObject();
+        out["phase"]       = slot < ADAPTIVE_SPEED_BUCKETS ? "first_layer" : "later_layers";
+        out["speed"]       = speedNames[slot % ADAPTIVE_SPEED_BUCKETS];
+        out["samples"]     = quantiles[slot].samples();
+        out["quantile_ms"] = lroundf(quantiles[slot].value());
+        out["timeout_ms"]  = learned[slot].load(std::memory_order_relaxed);
+    }
+}
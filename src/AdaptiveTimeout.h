@@ -0,0 +1,64 @@
+#ifndef ADAPTIVE_TIMEOUT_H
+#define ADAPTIVE_TIMEOUT_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include <atomic>
+#include <mutex>
+
+#include "StreamingStats.h"
+
+// PrintSpeedPct buckets: silent (50%), balanced (100%), sport (130%), ludicrous (160%)
+#define ADAPTIVE_SPEED_BUCKETS 4
+// First layer and later layers, each with every speed bucket
+#define ADAPTIVE_SLOTS (2 * ADAPTIVE_SPEED_BUCKETS)
+
+// Intervals a slot needs before its learned timeout replaces the configured one
+#define ADAPTIVE_MIN_SAMPLES 200
+
+// A learned timeout is never shorter than this, whatever the intervals look like
+#define ADAPTIVE_TIMEOUT_FLOOR_MS 1000
+
+// Capacity needed by AdaptiveTimeout::toJson()
+#define ADAPTIVE_TIMEOUT_JSON_SIZE \
+    (JSON_OBJECT_SIZE(4) + JSON_ARRAY_SIZE(ADAPTIVE_SLOTS) + ADAPTIVE_SLOTS * JSON_OBJECT_SIZE(5))
+
+// Learns the distribution of the time between movement sensor edges per print phase and speed,
+// and derives a movement timeout from a high quantile of it plus a margin. The configured
+// timeout stays the upper bound. Intervals come from the sensor task, timeouts are read lock free
+// by loop().
+class AdaptiveTimeout
+{
+   private:
+    std::mutex lock;
+    P2Quantile quantiles[ADAPTIVE_SLOTS];
+    float      quantile;  // 0..1
+    int        marginMs;
+
+    // Learned timeout per slot in ms, 0 until the slot has ADAPTIVE_MIN_SAMPLES intervals
+    std::atomic<uint32_t> learned[ADAPTIVE_SLOTS];
+
+   public:
+    AdaptiveTimeout();
+
+    static int slotFor(bool firstLayer, int printSpeedPct);
+
+    // Quantile in percent; a different quantile starts learning over
+    void configure(float quantilePercent, int margin);
+
+    // Time between two movement edges while printing, in ms
+    void addInterval(int slot, uint32_t intervalMs);
+
+    // Timeout to use in slot, the configured one until enough intervals have been seen
+    int timeoutFor(int slot, int configured);
+
+    // Forgets everything learned, called when a new print starts
+    void reset();
+
+    // {"quantile":..,"margin_ms":..,"min_samples":..,"slots":[{"phase","speed","samples",
+    // "quantile_ms","timeout_ms"},...]}
+    void toJson(JsonDocument &doc);
+};
+
+#endif  // ADAPTIVE_TIMEOUT_H
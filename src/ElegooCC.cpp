@@ -1,8 +1,11 @@
 #include "ElegooCC.h"
 
-#include <ArduinoJson.h>
+#include <stdarg.h>
 
 #include "Logger.h"
+#include "LoopProfiler.h"
+#include "Metrics.h"
+#include "PrinterDiscovery.h"
 #include "SettingsManager.h"
 
 #define ACK_TIMEOUT_MS 5000
@@ -10,21 +13,18 @@
 // External function to get current time (from main.cpp)
 extern unsigned long getTime();
 
-ElegooCC& ElegooCC::getInstance()
-{
-    static ElegooCC instance;
-    return instance;
-}
-
-ElegooCC::ElegooCC()
+ElegooCC::ElegooCC(int printer, uint8_t runoutSensorPin, uint8_t movementSensorPin)
+    : index(printer), runoutPin(runoutSensorPin), movementPin(movementSensorPin)
 {
     lastMovementValue = -1;
-    lastChangeTime    = 0;
+    lastChangeMicros  = 0;
+    seenOverflowCount = 0;
 
-    mainboardID       = "";
+    mainboardID[0]    = '\0';
     printStatus       = SDCP_PRINT_STATUS_IDLE;
     machineStatusMask = 0;  // No statuses active initially
     currentLayer      = 0;
+    currentZ          = 0;
     totalLayer        = 0;
     progress          = 0;
     currentTicks      = 0;
@@ -32,43 +32,74 @@ ElegooCC::ElegooCC()
     PrintSpeedPct     = 0;
     filamentStopped   = false;
     filamentRunout    = false;
-    lastPing          = 0;
-    lastStatusPoll    = 0;
-
-    lastTickTime  = 0;
-    totalTickTime = 0;
-    tickCount     = 0;
-    minTickTime   = 0;
-    maxTickTime   = 0;
-
-    startTotalTickTime = 0;
-    startTickCount     = 0;
-    startMinTickTime   = 0;
-    startMaxTickTime   = 0;
-
-    firstLayerTotalTickTime = 0;
-    firstLayerTickCount     = 0;
-    firstLayerMinTickTime   = 0;
-    firstLayerMaxTickTime   = 0;
-
-    laterLayersTotalTickTime = 0;
-    laterLayersTickCount     = 0;
-    laterLayersMinTickTime   = 0;
-    laterLayersMaxTickTime   = 0;
-
-    waitingForAck       = false;
-    pendingAckCommand   = -1;
-    pendingAckRequestId = "";
-    ackWaitStartTime    = 0;
-
-    // TODO: send a UDP broadcast, M99999 on Port 30000, maybe using AsyncUDP.h and listen for the
-    // result. this will give us the printer IP address.
+    stoppedMicros     = 0;
+    runoutMicros      = 0;
+    droppedEdges      = 0;
+    movementStarted   = false;
+    runoutChanged     = false;
+    stoppedAfterMs    = 0;
+    stoppedLimit      = 0;
+    printActive       = false;
+    startedAt         = 0;
+
+    lastPing            = 0;
+    lastStatusPoll      = 0;
+    lastStatusReceived  = 0;
+    statusPollRequested = false;
+    lastStatusHash      = 0;
+    lastStatusLength    = 0;
+    haveStatusHash      = false;
+    disconnectedSince   = 0;
+
+    settingsGeneration = 0;
+    timeout            = 0;
+    firstLayerTimeout  = 0;
+    startPrintTimeout  = 0;
+    pauseOnRunout      = false;
+    enabled            = false;
+    adaptiveEnabled    = false;
+
+    pauseArmed           = false;
+    movementTimeout      = 0;
+    movementTimeoutLimit = 0;
+    movementSlot         = 0;
+    learnIntervals       = false;
+    intervalValid        = false;
+    pauseRequested       = false;
+    sensorWake           = nullptr;
+    sensorTaskRunning    = false;
+
+    lastTickTime = 0;
+
+    waitingForAck          = false;
+    pendingAckCommand      = -1;
+    pendingAckRequestId[0] = '\0';
+    ackWaitStartTime       = 0;
 
     // event handler - use lambda to capture 'this' pointer
     webSocket.onEvent([this](WStype_t type, uint8_t* payload, size_t length)
                       { this->webSocketEvent(type, payload, length); });
 }
 
+void ElegooCC::log(const char* message)
+{
+    logf("%s", message);
+}
+
+void ElegooCC::logf(const char* format, ...)
+{
+    char    buffer[LOG_MAX_MESSAGE_LENGTH + 1];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+#if PRINTER_COUNT > 1
+    logger.logf("Printer %d: %s", index + 1, buffer);
+#else
+    logger.log(buffer);
+#endif
+}
+
 void ElegooCC::setup()
 {
     bool shouldConect = !settingsManager.isAPMode();
@@ -78,148 +109,270 @@ void ElegooCC::setup()
     }
 }
 
+void ElegooCC::beginSensors(SensorWake* wake)
+{
+    sensorWake = wake;
+    movementSensor.begin(movementPin, wake);
+    attachInterruptArg(digitalPinToInterrupt(runoutPin), ElegooCC::onRunoutEdge, this, CHANGE);
+}
+
+void IRAM_ATTR ElegooCC::onRunoutEdge(void* arg)
+{
+    // The switch is read by checkFilamentRunout(), this only gets the sensor task to it
+    static_cast<ElegooCC*>(arg)->sensorWake->notifyFromISR();
+}
+
+void ElegooCC::setSensorTaskRunning(bool running)
+{
+    sensorTaskRunning = running;
+}
+
+void ElegooCC::sensorTick(unsigned long currentTime)
+{
+    // Before determining if we should pause, check if the filament is moving or it ran out
+    checkFilamentMovement();
+    checkFilamentRunout();
+    feedRate.update(currentTime, movementSensor.getEdgeCount(), learnIntervals);
+
+    // Only one request in flight, loop() clears the flag once it has logged the pause
+    if (!pauseRequested && shouldPausePrint())
+    {
+        pause_request_t request;
+        request.filamentRunout       = filamentRunout;
+        request.filamentStopped      = filamentStopped;
+        request.timing.hasEdge       = request.filamentStopped;
+        request.timing.edgeMicros    = lastChangeMicros;
+        request.timing.triggerMicros = request.filamentStopped ? stoppedMicros : runoutMicros;
+        request.timing.decideMicros  = micros();
+        request.sent                 = sendPause(request);
+        if (pauseRequests.push(request))
+        {
+            pauseRequested = true;
+            // The gap that led here is a stoppage, not an interval to learn from
+            intervalValid = false;
+        }
+    }
+
+    // Logging takes a lock and can block on the log sinks, so it waits until the pause is out
+    logSensorChanges();
+}
+
+void ElegooCC::logSensorChanges()
+{
+    if (droppedEdges > 0)
+    {
+        logf("Movement edge buffer overflowed, %lu edges dropped", (unsigned long) droppedEdges);
+        droppedEdges = 0;
+    }
+    if (runoutChanged)
+    {
+        log(filamentRunout ? "Filament has run out" : "Filament has been detected");
+        runoutChanged = false;
+    }
+    if (movementStarted)
+    {
+        log("Filament movement started");
+        movementStarted = false;
+    }
+    if (stoppedAfterMs > 0)
+    {
+        logf("Filament movement stopped, last movement detected %lums ago (timeout %dms)",
+             stoppedAfterMs, stoppedLimit);
+        stoppedAfterMs = 0;
+    }
+}
+
+// Writes the pause to the websocket from the context that decided it, rather than leaving it for
+// the next loop() pass. Never waits for the lock: loop() holds it across webSocket.loop(), which
+// can block for a whole connect. When it is busy, handlePauseRequests() sends the pause instead.
+bool ElegooCC::sendPause(const pause_request_t& request)
+{
+    std::unique_lock<std::mutex> guard(socketLock, std::try_to_lock);
+    return guard.owns_lock() && pausePrint(request);
+}
+
+// Edges move the deadline, the wakeup they cause lets the sensor task re-arm its timer
+void ElegooCC::disarm()
+{
+    // Without loop() the gate and the timeouts go stale, and the pause could not be acked
+    pauseArmed     = false;
+    learnIntervals = false;
+}
+
+bool ElegooCC::getMovementDeadline(uint32_t& atMicros)
+{
+    int limit = movementTimeout.load();
+    if (filamentStopped || limit <= 0)
+    {
+        return false;
+    }
+    atMicros = lastChangeMicros + (uint32_t) limit * 1000;
+    return true;
+}
+
 void ElegooCC::webSocketEvent(WStype_t type, uint8_t* payload, size_t length)
 {
     switch (type)
     {
         case WStype_DISCONNECTED:
-            logger.log("Disconnected from Carbon Centauri");
+            log("Disconnected from Carbon Centauri");
+            metrics.countDisconnect(index);
             // Reset acknowledgment state on disconnect
-            waitingForAck       = false;
-            pendingAckCommand   = -1;
-            pendingAckRequestId = "";
-            ackWaitStartTime    = 0;
+            waitingForAck          = false;
+            pendingAckCommand      = -1;
+            pendingAckRequestId[0] = '\0';
+            ackWaitStartTime       = 0;
+            haveStatusHash         = false;
             break;
         case WStype_CONNECTED:
-            logger.log("Connected to Carbon Centauri");
+            log("Connected to Carbon Centauri");
+            metrics.countConnect(index);
             sendCommand(SDCP_COMMAND_STATUS);
 
             break;
         case WStype_TEXT:
         {
-            StaticJsonDocument<2048> doc;
-            DeserializationError     error = deserializeJson(doc, payload);
+            metrics.countMessage(index);
 
-            if (error)
+            // A status that repeats the last one changes nothing, only that it arrived counts.
+            // Command replies are always handled, a missed ack would hold up the next command.
+            uint32_t hash = hashSdcpPayload((const char*) payload, length);
+            if (haveStatusHash && length == lastStatusLength && hash == lastStatusHash &&
+                isSdcpStatusPush((const char*) payload, length))
             {
-                logger.logf("JSON parsing failed: %s", error.c_str());
-                return;
+                metrics.countStatus(index, true);
+                lastStatusReceived = millis();
+                break;
+            }
+
+            sdcp_message_t message;
+            bool           parsed = parseSdcpMessage((const char*) payload, length, message);
+            if (!parsed)
+            {
+                metrics.countParseFailure(index);
+                // Act on whatever was read before the error rather than dropping the update
+                logf("Malformed SDCP message (%d bytes)", (int) length);
             }
 
             // Check if this is a command acknowledgment response
-            if (doc.containsKey("Id") && doc.containsKey("Data"))
+            if ((message.fields & SDCP_FIELD_ID) && (message.fields & SDCP_FIELD_DATA))
             {
-                handleCommandResponse(doc);
+                handleCommandResponse(message);
             }
             // Check if this is a status response
-            else if (doc.containsKey("Status"))
+            else if (message.fields & SDCP_FIELD_STATUS)
             {
-                handleStatus(doc);
+                metrics.countStatus(index, false);
+                handleStatus(message);
+                // Only a complete status is known to have been applied in full
+                lastStatusHash   = hash;
+                lastStatusLength = length;
+                haveStatusHash   = parsed;
             }
         }
         break;
         case WStype_BIN:
-            logger.log("Received unspported binary data");
+            log("Received unspported binary data");
             break;
         case WStype_ERROR:
-            logger.logf("WebSocket error: %s", payload);
+            logf("WebSocket error: %s", payload);
             break;
         case WStype_FRAGMENT_TEXT_START:
         case WStype_FRAGMENT_BIN_START:
         case WStype_FRAGMENT:
         case WStype_FRAGMENT_FIN:
-            logger.log("Received unspported fragment data");
+            log("Received unspported fragment data");
+            break;
+        default:
             break;
     }
 }
 
-void ElegooCC::handleCommandResponse(JsonDocument& doc)
+void ElegooCC::handleCommandResponse(const sdcp_message_t& message)
 {
-    String     id   = doc["Id"];
-    JsonObject data = doc["Data"];
-
-    if (data.containsKey("Cmd") && data.containsKey("RequestID"))
+    if ((message.fields & SDCP_FIELD_CMD) && (message.fields & SDCP_FIELD_REQUEST_ID))
     {
-        int    cmd         = data["Cmd"];
-        int    ack         = data["Data"]["Ack"];
-        String requestId   = data["RequestID"];
-        String mainboardId = data["MainboardID"];
+        int cmd = message.cmd;
 
-        logger.logf("Command %d acknowledged (Ack: %d) for request %s", cmd, ack,
-                    requestId.c_str());
+        logf("Command %d acknowledged (Ack: %d) for request %s", cmd, message.ack,
+             message.requestId);
 
         // Check if this is the acknowledgment we're waiting for
-        if (waitingForAck && cmd == pendingAckCommand && requestId == pendingAckRequestId)
+        if (waitingForAck && cmd == pendingAckCommand &&
+            strcmp(message.requestId, pendingAckRequestId) == 0)
         {
-            logger.logf("Received expected acknowledgment for command %d", cmd);
-            waitingForAck       = false;
-            pendingAckCommand   = -1;
-            pendingAckRequestId = "";
-            ackWaitStartTime    = 0;
+            logf("Received expected acknowledgment for command %d", cmd);
+            metrics.countCommandAcked(index, cmd);
+            if (cmd == SDCP_COMMAND_PAUSE_PRINT)
+            {
+                pauseLatency.markAck(micros());
+            }
+            // The print state is changing, see it land instead of waiting for the next poll
+            statusPollRequested = cmd == SDCP_COMMAND_PAUSE_PRINT ||
+                                  cmd == SDCP_COMMAND_STOP_PRINT ||
+                                  cmd == SDCP_COMMAND_CONTINUE_PRINT;
+            waitingForAck          = false;
+            pendingAckCommand      = -1;
+            pendingAckRequestId[0] = '\0';
+            ackWaitStartTime       = 0;
         }
 
-        // Store mainboard ID if we don't have it yet
-        if (mainboardID.isEmpty() && !mainboardId.isEmpty())
-        {
-            mainboardID = mainboardId;
-            logger.logf("Stored MainboardID: %s", mainboardID.c_str());
-        }
+        storeMainboardID(message);
     }
 }
 
-void ElegooCC::handleStatus(JsonDocument& doc)
+void ElegooCC::handleStatus(const sdcp_message_t& message)
 {
-    JsonObject status      = doc["Status"];
-    String     mainboardId = doc["MainboardID"];
-
-    logger.log("Received status update:");
+    log("Received status update:");
+    lastStatusReceived = millis();
 
     // Parse current status (which contains machine status array)
-    if (status.containsKey("CurrentStatus"))
+    if (message.fields & SDCP_FIELD_CURRENT_STATUS)
     {
-        JsonArray currentStatus = status["CurrentStatus"];
-
-        // Convert JsonArray to int array for machine statuses
-        int statuses[5];  // Max 5 statuses
-        int count = min((int) currentStatus.size(), 5);
-        for (int i = 0; i < count; i++)
-        {
-            statuses[i] = currentStatus[i].as<int>();
-        }
-
         // Set all machine statuses at once
-        setMachineStatuses(statuses, count);
+        setMachineStatuses(message.machineStatuses, message.machineStatusCount);
     }
 
-    // Parse CurrentCoords to extract Z coordinate
-    if (status.containsKey("CurrenCoord"))
+    // Z coordinate from CurrenCoord
+    if (message.fields & SDCP_FIELD_COORD_Z)
     {
-        String coordsStr   = status["CurrenCoord"].as<String>();
-        int    firstComma  = coordsStr.indexOf(',');
-        int    secondComma = coordsStr.indexOf(',', firstComma + 1);
-        if (firstComma != -1 && secondComma != -1)
-        {
-            String zStr = coordsStr.substring(secondComma + 1);
-            currentZ    = zStr.toFloat();
-        }
+        currentZ = message.currentZ;
     }
 
     // Parse print info
-    if (status.containsKey("PrintInfo"))
+    if (message.fields & SDCP_FIELD_PRINT_INFO)
     {
-        JsonObject          printInfo = status["PrintInfo"];
-        sdcp_print_status_t newStatus = printInfo["Status"].as<sdcp_print_status_t>();
+        sdcp_print_status_t newStatus = (sdcp_print_status_t) message.printStatus;
         if (newStatus != printStatus && newStatus == SDCP_PRINT_STATUS_PRINTING)
         {
-            logger.log("Print status changed to printing");
+            log("Print status changed to printing");
             startedAt = millis();
         }
+        if (newStatus != printStatus && newStatus == SDCP_PRINT_STATUS_PAUSED)
+        {
+            pauseLatency.markPaused(micros());
+        }
+
+        // A resume goes back to printing too, only a print after idle/stop/complete is new
+        if (newStatus == SDCP_PRINT_STATUS_PRINTING && !printActive)
+        {
+            printActive = true;
+            pauseLatency.resetPrint();
+            adaptiveTimeout.reset();
+            feedRate.resetPrint();
+        }
+        else if (newStatus == SDCP_PRINT_STATUS_IDLE || newStatus == SDCP_PRINT_STATUS_STOPED ||
+                 newStatus == SDCP_PRINT_STATUS_COMPLETE)
+        {
+            printActive = false;
+        }
         printStatus   = newStatus;
-        currentLayer  = printInfo["CurrentLayer"];
-        totalLayer    = printInfo["TotalLayer"];
-        progress      = printInfo["Progress"];
-        
-        int newTicks = printInfo["CurrentTicks"];
+        currentLayer  = message.currentLayer;
+        totalLayer    = message.totalLayer;
+        progress      = message.progress;
+        feedRate.trackLayer(currentLayer, millis());
+
+        int newTicks = message.currentTicks;
         if (newTicks != currentTicks)
         {
             // Tick changed, update statistics
@@ -229,94 +382,70 @@ void ElegooCC::handleStatus(JsonDocument& doc)
                 // Only calculate time difference if we have a previous valid tick
                 unsigned long timeSinceLastTick = now - lastTickTime;
                 
-                // Update overall statistics
-                totalTickTime += timeSinceLastTick;
-                tickCount++;
-                
-                if (minTickTime == 0 || timeSinceLastTick < minTickTime)
-                {
-                    minTickTime = timeSinceLastTick;
-                }
-                if (timeSinceLastTick > maxTickTime)
-                {
-                    maxTickTime = timeSinceLastTick;
-                }
-                
+                tickStats[TICK_PHASE_ALL].add(timeSinceLastTick);
+
                 // === Per-Phase Tick Statistics Collection ===
                 // Track statistics for three phases to help users tune timeout values:
                 // 1. Start Phase: Early print behavior (within start_print_timeout)
                 // 2. First Layer: Layer 1 behavior (may overlap with start phase)
                 // 3. Later Layers: Subsequent layers after first
                 //
-                // Start phase and first layer can overlap - early ticks on layer 1 
-                // contribute to both statistics. This helps identify if the printer 
+                // Start phase and first layer can overlap - early ticks on layer 1
+                // contribute to both statistics. This helps identify if the printer
                 // behaves differently during initial startup vs. steady-state printing.
-                
+
                 unsigned long timeSinceStart = now - startedAt;
-                bool isStartPhase = timeSinceStart < settingsManager.getStartPrintTimeout();
+                bool isStartPhase = timeSinceStart < (unsigned long) startPrintTimeout;
                 bool isFirstLayer = (currentLayer <= 1);
 
-                // Record start-phase stats if within the initial window
                 if (isStartPhase)
                 {
-                    startTotalTickTime += timeSinceLastTick;
-                    startTickCount++;
-                    if (startMinTickTime == 0 || timeSinceLastTick < startMinTickTime)
-                    {
-                        startMinTickTime = timeSinceLastTick;
-                    }
-                    if (timeSinceLastTick > startMaxTickTime)
-                    {
-                        startMaxTickTime = timeSinceLastTick;
-                    }
-                }
-
-                // Independently track first layer vs later layers
-                if (isFirstLayer)
-                {
-                    firstLayerTotalTickTime += timeSinceLastTick;
-                    firstLayerTickCount++;
-                    if (firstLayerMinTickTime == 0 || timeSinceLastTick < firstLayerMinTickTime)
-                    {
-                        firstLayerMinTickTime = timeSinceLastTick;
-                    }
-                    if (timeSinceLastTick > firstLayerMaxTickTime)
-                    {
-                        firstLayerMaxTickTime = timeSinceLastTick;
-                    }
-                }
-                else
-                {
-                    laterLayersTotalTickTime += timeSinceLastTick;
-                    laterLayersTickCount++;
-                    if (laterLayersMinTickTime == 0 || timeSinceLastTick < laterLayersMinTickTime)
-                    {
-                        laterLayersMinTickTime = timeSinceLastTick;
-                    }
-                    if (timeSinceLastTick > laterLayersMaxTickTime)
-                    {
-                        laterLayersMaxTickTime = timeSinceLastTick;
-                    }
+                    tickStats[TICK_PHASE_START].add(timeSinceLastTick);
                 }
+                tickStats[isFirstLayer ? TICK_PHASE_FIRST_LAYER : TICK_PHASE_LATER_LAYERS].add(
+                    timeSinceLastTick);
             }
             lastTickTime = now;
         }
-        currentTicks = newTicks;
-        totalTicks    = printInfo["TotalTicks"];
-        PrintSpeedPct = printInfo["PrintSpeedPct"];
+        currentTicks  = newTicks;
+        totalTicks    = message.totalTicks;
+        PrintSpeedPct = message.printSpeedPct;
     }
 
     // Store mainboard ID if we don't have it yet (I'm unsure if we actually need this)
-    if (mainboardID.isEmpty() && !mainboardId.isEmpty())
+    storeMainboardID(message);
+}
+
+void ElegooCC::storeMainboardID(const sdcp_message_t& message)
+{
+    if (mainboardID[0] == '\0' && (message.fields & SDCP_FIELD_MAINBOARD_ID) &&
+        message.mainboardId[0] != '\0')
     {
-        mainboardID = mainboardId;
-        logger.logf("Stored MainboardID: %s", mainboardID.c_str());
+        snprintf(mainboardID, sizeof(mainboardID), "%s", message.mainboardId);
+        commandEncoder.setMainboardID(mainboardID);
+        logf("Stored MainboardID: %s", mainboardID);
+
+        // Remembered with the address, to find the printer again if the address changes
+        if (settingsManager.getMainboardID(index) != mainboardID)
+        {
+            settingsManager.setMainboardID(mainboardID, index);
+            settingsManager.save(true);
+        }
     }
 }
 
-void ElegooCC::pausePrint()
+// Counted and timed only once the frame is out
+bool ElegooCC::pausePrint(const pause_request_t& request)
 {
-    sendCommand(SDCP_COMMAND_PAUSE_PRINT, true);
+    if (!writeCommand(SDCP_COMMAND_PAUSE_PRINT, true))
+    {
+        return false;
+    }
+    uint32_t sentMicros = micros();
+    metrics.countPause(index, request.filamentRunout);
+    pauseLatency.begin(request.timing);
+    pauseLatency.markSent(sentMicros);
+    return true;
 }
 
 void ElegooCC::continuePrint()
@@ -328,171 +457,375 @@ void ElegooCC::sendCommand(int command, bool waitForAck)
 {
     if (!webSocket.isConnected())
     {
-        logger.logf("Can't send command, websocket not connected: %d", command);
+        logf("Can't send command, websocket not connected: %d", command);
         return;
     }
 
     // If this command requires an ack and we're already waiting for one, skip it
     if (waitForAck && waitingForAck)
     {
-        logger.logf("Skipping command %d - already waiting for ack from command %d", command,
-                    pendingAckCommand);
+        logf("Skipping command %d - already waiting for ack from command %d", command,
+             pendingAckCommand);
         return;
     }
 
-    uuid.generate();
-    String uuidStr = String(uuid.toCharArray());
-    uuidStr.replace("-", "");  // RequestID doesn't want dashes
-
-    // Get current timestamp
-    unsigned long timestamp   = getTime();
-    String        jsonPayload = "{";
-    jsonPayload += "\"Id\":\"" + uuidStr + "\",";
-    jsonPayload += "\"Data\":{";
-    jsonPayload += "\"Cmd\":" + String(command) + ",";
-    jsonPayload += "\"Data\":{},";
-    jsonPayload += "\"RequestID\":\"" + uuidStr + "\",";
-    jsonPayload += "\"MainboardID\":\"" + mainboardID + "\",";
-    jsonPayload += "\"TimeStamp\":" + String(timestamp) + ",";
-    jsonPayload += "\"From\":2";  // I don't know if this is used, but octoeverywhere sets theirs to
-                                  // 0, and the web client sets it to 1, so we'll choose 2?
-    jsonPayload += "}";
-    jsonPayload += "}";
+    writeCommand(command, waitForAck);
+
+    // Logged after the frame is out, the serial port is slow
+    if (waitForAck)
+    {
+        logf("Waiting for acknowledgment for command %d with request ID %s", command,
+             pendingAckRequestId);
+    }
+}
+
+bool ElegooCC::writeCommand(int command, bool waitForAck)
+{
+    if (!webSocket.isConnected() || (waitForAck && waitingForAck))
+    {
+        return false;
+    }
+
+    size_t length = commandEncoder.encode(command, getTime());
 
     // If this command requires an ack, set the tracking state
     if (waitForAck)
     {
-        waitingForAck       = true;
-        pendingAckCommand   = command;
-        pendingAckRequestId = uuidStr;
-        ackWaitStartTime    = millis();
-        logger.logf("Waiting for acknowledgment for command %d with request ID %s", command,
-                    uuidStr.c_str());
+        waitingForAck     = true;
+        pendingAckCommand = command;
+        memcpy(pendingAckRequestId, commandEncoder.requestId(), SDCP_REQUEST_ID_SIZE);
+        ackWaitStartTime = millis();
     }
 
-    webSocket.sendTXT(jsonPayload);
+    webSocket.sendTXT(commandEncoder.frame(), length);
+    metrics.countCommandSent(index, command);
+    return true;
 }
 
 void ElegooCC::connect()
 {
+    std::lock_guard<std::mutex> guard(socketLock);
     if (webSocket.isConnected())
     {
         webSocket.disconnect();
     }
-    webSocket.setReconnectInterval(3000);
-    ipAddress = settingsManager.getElegooIP();
-    logger.logf("Attempting connection to Elegoo CC @ %s", ipAddress.c_str());
+    webSocket.setReconnectInterval(RECONNECT_INTERVAL_MS);
+    ipAddress         = settingsManager.getElegooIP(index);
+    disconnectedSince = millis();
+    logf("Attempting connection to Elegoo CC @ %s", ipAddress.c_str());
     webSocket.begin(ipAddress, CARBON_CENTAURI_PORT, "/websocket");
 }
 
-void ElegooCC::loop()
+void ElegooCC::refreshSettings()
 {
-    unsigned long currentTime = millis();
+    uint32_t generation = settingsManager.getGeneration();
+    if (generation == settingsGeneration)
+    {
+        return;
+    }
+    settingsGeneration = generation;
+
+    const printer_settings &settings = settingsManager.getPrinterSettings(index);
+    timeout                          = settings.timeout;
+    firstLayerTimeout                = settings.first_layer_timeout;
+    startPrintTimeout                = settings.start_print_timeout;
+    pauseOnRunout                    = settings.pause_on_runout;
+    enabled                          = settings.enabled;
+    adaptiveEnabled                  = settings.adaptive_timeout;
+    adaptiveTimeout.configure(settings.adaptive_quantile, settings.adaptive_margin);
+    feedRate.setMmPerPulse(settings.mm_per_pulse);
 
     // websocket IP changed, reconnect
-    if (ipAddress != settingsManager.getElegooIP())
+    if (ipAddress != settingsManager.getElegooIP(index))
     {
         connect();  // this will reconnnect if already connected
     }
+}
 
+// Looks for the printer by its MainboardID once its address has stopped answering, or for any
+// printer not monitored yet when no address is set. The address found is saved, refreshSettings()
+// then reconnects to it.
+void ElegooCC::rediscover(unsigned long currentTime)
+{
+    if (settingsManager.isAPMode())
+    {
+        return;
+    }
+
+    String mainboardId = settingsManager.getMainboardID(index);
+    String ip;
+    bool   found;
+    if (mainboardId.length() > 0)
+    {
+        found = printerDiscovery.find(mainboardId.c_str(), ip) && ip != ipAddress;
+    }
+    else if (ipAddress.length() == 0)
+    {
+        found = printerDiscovery.findUnclaimed(mainboardId, ip);
+    }
+    else
+    {
+        // Never connected, there is nothing to recognize the printer by
+        return;
+    }
+
+    if (!found)
+    {
+        printerDiscovery.search();
+        return;
+    }
+
+    if (ipAddress.length() == 0)
+    {
+        logf("Found printer %s at %s", mainboardId.c_str(), ip.c_str());
+    }
+    else
+    {
+        logf("Printer %s moved from %s to %s", mainboardId.c_str(), ipAddress.c_str(), ip.c_str());
+    }
+    settingsManager.setElegooIP(ip, index);
+    settingsManager.setMainboardID(mainboardId, index);
+    settingsManager.save(true);
+    disconnectedSince = currentTime;
+}
+
+void ElegooCC::loop()
+{
+    unsigned long currentTime = millis();
+
+    refreshSettings();
+    loopProfiler.lap(LOOP_STAGE_SETTINGS);
+
+    std::unique_lock<std::mutex> socketGuard(socketLock);
     if (webSocket.isConnected())
     {
         // Check for acknowledgment timeout (5 seconds)
         // TODO: need to check the actual requestId
         if (waitingForAck && (currentTime - ackWaitStartTime) >= ACK_TIMEOUT_MS)
         {
-            logger.logf("Acknowledgment timeout for command %d, resetting ack state",
-                        pendingAckCommand);
-            waitingForAck       = false;
-            pendingAckCommand   = -1;
-            pendingAckRequestId = "";
-            ackWaitStartTime    = 0;
+            logf("Acknowledgment timeout for command %d, resetting ack state", pendingAckCommand);
+            metrics.countCommandTimeout(index, pendingAckCommand);
+            waitingForAck          = false;
+            pendingAckCommand      = -1;
+            pendingAckRequestId[0] = '\0';
+            ackWaitStartTime       = 0;
         }
         else if (currentTime - lastPing > 29900)
         {
-            logger.log("Sending Ping");
+            log("Sending Ping");
             // For all who venture to this line of code wondering why I didn't use sendPing(), it's
             // because for some reason that doesn't work. but this does!
             this->webSocket.sendTXT("ping");
             lastPing = currentTime;
         }
+        loopProfiler.lap(LOOP_STAGE_ACK_PING);
 
-        // Proactively request status at ~2.5s intervals to keep stats fresh
-        if (currentTime - lastStatusPoll > 2500)
+        // Proactively request status to keep layer and Z fresh, unless the printer just sent it
+        unsigned long sinceStatus =
+            min(currentTime - lastStatusPoll, currentTime - lastStatusReceived);
+        if (statusPollRequested || sinceStatus >= statusPollInterval(currentTime))
         {
             sendCommand(SDCP_COMMAND_STATUS);
-            lastStatusPoll = currentTime;
+            lastStatusPoll      = currentTime;
+            statusPollRequested = false;
         }
+        loopProfiler.lap(LOOP_STAGE_POLL);
+        disconnectedSince = currentTime;
     }
+    socketGuard.unlock();
 
-    // Before determining if we should pause, check if the filament is moving or it ran out
-    checkFilamentMovement(currentTime);
-    checkFilamentRunout(currentTime);
+    if (currentTime - disconnectedSince >= REDISCOVER_AFTER_ATTEMPTS * RECONNECT_INTERVAL_MS ||
+        ipAddress.length() == 0)
+    {
+        rediscover(currentTime);
+    }
 
-    // Check if we should pause the print
-    if (shouldPausePrint(currentTime))
+    updatePauseGate(currentTime);
+    if (!sensorTaskRunning)
     {
-        logger.log("Pausing print, detected filament runout or stopped");
-        pausePrint();
+        sensorTick(currentTime);
     }
+    handlePauseRequests();
+    loopProfiler.lap(LOOP_STAGE_SENSOR);
 
+    socketGuard.lock();
     webSocket.loop();
+    socketGuard.unlock();
+    loopProfiler.lap(LOOP_STAGE_WEBSOCKET);
 }
 
-void ElegooCC::checkFilamentRunout(unsigned long currentTime)
+// Everything shouldPausePrint() needs from the printer side, evaluated where it is written so the
+// sensor task only reads two atomics
+void ElegooCC::updatePauseGate(unsigned long currentTime)
+{
+    // Use currentLayer as primary indicator for first layer (more reliable than Z).
+    // Fall back to Z if layer info is unavailable.
+    bool isFirstLayer = (currentLayer <= 1) || (currentZ < 0.2);
+    int  configured   = isFirstLayer ? firstLayerTimeout : timeout;
+    int  slot         = AdaptiveTimeout::slotFor(isFirstLayer, PrintSpeedPct);
+    int  limit        = adaptiveEnabled ? adaptiveTimeout.timeoutFor(slot, configured) : configured;
+    bool changed      = limit != movementTimeout;
+
+    movementSlot         = slot;
+    movementTimeoutLimit = configured;
+    movementTimeout      = limit;
+    learnIntervals       = isPrinting();
+
+    bool sendable;
+    {
+        std::lock_guard<std::mutex> guard(socketLock);
+        sendable = webSocket.isConnected() && !waitingForAck;
+    }
+
+    // Don't pause in the first X milliseconds (configurable in settings)
+    // Don't pause if the websocket is not connected (we can't pause anyway if we're not connected)
+    // Don't pause if we're waiting for an ack
+    // Don't pause if we have less than 100t tickets left, the print is probably done
+    // TODO: also add a buffer after pause because sometimes an ack comes before the update
+    bool armed = enabled && currentTime - startedAt >= (unsigned long) startPrintTimeout &&
+                 sendable && isPrinting() && (totalTicks - currentTicks) >= 100;
+    changed    = changed || (armed && !pauseArmed);
+    pauseArmed = armed;
+
+    // A new deadline or a gate that just opened may mean a pause is due now
+    if (changed && sensorWake)
+    {
+        sensorWake->notify();
+    }
+}
+
+// Sends the pauses the sensor task could not, logs why each one was sent and re-arms the request
+void ElegooCC::handlePauseRequests()
+{
+    pause_request_t request;
+    bool            handled = false;
+    while (pauseRequests.pop(request))
+    {
+        if (!request.sent)
+        {
+            std::lock_guard<std::mutex> guard(socketLock);
+            request.sent = pausePrint(request);
+        }
+
+        // log why we paused...
+        logf("Filament runout: %d", request.filamentRunout);
+        logf("Filament runout pause enabled: %d", pauseOnRunout.load());
+        logf("Filament stopped: %d", request.filamentStopped);
+        logf("Time since print start %d", millis() - startedAt);
+        logf("Is Machine status printing?: %d", hasMachineStatus(SDCP_MACHINE_STATUS_PRINTING));
+        logf("Print status: %d", printStatus);
+
+        if (request.sent)
+        {
+            log("Paused print, detected filament runout or stopped");
+        }
+        else
+        {
+            log("Could not pause print, websocket not connected or waiting for an ack");
+        }
+        handled = true;
+    }
+
+    if (handled)
+    {
+        // Waiting for the ack disarms the gate before the sensor task may ask again
+        updatePauseGate(millis());
+        pauseRequested = false;
+    }
+}
+
+void ElegooCC::checkFilamentRunout()
 {
     // The signal output of the switch sensor is at low level when no filament is detected
-    bool newFilamentRunout = digitalRead(FILAMENT_RUNOUT_PIN) == LOW;
+    bool     newFilamentRunout = digitalRead(runoutPin) == LOW;
+    uint32_t now               = micros();
+    if (newFilamentRunout && !filamentRunout)
+    {
+        runoutMicros = now;
+    }
     if (newFilamentRunout != filamentRunout)
     {
-        logger.log(filamentRunout ? "Filament has run out" : "Filament has been detected");
+        runoutChanged = true;
     }
     filamentRunout = newFilamentRunout;
 }
 
-void ElegooCC::checkFilamentMovement(unsigned long currentTime)
+void ElegooCC::checkFilamentMovement()
 {
-    int currentMovementValue = digitalRead(MOVEMENT_SENSOR_PIN);
+    // Seed the movement state on the first pass so the timeout starts from boot
+    if (lastMovementValue == -1)
+    {
+        lastMovementValue = movementSensor.readLevel();
+        lastChangeMicros  = micros();
+    }
 
-    // Use currentLayer as primary indicator for first layer (more reliable than Z).
-    // Fall back to Z if layer info is unavailable.
-    bool isFirstLayer = (currentLayer <= 1) || (currentZ < 0.2);
-    int movementTimeout = isFirstLayer ? settingsManager.getFirstLayerTimeout() : settingsManager.getTimeout();
+    // Drain every edge captured by the ISR since the last pass. The timestamps come from the
+    // interrupt, so a long loop() iteration doesn't delay or hide movement.
+    bool            moved = false;
+    movement_edge_t edge;
+    bool            learning = learnIntervals;
+    while (movementSensor.popEdge(edge))
+    {
+        // Learned even while adaptive timeouts are off, so the numbers are there to look at
+        uint32_t intervalMs = (edge.micros - lastChangeMicros) / 1000;
+        if (learning && intervalValid && intervalMs <= (uint32_t) movementTimeoutLimit.load())
+        {
+            adaptiveTimeout.addInterval(movementSlot, intervalMs);
+        }
+        intervalValid     = learning;
+        lastMovementValue = edge.level;
+        lastChangeMicros  = edge.micros;
+        moved             = true;
+    }
+
+    // If the ring overflowed, edges were dropped but the ISR still recorded the latest one
+    uint32_t overflowCount = movementSensor.getOverflowCount();
+    if (overflowCount != seenOverflowCount)
+    {
+        droppedEdges += overflowCount - seenOverflowCount;
+        seenOverflowCount = overflowCount;
+        lastChangeMicros  = movementSensor.getLastEdgeMicros();
+        intervalValid     = false;
+        moved             = true;
+    }
 
-    // Check if movement sensor value has changed, if the filament is moving, it should change every
-    // so often when it changes, reset the timeout
-    if (currentMovementValue != lastMovementValue)
+    // If the filament is moving, the sensor should change every so often. When it changes,
+    // reset the timeout
+    if (moved)
     {
         if (filamentStopped)
         {
-            logger.log("Filament movement started");
+            movementStarted = true;
         }
-        // Value changed, reset timer and flag
-        lastMovementValue = currentMovementValue;
-        lastChangeTime    = currentTime;
-        filamentStopped   = false;
+        filamentStopped = false;
     }
     else
     {
-        // Value hasn't changed, check if timeout has elapsed
-        if ((currentTime - lastChangeTime) >= movementTimeout && !filamentStopped)
+        // Value hasn't changed, check if timeout has elapsed. There is no timeout until loop() has
+        // published one from the settings.
+        uint32_t      now               = micros();
+        unsigned long sinceLastMovement = (now - lastChangeMicros) / 1000;
+        int           limit             = movementTimeout.load();
+        if (limit > 0 && sinceLastMovement >= (unsigned long) limit && !filamentStopped)
         {
-            logger.logf("Filament movement stopped, last movement detected %dms ago",
-                        currentTime - lastChangeTime);
             filamentStopped = true;  // Prevent repeated printing
+            stoppedMicros   = now;
+            stoppedAfterMs  = sinceLastMovement;
+            stoppedLimit    = limit;
         }
     }
 }
 
-bool ElegooCC::shouldPausePrint(unsigned long currentTime)
+bool ElegooCC::shouldPausePrint()
 {
-    // If pause function is completely disabled, always return false
-    if (!settingsManager.getEnabled())
+    // Printer-side conditions (enabled, connected, printing, past the start window, not waiting
+    // for an ack) are folded into pauseArmed by updatePauseGate()
+    if (!pauseArmed)
     {
         return false;
     }
 
-    if (filamentRunout && !settingsManager.getPauseOnRunout())
+    if (filamentRunout && !pauseOnRunout)
     {
         // if pause on runout is disabled, and filament ran out, skip checking everything else
         // this should let the carbon take care of itself
@@ -500,30 +833,8 @@ bool ElegooCC::shouldPausePrint(unsigned long currentTime)
     }
 
     // Only puase if getPauseOnRunout is enabled and filement runsout or filamentStopped.
-    bool pauseCondition = filamentRunout || filamentStopped;
-
-    // Don't pause in the first X milliseconds (configurable in settings)
-    // Don't pause if the websocket is not connected (we can't pause anyway if we're not connected)
-    // Don't pause if we're waiting for an ack
-    // Don't pause if we have less than 100t tickets left, the print is probably done
-    // TODO: also add a buffer after pause because sometimes an ack comes before the update
-    if (currentTime - startedAt < settingsManager.getStartPrintTimeout() ||
-        !webSocket.isConnected() || waitingForAck || !isPrinting() ||
-        (totalTicks - currentTicks) < 100 || !pauseCondition)
-    {
-        return false;
-    }
-
-    // log why we paused...
-    logger.logf("Pause condition: %d", pauseCondition);
-    logger.logf("Filament runout: %d", filamentRunout);
-    logger.logf("Filament runout pause enabled: %d", settingsManager.getPauseOnRunout());
-    logger.logf("Filament stopped: %d", filamentStopped);
-    logger.logf("Time since print start %d", currentTime - startedAt);
-    logger.logf("Is Machine status printing?: %d", hasMachineStatus(SDCP_MACHINE_STATUS_PRINTING));
-    logger.logf("Print status: %d", printStatus);
-
-    return true;
+    // Why we paused is logged by handlePauseRequests(), which owns the printer state.
+    return filamentRunout || filamentStopped;
 }
 
 bool ElegooCC::isPrinting()
@@ -532,6 +843,35 @@ bool ElegooCC::isPrinting()
            hasMachineStatus(SDCP_MACHINE_STATUS_PRINTING);
 }
 
+// Layer and Z decide between the first layer and the regular movement timeout, so they are polled
+// fast while a print gets going and through the first layer. A pause or stop in progress is
+// polled fast too, to see it land. Without a print there is nothing to time.
+unsigned long ElegooCC::statusPollInterval(unsigned long currentTime)
+{
+    switch (printStatus)
+    {
+        case SDCP_PRINT_STATUS_PAUSING:
+        case SDCP_PRINT_STATUS_STOPPING:
+            return STATUS_POLL_FAST_MS;
+        case SDCP_PRINT_STATUS_PAUSED:
+            return STATUS_POLL_PRINTING_MS;
+        default:
+            break;
+    }
+
+    if (!hasMachineStatus(SDCP_MACHINE_STATUS_PRINTING))
+    {
+        return STATUS_POLL_IDLE_MS;
+    }
+    // Heating, leveling and homing come before printing starts
+    if (printStatus != SDCP_PRINT_STATUS_PRINTING || currentLayer <= 1 ||
+        currentTime - startedAt < (unsigned long) startPrintTimeout)
+    {
+        return STATUS_POLL_FAST_MS;
+    }
+    return STATUS_POLL_PRINTING_MS;
+}
+
 // Helper methods for machine status bitmask
 bool ElegooCC::hasMachineStatus(sdcp_machine_status_t status)
 {
@@ -550,6 +890,17 @@ void ElegooCC::setMachineStatuses(const int* statusArray, int arraySize)
     }
 }
 
+static void summarizeTicks(const StreamingStats<unsigned long>& stats, tick_stats_t& summary)
+{
+    summary.count  = stats.count();
+    summary.avg    = lroundf(stats.mean());
+    summary.min    = stats.min();
+    summary.max    = stats.max();
+    summary.stddev = lroundf(stats.stddev());
+    summary.p50    = lroundf(stats.p50());
+    summary.p95    = lroundf(stats.p95());
+}
+
 // Get current printer information
 printer_info_t ElegooCC::getCurrentInformation()
 {
@@ -557,7 +908,7 @@ printer_info_t ElegooCC::getCurrentInformation()
 
     info.filamentStopped      = filamentStopped;
     info.filamentRunout       = filamentRunout;
-    info.mainboardID          = mainboardID;
+    info.mainboardID          = String(mainboardID);
     info.printStatus          = printStatus;
     info.isPrinting           = isPrinting();
     info.currentLayer         = currentLayer;
@@ -566,54 +917,36 @@ printer_info_t ElegooCC::getCurrentInformation()
     info.currentTicks         = currentTicks;
     info.totalTicks           = totalTicks;
     info.PrintSpeedPct        = PrintSpeedPct;
-    info.isWebsocketConnected = webSocket.isConnected();
     info.currentZ             = currentZ;
-    info.waitingForAck        = waitingForAck;
-    // Overall tick statistics
-    info.avgTimeBetweenTicks  = (tickCount > 0) ? (totalTickTime / tickCount) : 0;
-    info.minTickTime          = minTickTime;
-    info.maxTickTime          = maxTickTime;
-    info.tickSampleCount      = tickCount;
-    // Start phase statistics
-    info.startAvgTickTime     = (startTickCount > 0) ? (startTotalTickTime / startTickCount) : 0;
-    info.startMinTickTime     = startMinTickTime;
-    info.startMaxTickTime     = startMaxTickTime;
-    info.startTickCount       = startTickCount;
-    // First layer statistics
-    info.firstLayerAvgTickTime = (firstLayerTickCount > 0) ? (firstLayerTotalTickTime / firstLayerTickCount) : 0;
-    info.firstLayerMinTickTime = firstLayerMinTickTime;
-    info.firstLayerMaxTickTime = firstLayerMaxTickTime;
-    info.firstLayerTickCount   = firstLayerTickCount;
-    // Later layers statistics
-    info.laterLayersAvgTickTime = (laterLayersTickCount > 0) ? (laterLayersTotalTickTime / laterLayersTickCount) : 0;
-    info.laterLayersMinTickTime = laterLayersMinTickTime;
-    info.laterLayersMaxTickTime = laterLayersMaxTickTime;
-    info.laterLayersTickCount   = laterLayersTickCount;
+    info.movementTimeout      = movementTimeout;
+    // Two decimals, so a decaying rate doesn't count as a status change on every check
+    info.feedRate             = roundf(feedRate.getRate() * 100.0f) / 100.0f;
+    info.feedRateCollapsed    = feedRate.isCollapsed();
+    {
+        std::lock_guard<std::mutex> guard(socketLock);
+        info.isWebsocketConnected = webSocket.isConnected();
+        info.waitingForAck        = waitingForAck;
+    }
+    getTickStats(info.tickStats);
 
     return info;
 }
 
+// stats holds TICK_PHASE_COUNT entries
+void ElegooCC::getTickStats(tick_stats_t* stats)
+{
+    for (int phase = 0; phase < TICK_PHASE_COUNT; phase++)
+    {
+        summarizeTicks(tickStats[phase], stats[phase]);
+    }
+}
+
 void ElegooCC::resetTickStats()
 {
     // Clear all tick-timing related statistics (overall and per-phase); preserve currentTicks values
-    lastTickTime  = 0;
-    totalTickTime = 0;
-    tickCount     = 0;
-    minTickTime   = 0;
-    maxTickTime   = 0;
-
-    startTotalTickTime = 0;
-    startTickCount     = 0;
-    startMinTickTime   = 0;
-    startMaxTickTime   = 0;
-
-    firstLayerTotalTickTime = 0;
-    firstLayerTickCount     = 0;
-    firstLayerMinTickTime   = 0;
-    firstLayerMaxTickTime   = 0;
-
-    laterLayersTotalTickTime = 0;
-    laterLayersTickCount     = 0;
-    laterLayersMinTickTime   = 0;
-    laterLayersMaxTickTime   = 0;
+    lastTickTime = 0;
+    for (int phase = 0; phase < TICK_PHASE_COUNT; phase++)
+    {
+        tickStats[phase].reset();
+    }
 }
\ No newline at end of file
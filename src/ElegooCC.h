@@ -2,21 +2,48 @@
 #define ELEGOOCC_H
 
 #include <Arduino.h>
-#include <ArduinoJson.h>
 #include <WebSocketsClient.h>
 
-#include "UUID.h"
+#include <atomic>
+#include <mutex>
+
+#include "AdaptiveTimeout.h"
+#include "FeedRate.h"
+#include "MovementSensor.h"
+#include "PauseLatency.h"
+#include "PrinterConfig.h"
+#include "SdcpCommand.h"
+#include "SdcpParser.h"
+#include "SensorWake.h"
+#include "SpscRing.h"
+#include "StreamingStats.h"
 
 #define CARBON_CENTAURI_PORT 3030
 
-// Pin definitions - can be overridden via build flags
-#ifndef FILAMENT_RUNOUT_PIN
-#define FILAMENT_RUNOUT_PIN 12
-#endif
+#define RECONNECT_INTERVAL_MS 3000
+// Reconnects that may fail in a row before the printer is looked for at another address
+#define REDISCOVER_AFTER_ATTEMPTS 2
 
-#ifndef MOVEMENT_SENSOR_PIN
-#define MOVEMENT_SENSOR_PIN 13
+// Sensor task: samples the sensors of every printer and decides whether to pause, independent of
+// how long the network side of loop() takes. loop() runs on core 1. It runs when a sensor edge
+// comes in or a movement timeout expires (see SensorWake), and at least every
+// SENSOR_TASK_PERIOD_MS. Started by PrinterManager.
+#ifndef SENSOR_TASK_PERIOD_MS
+#define SENSOR_TASK_PERIOD_MS 20
+#endif
+#ifndef SENSOR_TASK_CORE
+#define SENSOR_TASK_CORE 0
 #endif
+#define SENSOR_TASK_PRIORITY 5  // above loop() (1), below the WiFi stack
+#define SENSOR_TASK_STACK_SIZE 6144  // room for sending the pause command
+
+#define PAUSE_REQUEST_QUEUE_SIZE 4
+
+// Status poll intervals, see ElegooCC::statusPollInterval(). Status the printer pushes on its own
+// puts the next poll off by the same interval.
+#define STATUS_POLL_FAST_MS 1500       // print starting, first layer, pausing or stopping
+#define STATUS_POLL_PRINTING_MS 3000   // printing past the first layer, or paused
+#define STATUS_POLL_IDLE_MS 10000      // no print
 
 // Status codes
 typedef enum
@@ -72,6 +99,45 @@ typedef enum
     SDCP_COMMAND_STOP_FEEDING_MATERIAL = 132,
 } sdcp_command_t;
 
+// Posted by the sensor task when it decides the print should pause
+typedef struct
+{
+    pause_timing_t timing;
+    bool           filamentRunout;
+    bool           filamentStopped;
+    bool           sent;  // written by the sensor task, otherwise left to loop()
+} pause_request_t;
+
+// === Tick Statistics System ===
+// The device tracks time between printer tick changes to help tune timeout settings.
+// Statistics are collected across overlapping phases:
+// - Overall: All ticks throughout the entire print
+// - Start Phase: Ticks within start_print_timeout (e.g., first 30 seconds)
+// - First Layer: Ticks while currentLayer <= 1 (can overlap with start phase)
+// - Later Layers: Ticks after first layer (currentLayer > 1)
+//
+// This allows users to see if different phases need different timeout values.
+typedef enum
+{
+    TICK_PHASE_ALL,
+    TICK_PHASE_START,
+    TICK_PHASE_FIRST_LAYER,
+    TICK_PHASE_LATER_LAYERS,
+    TICK_PHASE_COUNT
+} tick_phase_t;
+
+// Time between ticks in one phase, all in milliseconds and 0 until there are samples
+typedef struct
+{
+    int           count;
+    unsigned long avg;
+    unsigned long min;
+    unsigned long max;
+    unsigned long stddev;
+    unsigned long p50;
+    unsigned long p95;
+} tick_stats_t;
+
 // Struct to hold current printer information
 typedef struct
 {
@@ -89,58 +155,42 @@ typedef struct
     bool                isPrinting;
     float               currentZ;
     bool                waitingForAck;
-    
-    // === Tick Statistics System ===
-    // The device tracks time between printer tick changes to help tune timeout settings.
-    // Statistics are collected across three overlapping phases:
-    // - Overall: All ticks throughout the entire print
-    // - Start Phase: Ticks within start_print_timeout (e.g., first 30 seconds)
-    // - First Layer: Ticks while currentLayer <= 1 (can overlap with start phase)
-    // - Later Layers: Ticks after first layer (currentLayer > 1)
-    //
-    // This allows users to see if different phases need different timeout values.
-    
-    // Overall tick statistics (all phases)
-    unsigned long       avgTimeBetweenTicks;  // Average time in milliseconds
-    unsigned long       minTickTime;          // Minimum time between ticks in milliseconds
-    unsigned long       maxTickTime;          // Maximum time between ticks in milliseconds
-    int                 tickSampleCount;      // Number of tick samples collected
-    
-    // Start phase statistics (within start_print_timeout from print start)
-    unsigned long       startAvgTickTime;     // Average tick time during start phase
-    unsigned long       startMinTickTime;     // Minimum tick time during start phase
-    unsigned long       startMaxTickTime;     // Maximum tick time during start phase
-    int                 startTickCount;       // Number of samples in start phase
-    
-    // First layer statistics (currentLayer <= 1, can overlap with start phase)
-    unsigned long       firstLayerAvgTickTime;  // Average tick time during first layer
-    unsigned long       firstLayerMinTickTime;  // Minimum tick time during first layer
-    unsigned long       firstLayerMaxTickTime;  // Maximum tick time during first layer
-    int                 firstLayerTickCount;    // Number of samples in first layer
-    
-    // Later layers statistics (currentLayer > 1)
-    unsigned long       laterLayersAvgTickTime; // Average tick time after first layer
-    unsigned long       laterLayersMinTickTime; // Minimum tick time after first layer
-    unsigned long       laterLayersMaxTickTime; // Maximum tick time after first layer
-    int                 laterLayersTickCount;   // Number of samples after first layer
+    int                 movementTimeout;  // in use for the current layer, learned or configured
+    float               feedRate;         // smoothed filament feed rate in mm/s
+    bool                feedRateCollapsed;
+    tick_stats_t        tickStats[TICK_PHASE_COUNT];
 } printer_info_t;
 
+// Connection to one printer and the filament sensors attached for it. PrinterManager owns one per
+// monitored printer.
 class ElegooCC
 {
    private:
-    WebSocketsClient webSocket;
-    UUID             uuid;
+    const int     index;  // printer number, selects the settings and labels the metrics
+    const uint8_t runoutPin;
+    const uint8_t movementPin;
+
+    WebSocketsClient   webSocket;
+    SdcpCommandEncoder commandEncoder;
 
-    String ipAddress;
+    String        ipAddress;
+    unsigned long disconnectedSince;  // millis() the connection was last up or last retargeted
 
     unsigned long lastPing;
     unsigned long lastStatusPoll;
+    unsigned long lastStatusReceived;   // millis() of the last status, polled or pushed
+    uint32_t      lastStatusHash;       // hashSdcpPayload() of the last status handled
+    size_t        lastStatusLength;     // and its length
+    bool          haveStatusHash;
+    bool          statusPollRequested;  // a command changed the print state, poll right away
     // Variables to track movement sensor state
-    int           lastMovementValue;  // Initialize to invalid value
-    unsigned long lastChangeTime;
+    MovementSensor movementSensor;
+    int            lastMovementValue;   // Initialize to invalid value
+    uint32_t       lastChangeMicros;    // micros() of the last movement edge
+    uint32_t       seenOverflowCount;   // edge ring overflows already accounted for
 
     // machine/status info
-    String              mainboardID;
+    char                mainboardID[SDCP_MAINBOARD_ID_SIZE];
     sdcp_print_status_t printStatus;
     uint8_t             machineStatusMask;  // Bitmask for active statuses
     int                 currentLayer;
@@ -150,79 +200,173 @@ class ElegooCC
     int                 currentTicks;
     int                 totalTicks;
     int                 PrintSpeedPct;
-    bool                filamentStopped;
-    bool                filamentRunout;
+
+    // Written by the sensor task
+    std::atomic<bool> filamentStopped;
+    std::atomic<bool> filamentRunout;
+    uint32_t          stoppedMicros;  // micros() when the movement timeout was crossed
+    uint32_t          runoutMicros;   // micros() when the runout switch opened
+
+    // Sensor changes seen this tick, logged by sensorTick once any pause has gone out
+    uint32_t      droppedEdges;     // edges lost to a ring overflow
+    bool          movementStarted;  // movement resumed after a stop
+    bool          runoutChanged;    // the runout switch changed state
+    unsigned long stoppedAfterMs;   // gap that crossed the timeout, 0 when it wasn't crossed
+    int           stoppedLimit;     // and the timeout it crossed
+
+    // Printer state that tells a new print from a resumed one
+    bool printActive;
+
+    PauseLatency pauseLatency;
 
     unsigned long startedAt;
 
-    // Tick timing statistics - overall
-    unsigned long lastTickTime;
-    unsigned long totalTickTime;
-    int           tickCount;
-    unsigned long minTickTime;
-    unsigned long maxTickTime;
-
-    // Tick timing statistics - start phase (within start_print_timeout)
-    unsigned long startTotalTickTime;
-    int           startTickCount;
-    unsigned long startMinTickTime;
-    unsigned long startMaxTickTime;
-
-    // Tick timing statistics - first layer (layer <= 1)
-    unsigned long firstLayerTotalTickTime;
-    int           firstLayerTickCount;
-    unsigned long firstLayerMinTickTime;
-    unsigned long firstLayerMaxTickTime;
-
-    // Tick timing statistics - later layers (layer > 1)
-    unsigned long laterLayersTotalTickTime;
-    int           laterLayersTickCount;
-    unsigned long laterLayersMinTickTime;
-    unsigned long laterLayersMaxTickTime;
-
-    // Acknowledgment tracking
+    // Settings read on every loop, refreshed when the settings generation changes
+    uint32_t          settingsGeneration;
+    int               timeout;
+    int               firstLayerTimeout;
+    int               startPrintTimeout;
+    std::atomic<bool> pauseOnRunout;
+    bool              enabled;
+    bool              adaptiveEnabled;
+
+    // Printer-side pause conditions, published by loop() for the sensor task
+    std::atomic<bool> pauseArmed;
+    std::atomic<int>  movementTimeout;       // timeout for the current layer
+    std::atomic<int>  movementTimeoutLimit;  // configured timeout for the current layer
+    std::atomic<int>  movementSlot;          // AdaptiveTimeout slot of the current layer and speed
+    std::atomic<bool> learnIntervals;        // printing, edge intervals are worth learning from
+
+    // Edge intervals learned by the sensor task
+    AdaptiveTimeout adaptiveTimeout;
+    bool            intervalValid;  // the previous edge can start an interval
+
+    // Filament feed rate from the edge count, updated by the sensor task
+    FeedRate feedRate;
+
+    // Pause requests from the sensor task to loop(), which owns the websocket
+    SpscRing<pause_request_t, PAUSE_REQUEST_QUEUE_SIZE> pauseRequests;
+    std::atomic<bool> pauseRequested;  // set until loop() has acted on the queued request
+
+    // Guards webSocket, commandEncoder and the acknowledgment state, so whichever side decides to
+    // pause can write the command at once
+    std::mutex socketLock;
+
+    // Wakes the sensor task on sensor edges and pause gate changes, shared by all printers
+    SensorWake *sensorWake;
+
+    bool sensorTaskRunning;
+
+    // Tick timing statistics, one accumulator per tick_phase_t
+    unsigned long                 lastTickTime;
+    StreamingStats<unsigned long> tickStats[TICK_PHASE_COUNT];
+
+    // Acknowledgment tracking, under socketLock
     bool          waitingForAck;
     int           pendingAckCommand;
-    String        pendingAckRequestId;
+    char          pendingAckRequestId[SDCP_REQUEST_ID_SIZE];
     unsigned long ackWaitStartTime;
 
-    ElegooCC();
-
     // Delete copy constructor and assignment operator
     ElegooCC(const ElegooCC &)            = delete;
     ElegooCC &operator=(const ElegooCC &) = delete;
 
+    // Logger calls, prefixed with the printer when there are several
+    void log(const char *message);
+    void logf(const char *format, ...);
+
     void webSocketEvent(WStype_t type, uint8_t *payload, size_t length);
     void connect();
-    void handleCommandResponse(JsonDocument &doc);
-    void handleStatus(JsonDocument &doc);
+    void refreshSettings();
+    void rediscover(unsigned long currentTime);
+    void handleCommandResponse(const sdcp_message_t &message);
+    void handleStatus(const sdcp_message_t &message);
+    void storeMainboardID(const sdcp_message_t &message);
+    // Callers hold socketLock. writeCommand() doesn't log, so the sensor task can use it, and
+    // returns false when the websocket is down or an ack is still pending.
     void sendCommand(int command, bool waitForAck = false);
-    void pausePrint();
+    bool writeCommand(int command, bool waitForAck);
+    bool pausePrint(const pause_request_t &request);
     void continuePrint();
 
     // Helper methods for machine status bitmask
     bool hasMachineStatus(sdcp_machine_status_t status);
     void setMachineStatuses(const int *statusArray, int arraySize);
-    bool isPrinting();
-    bool shouldPausePrint(unsigned long currentTime);
-    void checkFilamentMovement(unsigned long currentTime);
-    void checkFilamentRunout(unsigned long currentTime);
+    bool shouldPausePrint();
+    void checkFilamentMovement();
+    void checkFilamentRunout();
+    void logSensorChanges();
+
+    // Sensor side
+    bool        sendPause(const pause_request_t &request);
+    static void IRAM_ATTR onRunoutEdge(void *arg);
+
+    // Network side, called from loop()
+    unsigned long statusPollInterval(unsigned long currentTime);
+    void          updatePauseGate(unsigned long currentTime);
+    void          handlePauseRequests();
 
    public:
-    // Singleton access method
-    static ElegooCC &getInstance();
+    ElegooCC(int printer, uint8_t runoutSensorPin, uint8_t movementSensorPin);
+
+    int getIndex() const
+    {
+        return index;
+    }
 
     void setup();
     void loop();
 
+    // Attach the sensor interrupts, which wake the sensor task through wake. Called once from
+    // setup() before networking starts.
+    void beginSensors(SensorWake *wake);
+
+    // Samples the sensors and sends a pause when one is due. Runs on the sensor task once it is
+    // running and from loop() before that.
+    void sensorTick(unsigned long currentTime);
+    void setSensorTaskRunning(bool running);
+
+    // Close the pause gate while loop() is not running, it reopens on the next loop()
+    void disarm();
+
+    // micros() at which the movement timeout runs out, false when movement has already stopped
+    bool getMovementDeadline(uint32_t &atMicros);
+
     // Get current printer information
     printer_info_t getCurrentInformation();
 
+    // Single fields of the above, for readers that don't need the whole copy
+    bool isPrinting();
+    bool isFilamentStopped() const
+    {
+        return filamentStopped;
+    }
+    bool isFilamentRunout() const
+    {
+        return filamentRunout;
+    }
+    void getTickStats(tick_stats_t *stats);
+
+    // Stage-by-stage latency of the pauses sent to the printer
+    PauseLatency &getPauseLatency()
+    {
+        return pauseLatency;
+    }
+
+    // Movement timeouts learned from the sensor
+    AdaptiveTimeout &getAdaptiveTimeout()
+    {
+        return adaptiveTimeout;
+    }
+
+    // Filament feed rate and the per-layer record
+    FeedRate &getFeedRate()
+    {
+        return feedRate;
+    }
+
     // Reset device-side tick timing statistics (all phases)
     void resetTickStats();  // Resets all tick statistics (overall + all three phases)
 };
 
-// Convenience macro for easier access
-#define elegooCC ElegooCC::getInstance()
-
 #endif  // ELEGOOCC_H
@@ -0,0 +1,193 @@
+#include "FeedRate.h"
+
+#include "Logger.h"
+
+FeedRate::FeedRate()
+{
+    started           = false;
+    lastEdgeCount     = 0;
+    lastUpdateMs      = 0;
+    lastEdgeMs        = 0;
+    instant           = 0;
+    rate              = 0;
+    baseline          = 0;
+    belowSince        = 0;
+    mmPerPulse        = 2.88f;
+    publishedRate     = 0;
+    publishedBaseline = 0;
+    collapsed         = false;
+    edgesSeen         = 0;
+    printStartEdges   = 0;
+    trackedLayer      = 0;
+    layerStartEdges   = 0;
+    layerStartMs      = 0;
+    layerHead         = 0;
+    layerCount        = 0;
+}
+
+void FeedRate::setMmPerPulse(float mm)
+{
+    mmPerPulse = mm;
+}
+
+float FeedRate::getMmPerPulse()
+{
+    return mmPerPulse;
+}
+
+void FeedRate::update(unsigned long nowMs, uint32_t edgeCount, bool printing)
+{
+    if (!started)
+    {
+        started       = true;
+        lastEdgeCount = edgeCount;
+        lastUpdateMs  = nowMs;
+        lastEdgeMs    = nowMs;
+        return;
+    }
+    unsigned long dt = nowMs - lastUpdateMs;
+    if (dt == 0)
+    {
+        return;
+    }
+    uint32_t newEdges = edgeCount - lastEdgeCount;
+    lastEdgeCount     = edgeCount;
+    lastUpdateMs      = nowMs;
+    edgesSeen         = edgesSeen + newEdges;
+
+    // The rate between the last two edges, and while none comes at most one pulse over the time
+    // since the last one. That is steady between the edges of a slow feed and still falls off
+    // when the filament stops.
+    unsigned long sinceEdge = nowMs - lastEdgeMs;
+    if (newEdges > 0)
+    {
+        instant    = newEdges * mmPerPulse.load() * 1000.0f / sinceEdge;
+        lastEdgeMs = nowMs;
+    }
+    else
+    {
+        float bound = mmPerPulse.load() * 1000.0f / sinceEdge;
+        if (bound < instant)
+        {
+            instant = bound;
+        }
+    }
+
+    // Time based EWMA, so a late sensor tick weighs as much as the ticks it replaced
+    rate += (instant - rate) * dt / (FEED_RATE_TAU_MS + dt);
+    publishedRate = rate;
+
+    if (!printing)
+    {
+        // A pause or a new print learns the baseline again
+        baseline          = 0;
+        belowSince        = 0;
+        publishedBaseline = 0;
+        collapsed         = false;
+        return;
+    }
+
+    if (rate >= baseline * FEED_RATE_COLLAPSE_RATIO)
+    {
+        // Only healthy flow moves the baseline, a clog must not become the new normal
+        baseline += (rate - baseline) * dt / (FEED_RATE_BASELINE_TAU_MS + dt);
+        publishedBaseline = baseline;
+        belowSince        = 0;
+        if (collapsed)
+        {
+            logger.logf("Feed rate recovered, %.2f mm/s", rate);
+            collapsed = false;
+        }
+        return;
+    }
+
+    if (baseline < FEED_RATE_MIN_BASELINE)
+    {
+        return;
+    }
+    if (belowSince == 0)
+    {
+        belowSince = nowMs;
+    }
+    else if (!collapsed && nowMs - belowSince >= FEED_RATE_COLLAPSE_HOLD_MS)
+    {
+        logger.logf("Feed rate collapsed, %.2f mm/s against a baseline of %.2f mm/s", rate,
+                    baseline);
+        collapsed = true;
+    }
+}
+
+void FeedRate::trackLayer(int layer, unsigned long nowMs)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (layer == trackedLayer)
+    {
+        return;
+    }
+
+    uint32_t edges = edgesSeen;
+    if (trackedLayer > 0)
+    {
+        feed_rate_layer_t &entry = layers[layerHead];
+        entry.layer              = trackedLayer;
+        entry.mm                 = (edges - layerStartEdges) * mmPerPulse.load();
+        entry.ms                 = nowMs - layerStartMs;
+        entry.avgMmS             = entry.ms > 0 ? entry.mm * 1000.0f / entry.ms : 0.0f;
+        layerHead                = (layerHead + 1) % FEED_RATE_LAYER_HISTORY;
+        if (layerCount < FEED_RATE_LAYER_HISTORY)
+        {
+            layerCount++;
+        }
+    }
+    trackedLayer    = layer;
+    layerStartEdges = edges;
+    layerStartMs    = nowMs;
+}
+
+void FeedRate::resetPrint()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    printStartEdges = edgesSeen;
+    trackedLayer    = 0;
+    layerHead       = 0;
+    layerCount      = 0;
+}
+
+float FeedRate::getRate()
+{
+    return publishedRate;
+}
+
+float FeedRate::getBaseline()
+{
+    return publishedBaseline;
+}
+
+bool FeedRate::isCollapsed()
+{
+    return collapsed;
+}
+
+void FeedRate::toJson(JsonDocument &doc)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    doc["rate_mm_s"]     = publishedRate.load();
+    doc["baseline_mm_s"] = publishedBaseline.load();
+    doc["collapsed"]     = collapsed.load();
+    doc["mm_per_pulse"]  = mmPerPulse.load();
+    doc["print_mm"]      = (edgesSeen - printStartEdges) * mmPerPulse.load();
+
+    JsonArray out = doc.createNestedArray("layers");
+    for (int i = 0; i < layerCount; i++)
+    {
+        int index =
+            (layerHead - layerCount + i + FEED_RATE_LAYER_HISTORY) % FEED_RATE_LAYER_HISTORY;
+        const feed_rate_layer_t &entry = layers[index];
+        JsonObject               layer = out.createNestedObject();
+        layer["layer"]                 = entry.layer;
+        layer["mm"]                    = entry.mm;
+        layer["ms"]                    = entry.ms;
+        layer["avg_mm_s"]              = entry.avgMmS;
+    }
+}
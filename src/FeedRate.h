@@ -0,0 +1,98 @@
+#ifndef FEED_RATE_H
+#define FEED_RATE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include <atomic>
+#include <mutex>
+
+// Time constant of the live feed rate
+#define FEED_RATE_TAU_MS 2000
+// Time constant of the baseline the live rate is compared against
+#define FEED_RATE_BASELINE_TAU_MS 60000
+
+// Feed rate below this fraction of the baseline for FEED_RATE_COLLAPSE_HOLD_MS is flagged as a
+// collapse, e.g. a partial clog or a grinding extruder. Long enough to ride out travel moves and
+// layer changes.
+#define FEED_RATE_COLLAPSE_RATIO 0.35f
+#define FEED_RATE_COLLAPSE_HOLD_MS 5000
+// No collapse is flagged until the baseline has reached this, in mm/s
+#define FEED_RATE_MIN_BASELINE 0.3f
+
+// Layers kept in the per-layer record
+#define FEED_RATE_LAYER_HISTORY 32
+
+// Capacity needed by FeedRate::toJson()
+#define FEED_RATE_JSON_SIZE                                          \
+    (JSON_OBJECT_SIZE(6) + JSON_ARRAY_SIZE(FEED_RATE_LAYER_HISTORY) + \
+     FEED_RATE_LAYER_HISTORY * JSON_OBJECT_SIZE(4))
+
+typedef struct
+{
+    int      layer;
+    float    mm;      // filament fed during the layer
+    uint32_t ms;      // time spent on the layer
+    float    avgMmS;  // mm over ms, in mm/s
+} feed_rate_layer_t;
+
+// Turns movement sensor edges into a filament feed rate. Each edge is a fixed length of filament,
+// so the time between edges gives the rate; it is smoothed with a time based EWMA. A slower EWMA
+// taken while the flow is healthy is the baseline a collapse is measured against. The sensor task
+// calls update(), loop() calls trackLayer() and resetPrint(), the rest may be read from anywhere.
+class FeedRate
+{
+   private:
+    // Sensor task only
+    bool          started;
+    uint32_t      lastEdgeCount;
+    unsigned long lastUpdateMs;
+    unsigned long lastEdgeMs;
+    float         instant;  // unsmoothed rate from the edge timing
+    float         rate;
+    float         baseline;
+    unsigned long belowSince;  // 0 while the rate is not below the collapse threshold
+
+    std::atomic<float>    mmPerPulse;
+    std::atomic<float>    publishedRate;
+    std::atomic<float>    publishedBaseline;
+    std::atomic<bool>     collapsed;
+    std::atomic<uint32_t> edgesSeen;  // edges counted by update() since boot
+
+    // Per-layer record, written by loop()
+    std::mutex        lock;
+    uint32_t          printStartEdges;
+    int               trackedLayer;  // 0 while no layer is open
+    uint32_t          layerStartEdges;
+    unsigned long     layerStartMs;
+    feed_rate_layer_t layers[FEED_RATE_LAYER_HISTORY];
+    int               layerHead;  // next slot to write
+    int               layerCount;
+
+   public:
+    FeedRate();
+
+    void  setMmPerPulse(float mm);
+    float getMmPerPulse();
+
+    // Sensor task: edgeCount is the sensor's running edge count, which stays exact when the edge
+    // ring overflows. The baseline and the collapse flag only live while printing.
+    void update(unsigned long nowMs, uint32_t edgeCount, bool printing);
+
+    // loop(): closes the open layer into the record when the printer reports another one
+    void trackLayer(int layer, unsigned long nowMs);
+
+    // loop(): forgets the per-layer record, called when a new print starts
+    void resetPrint();
+
+    // Smoothed feed rate and its baseline in mm/s
+    float getRate();
+    float getBaseline();
+    bool  isCollapsed();
+
+    // {"rate_mm_s":..,"baseline_mm_s":..,"collapsed":..,"mm_per_pulse":..,"print_mm":..,
+    // "layers":[{"layer","mm","ms","avg_mm_s"},...]}, oldest layer first
+    void toJson(JsonDocument &doc);
+};
+
+#endif  // FEED_RATE_H
@@ -0,0 +1,218 @@
+#include "LogSegments.h"
+
+#include <LittleFS.h>
+
+#define LOG_SEGMENT_HEAD LOG_SEGMENT_DIR "/head"
+
+static void segmentPath(uint32_t generation, char *path, size_t size)
+{
+    snprintf(path, size, LOG_SEGMENT_DIR "/%lu.log", (unsigned long) (generation % LOG_SEGMENT_COUNT));
+}
+
+LogSegments::LogSegments()
+{
+    enabled       = false;
+    requested     = false;
+    opened        = false;
+    stagedLength  = 0;
+    activeBuffer  = 0;
+    droppedLines  = 0;
+    generation    = 0;
+    segmentLength = 0;
+    lastFlush     = 0;
+}
+
+// Called from web handlers too, so the file I/O is left to flush() on the main loop
+void LogSegments::setEnabled(bool enable)
+{
+    requested = enable;
+}
+
+// Carries out a setEnabled() change. Returns true when persistence was just turned off, the lines
+// staged until then still have to be written.
+bool LogSegments::applyEnabled()
+{
+    bool enable = requested;
+    if (enable == enabled)
+    {
+        return false;
+    }
+    if (enable && !opened)
+    {
+        std::lock_guard<std::mutex> guard(fileLock);
+        open();
+    }
+    enabled = enable;
+    return !enable;
+}
+
+void LogSegments::stage(uint32_t seq, uint32_t timestamp, const char *message, size_t length)
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    char  *buffer = staging[activeBuffer];
+    size_t space  = LOG_STAGING_SIZE - stagedLength;
+    int    prefix = snprintf(buffer + stagedLength, space, "%lu\t%lu\t", (unsigned long) seq,
+                             (unsigned long) timestamp);
+    if (prefix < 0 || (size_t) prefix + length + 1 >= space)
+    {
+        droppedLines++;
+        return;
+    }
+
+    size_t position = stagedLength + prefix;
+    for (size_t i = 0; i < length; i++)
+    {
+        char c             = message[i];
+        buffer[position++] = (c == '\n' || c == '\r' || c == '\t') ? ' ' : c;
+    }
+    buffer[position++] = '\n';
+    stagedLength       = position;
+}
+
+void LogSegments::open()
+{
+    LittleFS.mkdir(LOG_SEGMENT_DIR);
+
+    // Continue the newest segment from the last boot
+    File head = LittleFS.open(LOG_SEGMENT_HEAD, "r");
+    if (head)
+    {
+        generation = head.readString().toInt();
+        head.close();
+    }
+
+    char path[32];
+    segmentPath(generation, path, sizeof(path));
+    File segment  = LittleFS.open(path, "r");
+    segmentLength = segment ? segment.size() : 0;
+    if (segment)
+    {
+        segment.close();
+    }
+    opened = true;
+}
+
+void LogSegments::writeHead()
+{
+    File head = LittleFS.open(LOG_SEGMENT_HEAD, "w");
+    if (head)
+    {
+        head.print(String(generation));
+        head.close();
+    }
+}
+
+void LogSegments::rotate()
+{
+    generation++;
+    segmentLength = 0;
+
+    // The slot being reused holds the oldest segment
+    char path[32];
+    segmentPath(generation, path, sizeof(path));
+    LittleFS.remove(path);
+    writeHead();
+}
+
+void LogSegments::flush(bool force)
+{
+    bool disabled = applyEnabled();
+    force         = force || disabled;
+
+    unsigned long currentTime = millis();
+    if ((!enabled && !disabled) || stagedLength == 0 ||
+        (!force && stagedLength < LOG_FLUSH_THRESHOLD &&
+         currentTime - lastFlush < LOG_FLUSH_INTERVAL_MS))
+    {
+        return;
+    }
+    lastFlush = currentTime;
+
+    // Hand the filled buffer over and let logging continue into the other one
+    char  *buffer;
+    size_t length;
+    int    dropped;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        buffer       = staging[activeBuffer];
+        length       = stagedLength;
+        dropped      = droppedLines;
+        activeBuffer = 1 - activeBuffer;
+        stagedLength = 0;
+        droppedLines = 0;
+    }
+
+    // Page readers wait until the oldest segment is gone and the new data is written
+    std::lock_guard<std::mutex> guard(fileLock);
+    if (segmentLength + length > LOG_SEGMENT_SIZE)
+    {
+        rotate();
+    }
+
+    char path[32];
+    segmentPath(generation, path, sizeof(path));
+    File segment = LittleFS.open(path, "a");
+    if (!segment)
+    {
+        return;
+    }
+    segmentLength += segment.write((const uint8_t *) buffer, length);
+    if (dropped > 0)
+    {
+        char note[48];
+        int  noteLength = snprintf(note, sizeof(note), "0\t0\t%d log lines dropped\n", dropped);
+        segmentLength += segment.write((const uint8_t *) note, noteLength);
+    }
+    segment.close();
+}
+
+int LogSegments::getPageCount()
+{
+    std::lock_guard<std::mutex> guard(fileLock);
+    if (!opened)
+    {
+        return 0;
+    }
+    return generation + 1 < LOG_SEGMENT_COUNT ? generation + 1 : LOG_SEGMENT_COUNT;
+}
+
+bool LogSegments::findPage(int page, uint32_t &pageGeneration)
+{
+    std::lock_guard<std::mutex> guard(fileLock);
+    if (!opened || page < 0 || page >= LOG_SEGMENT_COUNT || (uint32_t) page > generation)
+    {
+        return false;
+    }
+    pageGeneration = generation - page;
+
+    char path[32];
+    segmentPath(pageGeneration, path, sizeof(path));
+    return LittleFS.exists(path);
+}
+
+size_t LogSegments::readPage(uint32_t pageGeneration, size_t offset, uint8_t *buffer, size_t size)
+{
+    std::lock_guard<std::mutex> guard(fileLock);
+    if (generation - pageGeneration >= LOG_SEGMENT_COUNT)
+    {
+        return 0;
+    }
+
+    // Opened for each piece, so no handle is left on a segment between them
+    char path[32];
+    segmentPath(pageGeneration, path, sizeof(path));
+    File segment = LittleFS.open(path, "r");
+    if (!segment)
+    {
+        return 0;
+    }
+    size_t length = segment.seek(offset) ? segment.read(buffer, size) : 0;
+    segment.close();
+    return length;
+}
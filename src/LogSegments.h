@@ -0,0 +1,72 @@
+#ifndef LOG_SEGMENTS_H
+#define LOG_SEGMENTS_H
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <mutex>
+
+// Persistent log layout: LOG_SEGMENT_COUNT files of up to LOG_SEGMENT_SIZE bytes, used in turn
+#define LOG_SEGMENT_DIR "/logs"
+#define LOG_SEGMENT_COUNT 4
+#define LOG_SEGMENT_SIZE (16 * 1024)
+
+// Lines are staged in RAM and written out once this much is waiting or the interval passes
+#define LOG_STAGING_SIZE 2048
+#define LOG_FLUSH_THRESHOLD 1024
+#define LOG_FLUSH_INTERVAL_MS 5000
+
+// Optional on-flash copy of the log. stage() only copies into RAM, so logging never waits on
+// flash; flush() does the file I/O and is called from the main loop. setEnabled() may be called
+// from any task, flush() carries the change out. Pages are read back from web handlers under
+// fileLock, so they never see a segment while it is being rotated out.
+//
+// Each line is "<seq>\t<timestamp>\t<message>\n". Segments are numbered by a generation that
+// only increases; generation g lives in LOG_SEGMENT_DIR/<g % LOG_SEGMENT_COUNT>.log and the
+// current generation is kept in LOG_SEGMENT_DIR/head.
+class LogSegments
+{
+   private:
+    std::mutex        lock;       // staging buffers
+    std::mutex        fileLock;   // segment files, opened and generation
+    std::atomic<bool> enabled;    // lines are staged
+    std::atomic<bool> requested;  // set by setEnabled(), applied by flush()
+    bool              opened;
+
+    char   staging[2][LOG_STAGING_SIZE];
+    size_t stagedLength;
+    int    activeBuffer;
+    int    droppedLines;
+
+    uint32_t      generation;
+    size_t        segmentLength;
+    unsigned long lastFlush;
+
+    bool applyEnabled();
+    void open();
+    void rotate();
+    void writeHead();
+
+   public:
+    LogSegments();
+
+    void setEnabled(bool enable);
+    bool isEnabled() const { return enabled; }
+
+    // Copies one log line into the staging buffer, dropping it if the buffer is full
+    void stage(uint32_t seq, uint32_t timestamp, const char *message, size_t length);
+
+    // Writes staged lines out when due, or always when force is set
+    void flush(bool force = false);
+
+    // Generation of a stored segment, page 0 being the one currently written. False if there is
+    // none.
+    bool findPage(int page, uint32_t &pageGeneration);
+    int  getPageCount();
+
+    // Reads the segment findPage() returned from offset on, returns 0 at its end or once its
+    // slot has been reused for a newer segment
+    size_t readPage(uint32_t pageGeneration, size_t offset, uint8_t *buffer, size_t size);
+};
+
+#endif  // LOG_SEGMENTS_H
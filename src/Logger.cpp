@@ -12,39 +12,95 @@ Logger &Logger::getInstance()
 
 Logger::Logger()
 {
-  currentIndex = 0;
+  head = 0;
+  tail = 0;
   totalEntries = 0;
-  uuidGenerator.generate();
+  nextSeq = 1;
+}
+
+LogRecordHeader Logger::readHeader(size_t offset)
+{
+  LogRecordHeader header;
+  memcpy(&header, arena + offset, sizeof(header));
+  return header;
+}
+
+size_t Logger::recordSize(size_t length)
+{
+  return sizeof(LogRecordHeader) + length + 1;
+}
+
+void Logger::evictOldest()
+{
+  LogRecordHeader header = readHeader(head);
+  head += recordSize(header.length);
+  totalEntries--;
+
+  // Follow the writer back to the start of the arena
+  if (head + sizeof(LogRecordHeader) > LOG_ARENA_SIZE || (totalEntries > 0 && readHeader(head).length == LOG_WRAP_MARKER))
+  {
+    head = 0;
+  }
 }
 
 void Logger::log(const String &message)
+{
+  log(message.c_str());
+}
+
+void Logger::log(const char *message)
 {
   // Print to serial first
   Serial.println(message);
 
-  // Generate UUID for this log entry
-  uuidGenerator.generate();
-  String uuid = String(uuidGenerator.toCharArray());
-
   // Get current timestamp
   unsigned long timestamp = getTime();
 
-  // Store in circular buffer
-  logBuffer[currentIndex].uuid = uuid;
-  logBuffer[currentIndex].timestamp = timestamp;
-  logBuffer[currentIndex].message = message;
+  size_t length = strlen(message);
+  if (length > LOG_MAX_MESSAGE_LENGTH)
+  {
+    length = LOG_MAX_MESSAGE_LENGTH;
+  }
+  size_t size = recordSize(length);
 
-  // Update indices
-  currentIndex = (currentIndex + 1) % MAX_LOG_ENTRIES;
-  if (totalEntries < MAX_LOG_ENTRIES)
+  std::lock_guard<std::mutex> guard(lock);
+
+  if (totalEntries == 0)
   {
-    totalEntries++;
+    head = 0;
+    tail = 0;
   }
-}
 
-void Logger::log(const char *message)
-{
-  log(String(message));
+  // Records never straddle the end of the arena. Drop whatever is still stored past the write
+  // position, leave a marker so readers know to wrap, and continue from the start.
+  if (tail + size > LOG_ARENA_SIZE)
+  {
+    while (totalEntries > 0 && head >= tail)
+    {
+      evictOldest();
+    }
+    if (tail + sizeof(LogRecordHeader) <= LOG_ARENA_SIZE)
+    {
+      LogRecordHeader marker = {0, 0, LOG_WRAP_MARKER};
+      memcpy(arena + tail, &marker, sizeof(marker));
+    }
+    tail = 0;
+  }
+
+  // Make room by dropping the oldest records that overlap the new one
+  while (totalEntries > 0 && head >= tail && head < tail + size)
+  {
+    evictOldest();
+  }
+
+  LogRecordHeader header = {nextSeq++, (uint32_t)timestamp, (uint16_t)length};
+  memcpy(arena + tail, &header, sizeof(header));
+  memcpy(arena + tail + sizeof(header), message, length);
+  arena[tail + sizeof(header) + length] = '\0';
+  tail += size;
+  totalEntries++;
+
+  segments.stage(header.seq, header.timestamp, message, length);
 }
 
 void Logger::logf(const char *format, ...)
@@ -54,48 +110,174 @@ void Logger::logf(const char *format, ...)
   va_start(args, format);
   vsnprintf(buffer, sizeof(buffer), format, args);
   va_end(args);
-  log(String(buffer));
+  log(buffer);
 }
 
-String Logger::getLogsAsJson()
+bool Logger::findRecord(uint32_t seq, size_t &offset, LogRecordHeader &header)
 {
-  DynamicJsonDocument jsonDoc(8192); // Allocate enough space for logs
-  JsonArray logsArray = jsonDoc.createNestedArray("logs");
+  // Sequence numbers are consecutive, so the record is at most totalEntries steps from the oldest
+  offset = head;
+  for (int i = 0; i < totalEntries; i++)
+  {
+    header = readHeader(offset);
+    if (header.length == LOG_WRAP_MARKER)
+    {
+      offset = 0;
+      header = readHeader(offset);
+    }
+    if (header.seq >= seq)
+    {
+      return true;
+    }
+    offset += recordSize(header.length);
+    if (offset + sizeof(LogRecordHeader) > LOG_ARENA_SIZE)
+    {
+      offset = 0;
+    }
+  }
+  return false;
+}
 
-  // If we have less than MAX_LOG_ENTRIES, start from 0
-  // Otherwise, start from currentIndex (oldest entry)
-  int startIndex = (totalEntries < MAX_LOG_ENTRIES) ? 0 : currentIndex;
-  int count = totalEntries;
+// Records never move once written, so the one after the last record streamed stays where it was
+// until it is evicted. Only then does the stream look it up again from the oldest record.
+bool Logger::findNextRecord(const LogStreamState &state, size_t &offset, LogRecordHeader &header)
+{
+  uint32_t oldestSeq = nextSeq - totalEntries;
+  if (!state.hasOffset || state.nextSeq < oldestSeq || state.nextSeq >= nextSeq)
+  {
+    return findRecord(state.nextSeq, offset, header);
+  }
 
-  for (int i = 0; i < count; i++)
+  offset = state.nextOffset;
+  if (offset + sizeof(LogRecordHeader) > LOG_ARENA_SIZE || readHeader(offset).length == LOG_WRAP_MARKER)
   {
-    int bufferIndex = (startIndex + i) % MAX_LOG_ENTRIES;
+    offset = 0;
+  }
+  header = readHeader(offset);
+  return true;
+}
+
+size_t Logger::renderRecord(char *out, size_t offset, const LogRecordHeader &header, bool first)
+{
+  size_t length = snprintf(out, LOG_STREAM_ENTRY_SIZE, "%s{\"seq\":%lu,\"timestamp\":%lu,\"message\":\"",
+                           first ? "" : ",", (unsigned long)header.seq, (unsigned long)header.timestamp);
 
-    JsonObject logEntry = logsArray.createNestedObject();
-    logEntry["uuid"] = logBuffer[bufferIndex].uuid;
-    logEntry["timestamp"] = logBuffer[bufferIndex].timestamp;
-    logEntry["message"] = logBuffer[bufferIndex].message;
+  const char *message = (const char *)(arena + offset + sizeof(header));
+  for (uint16_t i = 0; i < header.length; i++)
+  {
+    char c = message[i];
+    if (c == '"' || c == '\\')
+    {
+      out[length++] = '\\';
+    }
+    else if (c == '\n' || c == '\r' || c == '\t')
+    {
+      out[length++] = '\\';
+      c = c == '\n' ? 'n' : (c == '\r' ? 'r' : 't');
+    }
+    else if ((unsigned char)c < 0x20)
+    {
+      c = ' ';
+    }
+    out[length++] = c;
   }
+  out[length++] = '"';
+  out[length++] = '}';
+  return length;
+}
 
-  String jsonResponse;
-  serializeJson(jsonDoc, jsonResponse);
-  return jsonResponse;
+void Logger::beginLogStream(LogStreamState &state, uint32_t since)
+{
+  state.nextSeq = since + 1;
+  state.lastSeq = 0;
+  state.nextOffset = 0;
+  state.hasOffset = false;
+  state.phase = 0;
+  state.pendingLength = 0;
+  state.pendingOffset = 0;
 }
 
-void Logger::clearLogs()
+size_t Logger::streamLogsJson(LogStreamState &state, uint8_t *buffer, size_t maxLength)
 {
-  currentIndex = 0;
-  totalEntries = 0;
-  // Clear the buffer
-  for (int i = 0; i < MAX_LOG_ENTRIES; i++)
+  std::lock_guard<std::mutex> guard(lock);
+
+  size_t written = 0;
+  while (written < maxLength)
   {
-    logBuffer[i].uuid = "";
-    logBuffer[i].timestamp = 0;
-    logBuffer[i].message = "";
+    // Copy out whatever is left of the current piece
+    if (state.pendingOffset < state.pendingLength)
+    {
+      size_t count = min(state.pendingLength - state.pendingOffset, maxLength - written);
+      memcpy(buffer + written, state.pending + state.pendingOffset, count);
+      state.pendingOffset += count;
+      written += count;
+      continue;
+    }
+    state.pendingOffset = 0;
+    state.pendingLength = 0;
+
+    if (state.phase == 0)
+    {
+      // Header; "latest" lets the client notice the sequence restarting after a reboot
+      state.lastSeq = nextSeq - 1;
+      state.pendingLength = snprintf(state.pending, sizeof(state.pending), "{\"latest\":%lu,\"logs\":[",
+                                     (unsigned long)state.lastSeq);
+      state.phase = 1;
+      continue;
+    }
+    if (state.phase == 1 || state.phase == 2)
+    {
+      // Phase 1 until the first record has been written, so later ones get a separator
+      size_t offset;
+      LogRecordHeader header;
+      if (state.nextSeq <= state.lastSeq && findNextRecord(state, offset, header) &&
+          header.seq <= state.lastSeq)
+      {
+        state.pendingLength = renderRecord(state.pending, offset, header, state.phase == 1);
+        state.nextSeq = header.seq + 1;
+        state.nextOffset = offset + recordSize(header.length);
+        state.hasOffset = true;
+        state.phase = 2;
+        continue;
+      }
+      state.pendingLength = snprintf(state.pending, sizeof(state.pending), "]}");
+      state.phase = 3;
+      continue;
+    }
+    break;
   }
+  return written;
+}
+
+void Logger::setPersistent(bool persistent)
+{
+  segments.setEnabled(persistent);
+}
+
+bool Logger::findPersistedPage(int page, uint32_t &generation)
+{
+  return segments.findPage(page, generation);
+}
+
+size_t Logger::readPersistedPage(uint32_t generation, size_t offset, uint8_t *buffer, size_t size)
+{
+  return segments.readPage(generation, offset, buffer, size);
+}
+
+void Logger::loop()
+{
+  segments.flush();
+}
+
+void Logger::clearLogs()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  head = 0;
+  tail = 0;
+  totalEntries = 0;
 }
 
 int Logger::getLogCount()
 {
   return totalEntries;
-}
\ No newline at end of file
+}
@@ -3,23 +3,54 @@
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
-#include <UUID.h>
 
-struct LogEntry
+#include <mutex>
+
+#include "LogSegments.h"
+
+// Bytes reserved for log records; can be overridden via build flags
+#ifndef LOG_ARENA_SIZE
+#define LOG_ARENA_SIZE 8192
+#endif
+
+// Longest message kept in the arena, longer ones are truncated
+#define LOG_MAX_MESSAGE_LENGTH 255
+#define LOG_WRAP_MARKER 0xFFFF
+
+// Records are stored back to back in the arena: header, message bytes, terminator
+struct LogRecordHeader
+{
+  uint32_t seq;
+  uint32_t timestamp;
+  uint16_t length;  // message length, LOG_WRAP_MARKER marks the end of the used arena
+};
+
+// Largest JSON rendering of one record: message with every character escaped plus the fields
+#define LOG_STREAM_ENTRY_SIZE (2 * LOG_MAX_MESSAGE_LENGTH + 64)
+
+// Progress of one /logs response; streamLogsJson() fills it in as chunks are written
+struct LogStreamState
 {
-  String uuid;
-  unsigned long timestamp;
-  String message;
+  uint32_t nextSeq;  // first record not yet rendered
+  uint32_t lastSeq;  // newest record when the stream started, later ones wait for the next request
+  size_t nextOffset; // where nextSeq is stored, right after the last record rendered
+  bool hasOffset;    // false until a record has been rendered
+  uint8_t phase;
+  size_t pendingLength;
+  size_t pendingOffset;
+  char pending[LOG_STREAM_ENTRY_SIZE];
 };
 
 class Logger
 {
 private:
-  static const int MAX_LOG_ENTRIES = 50;
-  LogEntry logBuffer[MAX_LOG_ENTRIES];
-  int currentIndex;
+  uint8_t arena[LOG_ARENA_SIZE];
+  size_t head;  // offset of the oldest record
+  size_t tail;  // offset the next record is written at
   int totalEntries;
-  UUID uuidGenerator;
+  uint32_t nextSeq;
+  std::mutex lock;
+  LogSegments segments;
 
   Logger();
 
@@ -27,6 +58,13 @@ private:
   Logger(const Logger &) = delete;
   Logger &operator=(const Logger &) = delete;
 
+  LogRecordHeader readHeader(size_t offset);
+  size_t recordSize(size_t length);
+  void evictOldest();
+  bool findRecord(uint32_t seq, size_t &offset, LogRecordHeader &header);
+  bool findNextRecord(const LogStreamState &state, size_t &offset, LogRecordHeader &header);
+  size_t renderRecord(char *out, size_t offset, const LogRecordHeader &header, bool first);
+
 public:
   // Singleton access method
   static Logger &getInstance();
@@ -34,7 +72,22 @@ public:
   void log(const String &message);
   void log(const char *message);
   void logf(const char *format, ...);
-  String getLogsAsJson();
+
+  // Starts a stream of the records after `since` (0 for everything)
+  void beginLogStream(LogStreamState &state, uint32_t since);
+  // Writes the next piece of {"latest":<seq>,"logs":[...]} into buffer and returns its length,
+  // 0 once the document is complete. Records evicted while streaming are skipped.
+  size_t streamLogsJson(LogStreamState &state, uint8_t *buffer, size_t maxLength);
+
+  // Keep a copy of the log in rotating LittleFS segments (see LogSegments)
+  void setPersistent(bool persistent);
+  // Generation of a persisted segment, page 0 being the newest; false if there is none
+  bool findPersistedPage(int page, uint32_t &generation);
+  // Reads a persisted segment from offset on, 0 at its end or once it has been rotated out
+  size_t readPersistedPage(uint32_t generation, size_t offset, uint8_t *buffer, size_t size);
+  // Writes staged persistent log lines when due, called from the main loop
+  void loop();
+
   void clearLogs();
   int getLogCount();
 };
@@ -42,4 +95,4 @@ public:
 // Convenience macro for easier access
 #define logger Logger::getInstance()
 
-#endif // LOGGER_H
\ No newline at end of file
+#endif // LOGGER_H
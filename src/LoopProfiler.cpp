@@ -0,0 +1,162 @@
+#include "LoopProfiler.h"
+
+static const char *stageNames[LOOP_STAGE_COUNT] = {"improv",    "wifi",      "settings", "ack_ping",
+                                                   "poll",      "sensor",    "websocket", "ntp",
+                                                   "webserver", "housekeep", "total"};
+
+static int bucketFor(uint32_t micros)
+{
+    if (micros < LOOP_PROFILE_SUB_BUCKETS)
+    {
+        return micros;
+    }
+    // Position of the top bit, then the next two bits pick the sub bucket
+    int octave = 31 - __builtin_clz(micros);
+    int sub    = (micros >> (octave - 2)) & (LOOP_PROFILE_SUB_BUCKETS - 1);
+    int bucket = (octave - 1) * LOOP_PROFILE_SUB_BUCKETS + sub;
+    return bucket < LOOP_PROFILE_BUCKETS ? bucket : LOOP_PROFILE_BUCKETS - 1;
+}
+
+// First value past bucket, the last one is open ended
+static uint32_t bucketLimit(int bucket)
+{
+    if (bucket < LOOP_PROFILE_SUB_BUCKETS)
+    {
+        return bucket + 1;
+    }
+    int octave = bucket / LOOP_PROFILE_SUB_BUCKETS + 1;
+    int sub    = bucket % LOOP_PROFILE_SUB_BUCKETS;
+    return (uint32_t) (LOOP_PROFILE_SUB_BUCKETS + sub + 1) << (octave - 2);
+}
+
+LoopProfiler &LoopProfiler::getInstance()
+{
+    static LoopProfiler instance;
+    return instance;
+}
+
+LoopProfiler::LoopProfiler()
+{
+    enabled        = false;
+    active         = false;
+    iterationStart = 0;
+    lastLap        = 0;
+    memset(laps, 0, sizeof(laps));
+    clear();
+}
+
+void LoopProfiler::clear()
+{
+    memset(stats, 0, sizeof(stats));
+    memset(worstMicros, 0, sizeof(worstMicros));
+    iterations = 0;
+    startedAt  = 0;
+    worstAt    = 0;
+}
+
+void LoopProfiler::setEnabled(bool enable)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (enable && !enabled)
+    {
+        // Each capture starts from scratch
+        clear();
+    }
+    enabled = enable;
+}
+
+bool LoopProfiler::isEnabled()
+{
+    return enabled;
+}
+
+void LoopProfiler::reset()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    clear();
+}
+
+void LoopProfiler::recordIteration()
+{
+    uint32_t now = millis();
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (iterations == 0)
+    {
+        startedAt = now;
+    }
+    iterations++;
+
+    for (int stage = 0; stage < LOOP_STAGE_COUNT; stage++)
+    {
+        loop_stage_stats_t &entry  = stats[stage];
+        uint32_t            micros = laps[stage];
+        if (entry.count == 0 || micros < entry.minMicros)
+        {
+            entry.minMicros = micros;
+        }
+        if (entry.count == 0 || micros > entry.maxMicros)
+        {
+            entry.maxMicros = micros;
+            entry.maxAt     = now;
+        }
+        entry.count++;
+        entry.sumMicros += micros;
+        entry.histogram[bucketFor(micros)]++;
+    }
+
+    if (iterations == 1 || laps[LOOP_STAGE_TOTAL] > worstMicros[LOOP_STAGE_TOTAL])
+    {
+        worstAt = now;
+        memcpy(worstMicros, laps, sizeof(worstMicros));
+    }
+}
+
+static uint32_t percentile(const loop_stage_stats_t &entry, uint32_t permille)
+{
+    // Rank of the sample, rounded up, e.g. the 99th of 100
+    uint32_t rank = (uint32_t) (((uint64_t) entry.count * permille + 999) / 1000);
+    uint32_t seen = 0;
+    for (int bucket = 0; bucket < LOOP_PROFILE_BUCKETS; bucket++)
+    {
+        seen += entry.histogram[bucket];
+        if (seen >= rank && seen > 0)
+        {
+            // Upper edge of the bucket, never past the largest value actually seen
+            uint32_t limit = bucketLimit(bucket) - 1;
+            return limit < entry.maxMicros ? limit : entry.maxMicros;
+        }
+    }
+    return entry.maxMicros;
+}
+
+void LoopProfiler::toJson(JsonDocument &doc)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    doc["enabled"]    = (bool) enabled;
+    doc["iterations"] = iterations;
+    doc["since_ms"]   = startedAt;
+
+    JsonObject stages = doc.createNestedObject("stages");
+    for (int stage = 0; stage < LOOP_STAGE_COUNT; stage++)
+    {
+        const loop_stage_stats_t &entry = stats[stage];
+        JsonObject                out   = stages.createNestedObject(stageNames[stage]);
+        out["count"]     = entry.count;
+        out["avg_us"]    = entry.count > 0 ? (float) entry.sumMicros / entry.count : 0.0f;
+        out["min_us"]    = entry.minMicros;
+        out["max_us"]    = entry.maxMicros;
+        out["p99_us"]    = percentile(entry, 990);
+        out["max_at_ms"] = entry.maxAt;
+    }
+
+    JsonObject worst   = doc.createNestedObject("worst");
+    worst["at_ms"]     = worstAt;
+    worst["total_us"]  = worstMicros[LOOP_STAGE_TOTAL];
+    JsonObject worstBy = worst.createNestedObject("stages_us");
+    for (int stage = 0; stage < LOOP_STAGE_TOTAL; stage++)
+    {
+        worstBy[stageNames[stage]] = worstMicros[stage];
+    }
+}
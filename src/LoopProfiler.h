@@ -0,0 +1,132 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#ifdef ESP32
+#include <esp_timer.h>
+#endif
+
+#include <atomic>
+#include <mutex>
+
+// Histogram buckets are four per power of two of microseconds (~19% wide), bucket 87 starts at
+// 7.3 s and also counts everything above
+#define LOOP_PROFILE_SUB_BUCKETS 4
+#define LOOP_PROFILE_BUCKETS 88
+
+// Stages of the main loop, in the order they run. Each lap is charged with the time since the
+// previous one, so the stages add up to the whole iteration.
+typedef enum
+{
+    LOOP_STAGE_IMPROV,     // improv serial parsing and provisioning check
+    LOOP_STAGE_WIFI,       // settings reconnect request and WifiManager::loop()
+    LOOP_STAGE_SETTINGS,   // ElegooCC::refreshSettings()
+    LOOP_STAGE_ACK_PING,   // ack timeout check and websocket ping
+    LOOP_STAGE_POLL,       // status poll
+    LOOP_STAGE_SENSOR,     // pause gate, inline sensor tick and pause requests
+    LOOP_STAGE_WEBSOCKET,  // webSocket.loop(), which also parses the received messages
+    LOOP_STAGE_NTP,        // NTP setup and resync
+    LOOP_STAGE_WEBSERVER,  // WebServer::loop()
+    LOOP_STAGE_HOUSEKEEP,  // settings and logger flushes
+    LOOP_STAGE_TOTAL,      // whole iteration
+    LOOP_STAGE_COUNT
+} loop_stage_t;
+
+// Capacity needed by LoopProfiler::toJson()
+#define LOOP_PROFILE_JSON_SIZE                                                  \
+    (JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(LOOP_STAGE_COUNT) +                 \
+     LOOP_STAGE_COUNT * JSON_OBJECT_SIZE(7) + JSON_OBJECT_SIZE(3) +             \
+     JSON_OBJECT_SIZE(LOOP_STAGE_COUNT))
+
+typedef struct
+{
+    uint32_t count;
+    uint64_t sumMicros;
+    uint32_t minMicros;
+    uint32_t maxMicros;
+    uint32_t maxAt;  // millis() of the iteration that set maxMicros
+    uint32_t histogram[LOOP_PROFILE_BUCKETS];
+} loop_stage_stats_t;
+
+// Times the stages of loop() with the 64-bit microsecond timer, which unlike the 32-bit CPU cycle
+// counter doesn't wrap around during a long stall. Disabled by default; while disabled a lap is
+// one branch on a plain bool. Laps are only taken from the loop task, the iteration is folded
+// into the statistics under the lock once at its end so the web server can read them.
+class LoopProfiler
+{
+   private:
+    std::atomic<bool> enabled;
+    std::mutex        lock;
+
+    // Current iteration, loop task only
+    bool     active;  // enabled when the iteration began
+    int64_t  iterationStart;
+    int64_t  lastLap;
+    uint32_t laps[LOOP_STAGE_COUNT];  // microseconds
+
+    loop_stage_stats_t stats[LOOP_STAGE_COUNT];
+    uint32_t           iterations;
+    uint32_t           startedAt;  // millis() of the first recorded iteration
+
+    // Breakdown of the slowest iteration
+    uint32_t worstAt;
+    uint32_t worstMicros[LOOP_STAGE_COUNT];
+
+    LoopProfiler();
+
+    LoopProfiler(const LoopProfiler &)            = delete;
+    LoopProfiler &operator=(const LoopProfiler &) = delete;
+
+    void recordIteration();
+    void clear();
+
+   public:
+    static LoopProfiler &getInstance();
+
+    void setEnabled(bool enable);
+    bool isEnabled();
+    void reset();
+
+    void beginIteration()
+    {
+        active = enabled.load(std::memory_order_relaxed);
+        if (active)
+        {
+            iterationStart = esp_timer_get_time();
+            lastLap        = iterationStart;
+            memset(laps, 0, sizeof(laps));
+        }
+    }
+
+    // Charges the time since the previous lap to stage
+    void lap(loop_stage_t stage)
+    {
+        if (active)
+        {
+            int64_t now = esp_timer_get_time();
+            laps[stage] += (uint32_t) (now - lastLap);
+            lastLap = now;
+        }
+    }
+
+    // Iterations that return before reaching this are dropped
+    void endIteration()
+    {
+        if (active)
+        {
+            laps[LOOP_STAGE_TOTAL] = (uint32_t) (esp_timer_get_time() - iterationStart);
+            recordIteration();
+            active = false;
+        }
+    }
+
+    // {"enabled":..,"iterations":..,"since_ms":..,"stages":{"<stage>":{"count","avg_us","min_us",
+    // "max_us","p99_us","max_at_ms"},...},"worst":{"at_ms":..,"total_us":..,"stages_us":{...}}}
+    void toJson(JsonDocument &doc);
+};
+
+#define loopProfiler LoopProfiler::getInstance()
+
+#endif  // LOOP_PROFILER_H
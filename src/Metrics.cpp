@@ -0,0 +1,526 @@
+#include "Metrics.h"
+
+#include <stdarg.h>
+
+#include "PrinterManager.h"
+
+static const int metricCommands[METRICS_COMMAND_COUNT] = {
+    SDCP_COMMAND_STATUS,      SDCP_COMMAND_ATTRIBUTES,     SDCP_COMMAND_START_PRINT,
+    SDCP_COMMAND_PAUSE_PRINT, SDCP_COMMAND_STOP_PRINT,     SDCP_COMMAND_CONTINUE_PRINT,
+    SDCP_COMMAND_STOP_FEEDING_MATERIAL};
+
+static int commandSlot(int command)
+{
+    for (int i = 0; i < METRICS_COMMAND_COUNT; i++)
+    {
+        if (metricCommands[i] == command)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static const char *tickPhaseLabels[TICK_PHASE_COUNT] = {"all", "start", "first_layer",
+                                                        "later_layers"};
+
+static void increment(std::atomic<uint32_t> &counter)
+{
+    counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+// The exposition in pieces that each fit in MetricsStreamState::pending
+typedef enum
+{
+    METRICS_SECTION_PROCESS,
+    METRICS_SECTION_WEBSOCKET,
+    METRICS_SECTION_SDCP,
+    METRICS_SECTION_COMMANDS_SENT,
+    METRICS_SECTION_COMMANDS_ACKED,
+    METRICS_SECTION_COMMAND_TIMEOUTS,
+    METRICS_SECTION_PAUSES,
+    METRICS_SECTION_FILAMENT,
+    METRICS_SECTION_FEED_RATE,
+    METRICS_SECTION_TICK_AVG,
+    METRICS_SECTION_TICK_MIN,
+    METRICS_SECTION_TICK_MAX,
+    METRICS_SECTION_TICK_STDDEV,
+    METRICS_SECTION_TICK_P50,
+    METRICS_SECTION_TICK_P95,
+    METRICS_SECTION_TICK_SAMPLES,
+    METRICS_SECTION_COUNT
+} metrics_section_t;
+
+// Prints into a fixed buffer, whole writes only so a section that doesn't fit loses lines rather
+// than leaving half of one
+class PendingBuffer : public Print
+{
+   private:
+    char  *data;
+    size_t capacity;
+    size_t length;
+
+   public:
+    PendingBuffer(char *buffer, size_t size) : data(buffer), capacity(size), length(0) {}
+
+    size_t getLength() const
+    {
+        return length;
+    }
+
+    size_t write(uint8_t c) override
+    {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        if (size > capacity - length)
+        {
+            return 0;
+        }
+        memcpy(data + length, buffer, size);
+        length += size;
+        return size;
+    }
+};
+
+// Formats one line at a time into a small buffer and prints it, so nothing is allocated
+class MetricsWriter
+{
+   private:
+    Print &out;
+    char   line[160];
+    char   label[24];
+
+   public:
+    MetricsWriter(Print &target) : out(target) {}
+
+    // Lines longer than the buffer are cut off, none of the fixed ones come close
+    void printf(const char *format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(line, sizeof(line), format, args);
+        va_end(args);
+        if (written > 0)
+        {
+            size_t size = (size_t) written < sizeof(line) ? (size_t) written : sizeof(line) - 1;
+            out.write((const uint8_t *) line, size);
+        }
+    }
+
+    void header(const char *name, const char *type, const char *help)
+    {
+        printf("# HELP %s %s\n", name, help);
+        printf("# TYPE %s %s\n", name, type);
+    }
+
+    void value(const char *name, const char *type, const char *help, unsigned long value)
+    {
+        header(name, type, help);
+        printf("%s %lu\n", name, value);
+    }
+
+    void decimal(const char *name, const char *type, const char *help, float value)
+    {
+        header(name, type, help);
+        printf("%s %.3f\n", name, value);
+    }
+
+    // The printer label, as the only label ("{printer=..}") or ahead of others ("printer=..,").
+    // Empty with a single printer, so its series keep the names they had before there were more.
+    const char *printerLabel(int printer, bool alone)
+    {
+        if (PRINTER_COUNT == 1)
+        {
+            return "";
+        }
+        snprintf(label, sizeof(label), alone ? "{printer=\"%d\"}" : "printer=\"%d\",", printer);
+        return label;
+    }
+
+    void printerValues(const char *name, const char *type, const char *help,
+                       const unsigned long *values)
+    {
+        header(name, type, help);
+        for (int printer = 0; printer < PRINTER_COUNT; printer++)
+        {
+            printf("%s%s %lu\n", name, printerLabel(printer, true), values[printer]);
+        }
+    }
+
+    void printerValues(const char *name, const char *type, const char *help,
+                       const std::atomic<uint32_t> *values)
+    {
+        header(name, type, help);
+        for (int printer = 0; printer < PRINTER_COUNT; printer++)
+        {
+            printf("%s%s %lu\n", name, printerLabel(printer, true),
+                   (unsigned long) values[printer].load(std::memory_order_relaxed));
+        }
+    }
+
+    void printerDecimals(const char *name, const char *type, const char *help, const float *values)
+    {
+        header(name, type, help);
+        for (int printer = 0; printer < PRINTER_COUNT; printer++)
+        {
+            printf("%s%s %.3f\n", name, printerLabel(printer, true), values[printer]);
+        }
+    }
+
+    void tickValues(const char *name, const char *help,
+                    const tick_stats_t (*stats)[TICK_PHASE_COUNT],
+                    unsigned long tick_stats_t::*field)
+    {
+        header(name, "gauge", help);
+        for (int phase = 0; phase < TICK_PHASE_COUNT; phase++)
+        {
+            for (int printer = 0; printer < PRINTER_COUNT; printer++)
+            {
+                printf("%s{%sphase=\"%s\"} %lu\n", name, printerLabel(printer, false),
+                       tickPhaseLabels[phase], stats[printer][phase].*field);
+            }
+        }
+    }
+
+    void commandValues(const char *name, const char *help,
+                       const std::atomic<uint32_t> (*values)[METRICS_COMMAND_COUNT])
+    {
+        header(name, "counter", help);
+        for (int i = 0; i < METRICS_COMMAND_COUNT; i++)
+        {
+            for (int printer = 0; printer < PRINTER_COUNT; printer++)
+            {
+                printf("%s{%scommand=\"%d\"} %lu\n", name, printerLabel(printer, false),
+                       metricCommands[i],
+                       (unsigned long) values[printer][i].load(std::memory_order_relaxed));
+            }
+        }
+    }
+};
+
+Metrics &Metrics::getInstance()
+{
+    static Metrics instance;
+    return instance;
+}
+
+Metrics::Metrics()
+{
+    loopIterations       = 0;
+    worstLoopMicros      = 0;
+    lastLoopStart        = 0;
+    renderedIterations   = 0;
+    lastRender           = 0;
+    for (int printer = 0; printer < PRINTER_COUNT; printer++)
+    {
+        websocketConnects[printer]    = 0;
+        websocketDisconnects[printer] = 0;
+        messagesReceived[printer]     = 0;
+        statusesParsed[printer]       = 0;
+        statusDuplicates[printer]     = 0;
+        parseFailures[printer]        = 0;
+        runoutPauses[printer]         = 0;
+        stoppedPauses[printer]        = 0;
+        for (int i = 0; i < METRICS_COMMAND_COUNT; i++)
+        {
+            commandsSent[printer][i]    = 0;
+            commandsAcked[printer][i]   = 0;
+            commandTimeouts[printer][i] = 0;
+        }
+    }
+}
+
+void Metrics::recordLoop()
+{
+    uint32_t now = micros();
+    if (lastLoopStart != 0)
+    {
+        uint32_t elapsed = now - lastLoopStart;
+        if (elapsed > worstLoopMicros.load(std::memory_order_relaxed))
+        {
+            worstLoopMicros.store(elapsed, std::memory_order_relaxed);
+        }
+    }
+    lastLoopStart = now;
+    increment(loopIterations);
+}
+
+void Metrics::countConnect(int printer)
+{
+    increment(websocketConnects[printer]);
+}
+
+void Metrics::countDisconnect(int printer)
+{
+    increment(websocketDisconnects[printer]);
+}
+
+void Metrics::countMessage(int printer)
+{
+    increment(messagesReceived[printer]);
+}
+
+void Metrics::countParseFailure(int printer)
+{
+    increment(parseFailures[printer]);
+}
+
+void Metrics::countStatus(int printer, bool duplicate)
+{
+    increment(duplicate ? statusDuplicates[printer] : statusesParsed[printer]);
+}
+
+void Metrics::countCommandSent(int printer, int command)
+{
+    int slot = commandSlot(command);
+    if (slot >= 0)
+    {
+        increment(commandsSent[printer][slot]);
+    }
+}
+
+void Metrics::countCommandAcked(int printer, int command)
+{
+    int slot = commandSlot(command);
+    if (slot >= 0)
+    {
+        increment(commandsAcked[printer][slot]);
+    }
+}
+
+void Metrics::countCommandTimeout(int printer, int command)
+{
+    int slot = commandSlot(command);
+    if (slot >= 0)
+    {
+        increment(commandTimeouts[printer][slot]);
+    }
+}
+
+void Metrics::countPause(int printer, bool runout)
+{
+    increment(runout ? runoutPauses[printer] : stoppedPauses[printer]);
+}
+
+void Metrics::beginMetricsStream(MetricsStreamState &state)
+{
+    state.now        = millis();
+    state.iterations = loopIterations.load(std::memory_order_relaxed);
+    state.worstLoop  = worstLoopMicros.exchange(0, std::memory_order_relaxed);
+    {
+        // Loop rate over the time since the previous scrape
+        std::lock_guard<std::mutex> guard(scrapeLock);
+        unsigned long               elapsed = state.now - lastRender;
+        state.loopRate = lastRender != 0 && elapsed > 0
+                             ? (state.iterations - renderedIterations) * 1000UL / elapsed
+                             : 0;
+        renderedIterations = state.iterations;
+        lastRender         = state.now;
+    }
+
+    // Taken once, the tick sections all report the same samples
+    for (int printer = 0; printer < PRINTER_COUNT; printer++)
+    {
+        printerManager.get(printer).getTickStats(state.ticks[printer]);
+    }
+
+    state.section       = 0;
+    state.pendingLength = 0;
+    state.pendingOffset = 0;
+}
+
+size_t Metrics::streamMetrics(MetricsStreamState &state, uint8_t *buffer, size_t maxLength)
+{
+    size_t length = 0;
+    while (length < maxLength)
+    {
+        // Render the next section once the last one has been sent
+        if (state.pendingOffset == state.pendingLength)
+        {
+            if (state.section >= METRICS_SECTION_COUNT)
+            {
+                break;
+            }
+            PendingBuffer pending(state.pending, sizeof(state.pending));
+            MetricsWriter out(pending);
+            renderSection(state, state.section++, out);
+            state.pendingLength = pending.getLength();
+            state.pendingOffset = 0;
+            continue;
+        }
+
+        size_t size = state.pendingLength - state.pendingOffset;
+        size        = size < maxLength - length ? size : maxLength - length;
+        memcpy(buffer + length, state.pending + state.pendingOffset, size);
+        state.pendingOffset += size;
+        length += size;
+    }
+    return length;
+}
+
+void Metrics::renderSection(const MetricsStreamState &state, int section, MetricsWriter &out)
+{
+    switch (section)
+    {
+        case METRICS_SECTION_PROCESS:
+            out.value("cc_sfs_heap_free_bytes", "gauge", "Free heap.", ESP.getFreeHeap());
+            out.value("cc_sfs_heap_largest_free_block_bytes", "gauge", "Largest allocatable block.",
+                      ESP.getMaxAllocHeap());
+            out.value("cc_sfs_uptime_seconds", "gauge", "Time since boot.", state.now / 1000);
+
+            out.value("cc_sfs_loop_iterations_total", "counter", "Main loop iterations.",
+                      state.iterations);
+            out.value("cc_sfs_loop_rate_hz", "gauge",
+                      "Main loop iterations per second since last scrape.", state.loopRate);
+            out.value("cc_sfs_loop_worst_microseconds", "gauge",
+                      "Longest main loop since last scrape.", state.worstLoop);
+            break;
+
+        case METRICS_SECTION_WEBSOCKET:
+            out.printerValues("cc_sfs_websocket_connects_total", "counter",
+                              "Printer websocket connects.", websocketConnects);
+            out.printerValues("cc_sfs_websocket_disconnects_total", "counter",
+                              "Printer websocket disconnects.", websocketDisconnects);
+            break;
+
+        case METRICS_SECTION_SDCP:
+            out.printerValues("cc_sfs_sdcp_messages_received_total", "counter",
+                              "SDCP messages received.", messagesReceived);
+            out.printerValues("cc_sfs_sdcp_parse_failures_total", "counter",
+                              "SDCP messages that failed to parse.", parseFailures);
+            out.printerValues("cc_sfs_sdcp_statuses_parsed_total", "counter",
+                              "SDCP status messages parsed and applied.", statusesParsed);
+            out.printerValues(
+                "cc_sfs_sdcp_status_duplicates_total", "counter",
+                "SDCP status messages skipped unparsed as repeats of the previous one.",
+                statusDuplicates);
+            break;
+
+        case METRICS_SECTION_COMMANDS_SENT:
+            out.commandValues("cc_sfs_sdcp_commands_sent_total", "SDCP commands sent.",
+                              commandsSent);
+            break;
+
+        case METRICS_SECTION_COMMANDS_ACKED:
+            out.commandValues("cc_sfs_sdcp_commands_acked_total", "SDCP commands acknowledged.",
+                              commandsAcked);
+            break;
+
+        case METRICS_SECTION_COMMAND_TIMEOUTS:
+            out.commandValues("cc_sfs_sdcp_command_timeouts_total",
+                              "SDCP commands never acknowledged.", commandTimeouts);
+            break;
+
+        case METRICS_SECTION_PAUSES:
+            out.header("cc_sfs_pauses_total", "counter", "Pauses triggered by reason.");
+            for (int printer = 0; printer < PRINTER_COUNT; printer++)
+            {
+                out.printf("cc_sfs_pauses_total{%sreason=\"runout\"} %lu\n",
+                           out.printerLabel(printer, false),
+                           (unsigned long) runoutPauses[printer].load(std::memory_order_relaxed));
+            }
+            for (int printer = 0; printer < PRINTER_COUNT; printer++)
+            {
+                out.printf("cc_sfs_pauses_total{%sreason=\"stopped\"} %lu\n",
+                           out.printerLabel(printer, false),
+                           (unsigned long) stoppedPauses[printer].load(std::memory_order_relaxed));
+            }
+            break;
+
+        case METRICS_SECTION_FILAMENT:
+        {
+            // Read straight from the printers, getCurrentInformation() would copy strings for
+            // nothing
+            unsigned long printing[PRINTER_COUNT];
+            unsigned long stopped[PRINTER_COUNT];
+            unsigned long runout[PRINTER_COUNT];
+            for (int printer = 0; printer < PRINTER_COUNT; printer++)
+            {
+                ElegooCC &source  = printerManager.get(printer);
+                printing[printer] = source.isPrinting();
+                stopped[printer]  = source.isFilamentStopped();
+                runout[printer]   = source.isFilamentRunout();
+            }
+            out.printerValues("cc_sfs_printing", "gauge", "1 while the printer is printing.",
+                              printing);
+            out.printerValues("cc_sfs_filament_stopped", "gauge",
+                              "1 while filament movement has stopped.", stopped);
+            out.printerValues("cc_sfs_filament_runout", "gauge",
+                              "1 while the runout switch reports no filament.", runout);
+            break;
+        }
+
+        case METRICS_SECTION_FEED_RATE:
+        {
+            float         feedRate[PRINTER_COUNT];
+            float         baseline[PRINTER_COUNT];
+            unsigned long collapsed[PRINTER_COUNT];
+            for (int printer = 0; printer < PRINTER_COUNT; printer++)
+            {
+                FeedRate &source   = printerManager.get(printer).getFeedRate();
+                feedRate[printer]  = source.getRate();
+                baseline[printer]  = source.getBaseline();
+                collapsed[printer] = source.isCollapsed();
+            }
+            out.printerDecimals("cc_sfs_feed_rate_mm_per_second", "gauge",
+                                "Filament feed rate from the movement sensor, smoothed.", feedRate);
+            out.printerDecimals("cc_sfs_feed_rate_baseline_mm_per_second", "gauge",
+                                "Feed rate baseline a collapse is measured against.", baseline);
+            out.printerValues("cc_sfs_feed_rate_collapsed", "gauge",
+                              "1 while the feed rate is far below its baseline.", collapsed);
+            break;
+        }
+
+        case METRICS_SECTION_TICK_AVG:
+            out.tickValues("cc_sfs_tick_interval_avg_milliseconds",
+                           "Average time between print ticks by phase.", state.ticks,
+                           &tick_stats_t::avg);
+            break;
+
+        case METRICS_SECTION_TICK_MIN:
+            out.tickValues("cc_sfs_tick_interval_min_milliseconds",
+                           "Shortest time between print ticks by phase.", state.ticks,
+                           &tick_stats_t::min);
+            break;
+
+        case METRICS_SECTION_TICK_MAX:
+            out.tickValues("cc_sfs_tick_interval_max_milliseconds",
+                           "Longest time between print ticks by phase.", state.ticks,
+                           &tick_stats_t::max);
+            break;
+
+        case METRICS_SECTION_TICK_STDDEV:
+            out.tickValues("cc_sfs_tick_interval_stddev_milliseconds",
+                           "Standard deviation of the time between print ticks by phase.",
+                           state.ticks, &tick_stats_t::stddev);
+            break;
+
+        case METRICS_SECTION_TICK_P50:
+            out.tickValues("cc_sfs_tick_interval_p50_milliseconds",
+                           "Estimated median time between print ticks by phase.", state.ticks,
+                           &tick_stats_t::p50);
+            break;
+
+        case METRICS_SECTION_TICK_P95:
+            out.tickValues("cc_sfs_tick_interval_p95_milliseconds",
+                           "Estimated 95th percentile of the time between print ticks by phase.",
+                           state.ticks, &tick_stats_t::p95);
+            break;
+
+        case METRICS_SECTION_TICK_SAMPLES:
+            out.header("cc_sfs_tick_samples", "gauge", "Tick intervals measured by phase.");
+            for (int phase = 0; phase < TICK_PHASE_COUNT; phase++)
+            {
+                for (int printer = 0; printer < PRINTER_COUNT; printer++)
+                {
+                    out.printf("cc_sfs_tick_samples{%sphase=\"%s\"} %d\n",
+                               out.printerLabel(printer, false), tickPhaseLabels[phase],
+                               state.ticks[printer][phase].count);
+                }
+            }
+            break;
+    }
+}
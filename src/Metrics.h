@@ -0,0 +1,101 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <mutex>
+
+#include "ElegooCC.h"
+#include "PrinterConfig.h"
+
+// Room for the longest section of the exposition, see metrics_section_t in Metrics.cpp
+#ifndef METRICS_SECTION_SIZE
+#define METRICS_SECTION_SIZE (384 + 512 * PRINTER_COUNT)
+#endif
+
+// SDCP commands counted separately, see commandSlot() in Metrics.cpp
+#define METRICS_COMMAND_COUNT 7
+
+class MetricsWriter;
+
+// How far a /metrics response has got. The values for the whole scrape are taken when it begins,
+// the rest is rendered one section at a time into pending as the response asks for more.
+struct MetricsStreamState
+{
+    unsigned long now;
+    uint32_t      iterations;
+    unsigned long loopRate;
+    unsigned long worstLoop;
+    tick_stats_t  ticks[PRINTER_COUNT][TICK_PHASE_COUNT];
+    int           section;  // next section to render
+    size_t        pendingLength;
+    size_t        pendingOffset;
+    char          pending[METRICS_SECTION_SIZE];
+};
+
+// Counters for the Prometheus /metrics endpoint. Counting is a relaxed atomic increment so it can
+// be done from any task; streamMetrics() writes the text format into the response a piece at a
+// time. Printer counters and gauges carry a printer="<index>" label when there is more than one
+// printer.
+class Metrics
+{
+   private:
+    std::atomic<uint32_t> loopIterations;
+    std::atomic<uint32_t> worstLoopMicros;  // since the last scrape
+    uint32_t              lastLoopStart;
+
+    // Where the previous scrape left off, for the loop rate. Scrapes can overlap.
+    std::mutex    scrapeLock;
+    uint32_t      renderedIterations;
+    unsigned long lastRender;
+
+    // Per printer
+    std::atomic<uint32_t> websocketConnects[PRINTER_COUNT];
+    std::atomic<uint32_t> websocketDisconnects[PRINTER_COUNT];
+    std::atomic<uint32_t> messagesReceived[PRINTER_COUNT];
+    std::atomic<uint32_t> parseFailures[PRINTER_COUNT];
+    std::atomic<uint32_t> statusesParsed[PRINTER_COUNT];
+    std::atomic<uint32_t> statusDuplicates[PRINTER_COUNT];
+
+    std::atomic<uint32_t> commandsSent[PRINTER_COUNT][METRICS_COMMAND_COUNT];
+    std::atomic<uint32_t> commandsAcked[PRINTER_COUNT][METRICS_COMMAND_COUNT];
+    std::atomic<uint32_t> commandTimeouts[PRINTER_COUNT][METRICS_COMMAND_COUNT];
+
+    std::atomic<uint32_t> runoutPauses[PRINTER_COUNT];
+    std::atomic<uint32_t> stoppedPauses[PRINTER_COUNT];
+
+    Metrics();
+
+    Metrics(const Metrics &)            = delete;
+    Metrics &operator=(const Metrics &) = delete;
+
+    void renderSection(const MetricsStreamState &state, int section, MetricsWriter &out);
+
+   public:
+    static Metrics &getInstance();
+
+    // Called at the start of every loop(), the time between calls is the loop time
+    void recordLoop();
+
+    // printer is the ElegooCC index
+    void countConnect(int printer);
+    void countDisconnect(int printer);
+    void countMessage(int printer);
+    void countParseFailure(int printer);
+    // A status message was parsed, or skipped as a repeat of the last one
+    void countStatus(int printer, bool duplicate);
+    void countCommandSent(int printer, int command);
+    void countCommandAcked(int printer, int command);
+    void countCommandTimeout(int printer, int command);
+    void countPause(int printer, bool runout);
+
+    // Starts a scrape of the Prometheus text exposition
+    void beginMetricsStream(MetricsStreamState &state);
+    // Writes the next piece of it into buffer and returns its length, 0 once it is complete
+    size_t streamMetrics(MetricsStreamState &state, uint8_t *buffer, size_t maxLength);
+};
+
+#define metrics Metrics::getInstance()
+
+#endif  // METRICS_H
@@ -0,0 +1,64 @@
+#include "MovementSensor.h"
+
+MovementSensor::MovementSensor()
+{
+    pin            = 0;
+    wake           = nullptr;
+    lastEdgeMicros = 0;
+    edgeCount      = 0;
+    overflowCount  = 0;
+}
+
+void MovementSensor::begin(uint8_t sensorPin, SensorWake *edgeWake)
+{
+    pin  = sensorPin;
+    wake = edgeWake;
+    pinMode(pin, INPUT_PULLUP);
+    lastEdgeMicros = micros();
+    attachInterruptArg(digitalPinToInterrupt(pin), MovementSensor::onEdge, this, CHANGE);
+}
+
+void IRAM_ATTR MovementSensor::onEdge(void *arg)
+{
+    MovementSensor *sensor = static_cast<MovementSensor *>(arg);
+
+    movement_edge_t edge;
+    edge.micros = micros();
+    edge.level  = digitalRead(sensor->pin);
+
+    sensor->lastEdgeMicros = edge.micros;
+    sensor->edgeCount.fetch_add(1, std::memory_order_relaxed);
+    if (!sensor->edges.push(edge))
+    {
+        sensor->overflowCount = sensor->overflowCount + 1;
+    }
+    if (sensor->wake)
+    {
+        sensor->wake->notifyFromISR();
+    }
+}
+
+bool MovementSensor::popEdge(movement_edge_t &edge)
+{
+    return edges.pop(edge);
+}
+
+int MovementSensor::readLevel()
+{
+    return digitalRead(pin);
+}
+
+uint32_t MovementSensor::getLastEdgeMicros()
+{
+    return lastEdgeMicros;
+}
+
+uint32_t MovementSensor::getEdgeCount()
+{
+    return edgeCount.load(std::memory_order_relaxed);
+}
+
+uint32_t MovementSensor::getOverflowCount()
+{
+    return overflowCount;
+}
@@ -0,0 +1,59 @@
+#ifndef MOVEMENT_SENSOR_H
+#define MOVEMENT_SENSOR_H
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "SensorWake.h"
+#include "SpscRing.h"
+
+// Number of edges buffered between the ISR and the detection logic. At typical feed rates the
+// SFS 2.0 toggles well under 50 times per second, so this covers more than a second of loop stall.
+#ifndef MOVEMENT_EDGE_BUFFER_SIZE
+#define MOVEMENT_EDGE_BUFFER_SIZE 64
+#endif
+
+// A single transition of the movement sensor pin
+typedef struct
+{
+    uint32_t micros;  // micros() at the time of the edge
+    uint8_t  level;   // pin level after the edge
+} movement_edge_t;
+
+// Captures every transition of the SFS 2.0 motion pin from a GPIO interrupt and hands them to
+// the consumer (ElegooCC) through a lock-free ring, so edges are never lost to loop() jitter.
+class MovementSensor
+{
+   private:
+    uint8_t     pin;
+    SensorWake *wake;  // notified on every edge, may be null
+
+    SpscRing<movement_edge_t, MOVEMENT_EDGE_BUFFER_SIZE> edges;
+
+    // Written by the ISR only. lastEdgeMicros is kept even when the ring is full so that the
+    // consumer still sees the most recent movement after an overflow.
+    volatile uint32_t lastEdgeMicros;
+    volatile uint32_t overflowCount;
+
+    // Read on every sensor tick for the feed rate
+    std::atomic<uint32_t> edgeCount;
+
+    static void IRAM_ATTR onEdge(void *arg);
+
+   public:
+    MovementSensor();
+
+    // Configures the pin and attaches the edge interrupt
+    void begin(uint8_t sensorPin, SensorWake *edgeWake = nullptr);
+
+    // Pops the oldest buffered edge. Must only be called from a single consumer.
+    bool popEdge(movement_edge_t &edge);
+
+    int      readLevel();
+    uint32_t getLastEdgeMicros();
+    uint32_t getEdgeCount();
+    uint32_t getOverflowCount();
+};
+
+#endif  // MOVEMENT_SENSOR_H
@@ -0,0 +1,139 @@
+#include "PauseLatency.h"
+
+static const char *stageNames[PAUSE_STAGE_COUNT] = {"detect", "decide", "queue", "ack",
+                                                    "paused", "wire",   "total"};
+
+static int bucketFor(uint32_t micros)
+{
+    int bucket = 0;
+    while (micros > 1 && bucket < PAUSE_LATENCY_BUCKETS - 1)
+    {
+        micros >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+PauseLatency::PauseLatency()
+{
+    memset(&printHistogram, 0, sizeof(printHistogram));
+    memset(&bootHistogram, 0, sizeof(bootHistogram));
+    memset(&timing, 0, sizeof(timing));
+    memset(lastDelta, 0, sizeof(lastDelta));
+    active     = false;
+    sent       = false;
+    sentMicros = 0;
+    acked      = false;
+}
+
+void PauseLatency::record(pause_stage_t stage, uint32_t from, uint32_t to)
+{
+    uint32_t delta   = to - from;
+    int      bucket  = bucketFor(delta);
+    lastDelta[stage] = delta;
+    printHistogram.counts[stage][bucket]++;
+    bootHistogram.counts[stage][bucket]++;
+}
+
+void PauseLatency::begin(const pause_timing_t &decision)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    // The pause is repeated until the printer reports it (see the TODO in updatePauseGate()),
+    // keep following the first one
+    if (active && sent && decision.decideMicros - sentMicros < PAUSE_LATENCY_FOLLOW_US)
+    {
+        return;
+    }
+    active = true;
+    timing = decision;
+    sent   = false;
+    acked  = false;
+    memset(lastDelta, 0, sizeof(lastDelta));
+
+    if (timing.hasEdge)
+    {
+        record(PAUSE_STAGE_DETECT, timing.edgeMicros, timing.triggerMicros);
+    }
+    record(PAUSE_STAGE_DECIDE, timing.triggerMicros, timing.decideMicros);
+}
+
+void PauseLatency::markSent(uint32_t micros)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    // Only the first send of a pause counts, later ones are retries
+    if (!active || sent)
+    {
+        return;
+    }
+    sent       = true;
+    sentMicros = micros;
+    record(PAUSE_STAGE_QUEUE, timing.decideMicros, micros);
+    record(PAUSE_STAGE_WIRE, timing.triggerMicros, micros);
+}
+
+void PauseLatency::markAck(uint32_t micros)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (!active || !sent || acked)
+    {
+        return;
+    }
+    acked = true;
+    record(PAUSE_STAGE_ACK, sentMicros, micros);
+}
+
+void PauseLatency::markPaused(uint32_t micros)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (!active || !sent)
+    {
+        return;
+    }
+    record(PAUSE_STAGE_PAUSED, sentMicros, micros);
+    record(PAUSE_STAGE_TOTAL, timing.hasEdge ? timing.edgeMicros : timing.triggerMicros, micros);
+    printHistogram.pauses++;
+    bootHistogram.pauses++;
+    active = false;
+}
+
+void PauseLatency::resetPrint()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    memset(&printHistogram, 0, sizeof(printHistogram));
+}
+
+static void histogramToJson(JsonObject out, const pause_latency_histogram_t &histogram)
+{
+    out["pauses"] = histogram.pauses;
+    for (int stage = 0; stage < PAUSE_STAGE_COUNT; stage++)
+    {
+        JsonArray counts = out.createNestedArray(stageNames[stage]);
+        for (int bucket = 0; bucket < PAUSE_LATENCY_BUCKETS; bucket++)
+        {
+            counts.add(histogram.counts[stage][bucket]);
+        }
+    }
+}
+
+void PauseLatency::toJson(JsonDocument &doc)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    // Lower bound of each bucket
+    JsonArray buckets = doc.createNestedArray("bucket_us");
+    for (int bucket = 0; bucket < PAUSE_LATENCY_BUCKETS; bucket++)
+    {
+        buckets.add(1UL << bucket);
+    }
+
+    JsonArray  stages = doc.createNestedArray("stages");
+    JsonObject last   = doc.createNestedObject("last_us");
+    for (int stage = 0; stage < PAUSE_STAGE_COUNT; stage++)
+    {
+        stages.add(stageNames[stage]);
+        last[stageNames[stage]] = lastDelta[stage];
+    }
+
+    histogramToJson(doc.createNestedObject("print"), printHistogram);
+    histogramToJson(doc.createNestedObject("boot"), bootHistogram);
+}
@@ -0,0 +1,87 @@
+#ifndef PAUSE_LATENCY_H
+#define PAUSE_LATENCY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include <mutex>
+
+// Histogram bucket i counts latencies in [2^i, 2^(i+1)) microseconds, the last bucket also
+// everything above. 24 buckets reach ~16.7 s.
+#define PAUSE_LATENCY_BUCKETS 24
+
+// Repeated pause decisions within this long of the first send count as retries of it
+#define PAUSE_LATENCY_FOLLOW_US (30UL * 1000 * 1000)
+
+// Stages of a pause, each measured from the event before it
+typedef enum
+{
+    PAUSE_STAGE_DETECT,  // last movement edge -> movement timeout crossed
+    PAUSE_STAGE_DECIDE,  // timeout crossed or runout seen -> shouldPausePrint() true
+    PAUSE_STAGE_QUEUE,   // shouldPausePrint() true -> pause command written to the websocket
+    PAUSE_STAGE_ACK,     // pause command sent -> printer acknowledged it
+    PAUSE_STAGE_PAUSED,  // pause command sent -> printer reported SDCP_PRINT_STATUS_PAUSED
+    PAUSE_STAGE_WIRE,    // timeout crossed or runout seen -> pause command written (decide + queue)
+    PAUSE_STAGE_TOTAL,   // first recorded event -> printer reported SDCP_PRINT_STATUS_PAUSED
+    PAUSE_STAGE_COUNT
+} pause_stage_t;
+
+// Sensor-side timestamps of a pause decision, all micros()
+typedef struct
+{
+    bool     hasEdge;        // false for runout pauses, which have no movement edge
+    uint32_t edgeMicros;     // last movement edge
+    uint32_t triggerMicros;  // movement timeout crossed or runout detected
+    uint32_t decideMicros;   // shouldPausePrint() returned true
+} pause_timing_t;
+
+// Capacity needed by PauseLatency::toJson()
+#define PAUSE_LATENCY_JSON_SIZE                                                                 \
+    (JSON_OBJECT_SIZE(5) + JSON_ARRAY_SIZE(PAUSE_LATENCY_BUCKETS) +                            \
+     JSON_ARRAY_SIZE(PAUSE_STAGE_COUNT) + JSON_OBJECT_SIZE(PAUSE_STAGE_COUNT) +                \
+     2 * (JSON_OBJECT_SIZE(PAUSE_STAGE_COUNT + 1) +                                            \
+          PAUSE_STAGE_COUNT * JSON_ARRAY_SIZE(PAUSE_LATENCY_BUCKETS)))
+
+typedef struct
+{
+    uint32_t counts[PAUSE_STAGE_COUNT][PAUSE_LATENCY_BUCKETS];
+    uint32_t pauses;  // pauses that reached the printer
+} pause_latency_histogram_t;
+
+// Follows one pause at a time through the stages and adds each delta to a histogram for the
+// current print and one since boot. Fed from loop() and the sensor task; read from the web server.
+class PauseLatency
+{
+   private:
+    std::mutex lock;
+
+    pause_latency_histogram_t printHistogram;
+    pause_latency_histogram_t bootHistogram;
+
+    // Pause being followed
+    bool           active;
+    pause_timing_t timing;
+    bool           sent;
+    uint32_t       sentMicros;
+    bool           acked;
+    uint32_t       lastDelta[PAUSE_STAGE_COUNT];  // most recent value of each stage, 0 if none
+
+    void record(pause_stage_t stage, uint32_t from, uint32_t to);
+
+   public:
+    PauseLatency();
+
+    // A pause decision has been taken, starts following it
+    void begin(const pause_timing_t &decision);
+    void markSent(uint32_t micros);
+    void markAck(uint32_t micros);
+    void markPaused(uint32_t micros);
+
+    // Clears the per-print histogram, called when a new print starts
+    void resetPrint();
+
+    // {"bucket_us":[...],"stages":[...],"last_us":{...},"print":{...},"boot":{...}}
+    void toJson(JsonDocument &doc);
+};
+
+#endif  // PAUSE_LATENCY_H
@@ -0,0 +1,37 @@
+#ifndef PRINTER_CONFIG_H
+#define PRINTER_CONFIG_H
+
+// Printers the settings have room for. Part of the stored settings layout, changing it needs a
+// new SETTINGS_BLOB_VERSION.
+#define MAX_PRINTERS 4
+
+// Printers monitored by this build, each with its own sensors, connection and settings
+#ifndef PRINTER_COUNT
+#define PRINTER_COUNT 1
+#endif
+
+#if PRINTER_COUNT < 1 || PRINTER_COUNT > MAX_PRINTERS
+#error "PRINTER_COUNT must be between 1 and MAX_PRINTERS"
+#endif
+
+// Pin definitions - can be overridden via build flags
+#ifndef FILAMENT_RUNOUT_PIN
+#define FILAMENT_RUNOUT_PIN 12
+#endif
+
+#ifndef MOVEMENT_SENSOR_PIN
+#define MOVEMENT_SENSOR_PIN 13
+#endif
+
+// Sensor pins per printer, printer 0 uses the pins above and only the first PRINTER_COUNT are
+// used. The others are free on both the ESP32 and the ESP32-S3 dev boards; 16 and 17 are PSRAM on
+// WROVER modules, override them there.
+#ifndef PRINTER_RUNOUT_PINS
+#define PRINTER_RUNOUT_PINS {FILAMENT_RUNOUT_PIN, 14, 17, 21}
+#endif
+
+#ifndef PRINTER_MOVEMENT_PINS
+#define PRINTER_MOVEMENT_PINS {MOVEMENT_SENSOR_PIN, 4, 16, 18}
+#endif
+
+#endif  // PRINTER_CONFIG_H
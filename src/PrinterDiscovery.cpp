@@ -0,0 +1,138 @@
+#include "PrinterDiscovery.h"
+
+#include "Logger.h"
+#include "PrinterConfig.h"
+#include "SettingsManager.h"
+
+PrinterDiscovery &PrinterDiscovery::getInstance()
+{
+    static PrinterDiscovery instance;
+    return instance;
+}
+
+PrinterDiscovery::PrinterDiscovery()
+{
+    listening  = false;
+    searched   = false;
+    lastSearch = 0;
+    foundCount = 0;
+}
+
+void PrinterDiscovery::search()
+{
+    unsigned long now = millis();
+    if (searched && now - lastSearch < DISCOVERY_INTERVAL_MS)
+    {
+        return;
+    }
+
+    // Any local port, the printers reply to the one the request came from
+    if (!listening)
+    {
+        udp.onPacket([this](AsyncUDPPacket &packet) { this->onPacket(packet); });
+        listening = udp.listen(0);
+        if (!listening)
+        {
+            logger.log("Printer discovery could not open a UDP socket");
+            return;
+        }
+    }
+
+    searched   = true;
+    lastSearch = now;
+    udp.broadcastTo(SDCP_DISCOVERY_MESSAGE, SDCP_DISCOVERY_PORT);
+}
+
+void PrinterDiscovery::onPacket(AsyncUDPPacket &packet)
+{
+    sdcp_message_t message;
+    parseSdcpMessage((const char *) packet.data(), packet.length(), message);
+    if (!(message.fields & SDCP_FIELD_MAINBOARD_ID) || !(message.fields & SDCP_FIELD_MAINBOARD_IP) ||
+        message.mainboardId[0] == '\0' || message.mainboardIp[0] == '\0')
+    {
+        return;
+    }
+
+    unsigned long now = millis();
+    bool          changed;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        int                         slot = 0;
+        while (slot < foundCount && strcmp(found[slot].mainboardId, message.mainboardId) != 0)
+        {
+            slot++;
+        }
+        if (slot == foundCount)
+        {
+            if (foundCount < DISCOVERY_MAX_PRINTERS)
+            {
+                foundCount++;
+            }
+            else
+            {
+                slot = 0;
+                for (int i = 1; i < foundCount; i++)
+                {
+                    if (now - found[i].seenAt > now - found[slot].seenAt)
+                    {
+                        slot = i;
+                    }
+                }
+            }
+            found[slot].ip[0] = '\0';
+            snprintf(found[slot].mainboardId, sizeof(found[slot].mainboardId), "%s",
+                     message.mainboardId);
+        }
+        changed = strcmp(found[slot].ip, message.mainboardIp) != 0;
+        snprintf(found[slot].ip, sizeof(found[slot].ip), "%s", message.mainboardIp);
+        found[slot].seenAt = now;
+    }
+
+    if (changed)
+    {
+        logger.logf("Discovered printer %s at %s", message.mainboardId, message.mainboardIp);
+    }
+}
+
+bool PrinterDiscovery::find(const char *mainboardId, String &ip)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (int i = 0; i < foundCount; i++)
+    {
+        if (strcmp(found[i].mainboardId, mainboardId) == 0)
+        {
+            ip = found[i].ip;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Already monitored, by MainboardID or by the address it answered from
+bool PrinterDiscovery::isClaimed(const discovered_printer_t &printer)
+{
+    for (int i = 0; i < PRINTER_COUNT; i++)
+    {
+        if (settingsManager.getMainboardID(i) == printer.mainboardId ||
+            settingsManager.getElegooIP(i) == printer.ip)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PrinterDiscovery::findUnclaimed(String &mainboardId, String &ip)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (int i = 0; i < foundCount; i++)
+    {
+        if (!isClaimed(found[i]))
+        {
+            mainboardId = found[i].mainboardId;
+            ip          = found[i].ip;
+            return true;
+        }
+    }
+    return false;
+}
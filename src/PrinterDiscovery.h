@@ -0,0 +1,69 @@
+#ifndef PRINTER_DISCOVERY_H
+#define PRINTER_DISCOVERY_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+
+#include <mutex>
+
+#include "SdcpParser.h"
+
+// SDCP discovery: printers answer this broadcast on this port with their MainboardID and address
+#define SDCP_DISCOVERY_PORT 3000
+#define SDCP_DISCOVERY_MESSAGE "M99999"
+
+// Printers remembered from discovery replies, the one heard from longest ago makes room
+#define DISCOVERY_MAX_PRINTERS 8
+// Searches closer together than this share one broadcast, so several printers looking at once
+// don't flood the network
+#define DISCOVERY_INTERVAL_MS 5000
+
+typedef struct
+{
+    char          mainboardId[SDCP_MAINBOARD_ID_SIZE];
+    char          ip[SDCP_MAINBOARD_IP_SIZE];
+    unsigned long seenAt;  // millis() of the last reply
+} discovered_printer_t;
+
+// Finds printers on the local network the way the slicer does, so a printer can be found by its
+// MainboardID when DHCP gives it a new address. Replies are collected in the background (the
+// AsyncUDP task on the device, a receive thread on the host); search() and the lookups are called
+// from loop().
+class PrinterDiscovery
+{
+   private:
+    AsyncUDP      udp;
+    bool          listening;
+    bool          searched;
+    unsigned long lastSearch;
+
+    // Written by the UDP task
+    std::mutex           lock;
+    discovered_printer_t found[DISCOVERY_MAX_PRINTERS];
+    int                  foundCount;
+
+    PrinterDiscovery();
+
+    PrinterDiscovery(const PrinterDiscovery &)            = delete;
+    PrinterDiscovery &operator=(const PrinterDiscovery &) = delete;
+
+    void onPacket(AsyncUDPPacket &packet);
+    bool isClaimed(const discovered_printer_t &printer);
+
+   public:
+    static PrinterDiscovery &getInstance();
+
+    // Broadcasts a discovery request unless one went out in the last DISCOVERY_INTERVAL_MS.
+    // Replies arrive later, look for them with the lookups below.
+    void search();
+
+    // Address the printer with this MainboardID last answered from
+    bool find(const char *mainboardId, String &ip);
+
+    // A printer that answered and is not configured for any monitored printer yet
+    bool findUnclaimed(String &mainboardId, String &ip);
+};
+
+#define printerDiscovery PrinterDiscovery::getInstance()
+
+#endif  // PRINTER_DISCOVERY_H
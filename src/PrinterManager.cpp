@@ -0,0 +1,162 @@
+#include "PrinterManager.h"
+
+#include "Logger.h"
+
+static const uint8_t runoutPins[MAX_PRINTERS]   = PRINTER_RUNOUT_PINS;
+static const uint8_t movementPins[MAX_PRINTERS] = PRINTER_MOVEMENT_PINS;
+
+PrinterManager &PrinterManager::getInstance()
+{
+    static PrinterManager instance;
+    return instance;
+}
+
+PrinterManager::PrinterManager()
+{
+    for (int i = 0; i < PRINTER_COUNT; i++)
+    {
+        printers[i] = new ElegooCC(i, runoutPins[i], movementPins[i]);
+    }
+    sensorTaskRunning = false;
+#ifdef ESP32
+    sensorTask = nullptr;
+#else
+    stopSensorThread = false;
+#endif
+}
+
+void PrinterManager::beginSensors()
+{
+    for (int i = 0; i < PRINTER_COUNT; i++)
+    {
+        pinMode(runoutPins[i], INPUT_PULLUP);
+        pinMode(movementPins[i], INPUT_PULLUP);
+        printers[i]->beginSensors(&sensorWake);
+    }
+}
+
+void PrinterManager::startSensorTask()
+{
+    if (sensorTaskRunning)
+    {
+        return;
+    }
+    sensorTaskRunning = true;
+    for (int i = 0; i < PRINTER_COUNT; i++)
+    {
+        printers[i]->setSensorTaskRunning(true);
+    }
+#ifdef ESP32
+    xTaskCreatePinnedToCore(PrinterManager::sensorTaskMain, "sensors", SENSOR_TASK_STACK_SIZE,
+                            this, SENSOR_TASK_PRIORITY, &sensorTask, SENSOR_TASK_CORE);
+#else
+    stopSensorThread = false;
+    sensorThread     = std::thread(PrinterManager::sensorTaskMain, this);
+#endif
+    logger.logf("Sensor task started for %d printer(s), event driven with a %d ms fallback period",
+                PRINTER_COUNT, SENSOR_TASK_PERIOD_MS);
+}
+
+void PrinterManager::stopSensorTask()
+{
+    if (!sensorTaskRunning)
+    {
+        return;
+    }
+#ifdef ESP32
+    vTaskDelete(sensorTask);
+    sensorTask = nullptr;
+    sensorWake.end();
+#else
+    stopSensorThread = true;
+    sensorWake.notify();
+    sensorThread.join();
+    sensorWake.end();
+#endif
+    for (int i = 0; i < PRINTER_COUNT; i++)
+    {
+        printers[i]->setSensorTaskRunning(false);
+    }
+    sensorTaskRunning = false;
+}
+
+void PrinterManager::sensorTaskMain(void *arg)
+{
+    PrinterManager *self = static_cast<PrinterManager *>(arg);
+    self->sensorWake.begin();
+#ifdef ESP32
+    for (;;)
+#else
+    while (!self->stopSensorThread)
+#endif
+    {
+        self->sensorTick(millis());
+        self->armMovementDeadline();
+        self->sensorWake.wait(SENSOR_TASK_PERIOD_MS);
+    }
+}
+
+void PrinterManager::sensorTick(unsigned long currentTime)
+{
+    for (int i = 0; i < PRINTER_COUNT; i++)
+    {
+        printers[i]->sensorTick(currentTime);
+    }
+}
+
+// Arms the timer for the movement deadline that runs out first. A wakeup for one printer ticks
+// them all, which re-arms it for the next one.
+void PrinterManager::armMovementDeadline()
+{
+    uint32_t now      = micros();
+    bool     found    = false;
+    int32_t  earliest = 0;
+    for (int i = 0; i < PRINTER_COUNT; i++)
+    {
+        uint32_t deadline;
+        if (!printers[i]->getMovementDeadline(deadline))
+        {
+            continue;
+        }
+        // Relative to now, so the comparison survives micros() wrapping
+        int32_t remaining = (int32_t) (deadline - now);
+        if (!found || remaining < earliest)
+        {
+            earliest = remaining;
+            found    = true;
+        }
+    }
+
+    if (found)
+    {
+        sensorWake.arm(now + earliest);
+    }
+    else
+    {
+        sensorWake.disarm();
+    }
+}
+
+void PrinterManager::setup()
+{
+    for (int i = 0; i < PRINTER_COUNT; i++)
+    {
+        printers[i]->setup();
+    }
+}
+
+void PrinterManager::loop()
+{
+    for (int i = 0; i < PRINTER_COUNT; i++)
+    {
+        printers[i]->loop();
+    }
+}
+
+void PrinterManager::disarm()
+{
+    for (int i = 0; i < PRINTER_COUNT; i++)
+    {
+        printers[i]->disarm();
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef PRINTER_MANAGER_H
+#define PRINTER_MANAGER_H
+
+#include <Arduino.h>
+
+#include <atomic>
+#ifndef ESP32
+#include <thread>
+#endif
+
+#include "ElegooCC.h"
+#include "PrinterConfig.h"
+#include "SensorWake.h"
+
+// The PRINTER_COUNT printers this device monitors, and the one sensor task they share. The task
+// ticks every printer on each wakeup and arms the wake timer for whichever movement deadline runs
+// out first, so more printers cost no extra task stacks.
+class PrinterManager
+{
+   private:
+    ElegooCC  *printers[PRINTER_COUNT];
+    SensorWake sensorWake;
+
+    bool sensorTaskRunning;
+#ifdef ESP32
+    TaskHandle_t sensorTask;
+#else
+    std::thread       sensorThread;
+    std::atomic<bool> stopSensorThread;
+#endif
+
+    PrinterManager();
+
+    PrinterManager(const PrinterManager &)            = delete;
+    PrinterManager &operator=(const PrinterManager &) = delete;
+
+    void        sensorTick(unsigned long currentTime);
+    void        armMovementDeadline();
+    static void sensorTaskMain(void *arg);
+
+   public:
+    static PrinterManager &getInstance();
+
+    int count() const
+    {
+        return PRINTER_COUNT;
+    }
+
+    // Printer index, 0 to count() - 1
+    ElegooCC &get(int index)
+    {
+        return *printers[index];
+    }
+
+    // Null when there is no such printer, for indexes that come from requests
+    ElegooCC *find(int index)
+    {
+        return index >= 0 && index < PRINTER_COUNT ? printers[index] : nullptr;
+    }
+
+    // Sets up the sensor pins and interrupts, called once from setup() before networking starts
+    void beginSensors();
+
+    // Move sensor sampling and the pause decision from loop() into their own task (a pinned
+    // FreeRTOS task on the device, a std::thread on the host)
+    void startSensorTask();
+    void stopSensorTask();
+
+    void setup();
+    void loop();
+
+    // Stop every printer from pausing while loop() is not being called (e.g. WiFi is down)
+    void disarm();
+};
+
+#define printerManager PrinterManager::getInstance()
+
+#endif  // PRINTER_MANAGER_H
@@ -0,0 +1,123 @@
+#include "SdcpCommand.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+#include "ElegooCC.h"
+
+// Appends a string to a frame, leaving room for the terminator
+static void appendFrame(char *data, size_t &length, const char *text)
+{
+    size_t textLength = strlen(text);
+    if (length + textLength >= SDCP_COMMAND_FRAME_SIZE)
+    {
+        textLength = SDCP_COMMAND_FRAME_SIZE - 1 - length;
+    }
+    memcpy(data + length, text, textLength);
+    length += textLength;
+    data[length] = '\0';
+}
+
+SdcpCommandEncoder::SdcpCommandEncoder()
+{
+    // RequestIDs only have to be unique on this connection, a seeded xorshift is plenty
+    rngState = ((uint64_t) random(0x7fffffff) << 32) ^ (uint64_t) random(0x7fffffff) ^ micros();
+    if (rngState == 0)
+    {
+        rngState = 0x9E3779B97F4A7C15ULL;
+    }
+    requestID[0] = '\0';
+    lastFrame    = &commandFrame;
+    setMainboardID("");
+}
+
+void SdcpCommandEncoder::setMainboardID(const char *id)
+{
+    snprintf(mainboardID, sizeof(mainboardID), "%s", id);
+    buildTemplate(pauseFrame, SDCP_COMMAND_PAUSE_PRINT);
+    buildTemplate(commandFrame, SDCP_COMMAND_STATUS);
+}
+
+// Lays out everything up to the TimeStamp value, leaving zeroed slots for the two IDs
+void SdcpCommandEncoder::buildTemplate(sdcp_frame_t &frame, int command)
+{
+    char emptyID[SDCP_REQUEST_ID_SIZE];
+    memset(emptyID, '0', SDCP_REQUEST_ID_LENGTH);
+    emptyID[SDCP_REQUEST_ID_LENGTH] = '\0';
+
+    char commandText[12];
+    snprintf(commandText, sizeof(commandText), "%d", command);
+
+    frame.command = command;
+    frame.length  = 0;
+    appendFrame(frame.data, frame.length, "{\"Id\":\"");
+    frame.idOffset = frame.length;
+    appendFrame(frame.data, frame.length, emptyID);
+    appendFrame(frame.data, frame.length, "\",\"Data\":{\"Cmd\":");
+    appendFrame(frame.data, frame.length, commandText);
+    appendFrame(frame.data, frame.length, ",\"Data\":{},\"RequestID\":\"");
+    frame.requestIdOffset = frame.length;
+    appendFrame(frame.data, frame.length, emptyID);
+    appendFrame(frame.data, frame.length, "\",\"MainboardID\":\"");
+    appendFrame(frame.data, frame.length, mainboardID);
+    appendFrame(frame.data, frame.length, "\",\"TimeStamp\":");
+    frame.timestampOffset = frame.length;
+}
+
+uint64_t SdcpCommandEncoder::nextRandom()
+{
+    // xorshift64*
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 0x2545F4914F6CDD1DULL;
+}
+
+void SdcpCommandEncoder::nextRequestID()
+{
+    static const char hex[] = "0123456789abcdef";
+    for (int half = 0; half < 2; half++)
+    {
+        uint64_t bits = nextRandom();
+        for (int i = 0; i < 16; i++)
+        {
+            requestID[half * 16 + i] = hex[bits & 0x0F];
+            bits >>= 4;
+        }
+    }
+    requestID[SDCP_REQUEST_ID_LENGTH] = '\0';
+}
+
+size_t SdcpCommandEncoder::encode(int command, unsigned long timestamp)
+{
+    sdcp_frame_t &frame = command == SDCP_COMMAND_PAUSE_PRINT ? pauseFrame : commandFrame;
+    if (frame.command != command)
+    {
+        buildTemplate(frame, command);
+    }
+
+    nextRequestID();
+    memcpy(frame.data + frame.idOffset, requestID, SDCP_REQUEST_ID_LENGTH);
+    memcpy(frame.data + frame.requestIdOffset, requestID, SDCP_REQUEST_ID_LENGTH);
+
+    // TimeStamp varies in width, so it and the fixed tail are written after the template
+    char   digits[20];
+    size_t count = 0;
+    do
+    {
+        digits[count++] = '0' + (timestamp % 10);
+        timestamp /= 10;
+    } while (timestamp > 0 && count < sizeof(digits));
+
+    frame.length = frame.timestampOffset;
+    while (count > 0 && frame.length < SDCP_COMMAND_FRAME_SIZE - 1)
+    {
+        frame.data[frame.length++] = digits[--count];
+    }
+    // I don't know if "From" is used, but octoeverywhere sets theirs to 0, and the web client sets
+    // it to 1, so we'll choose 2?
+    appendFrame(frame.data, frame.length, ",\"From\":2}}");
+
+    lastFrame = &frame;
+    return frame.length;
+}
@@ -0,0 +1,52 @@
+#ifndef SDCP_COMMAND_H
+#define SDCP_COMMAND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SdcpParser.h"
+
+#define SDCP_COMMAND_FRAME_SIZE 256  // longest frame is ~210 bytes
+#define SDCP_REQUEST_ID_LENGTH (SDCP_REQUEST_ID_SIZE - 1)
+
+// Builds SDCP command frames into fixed buffers. Everything except the RequestID and TimeStamp
+// is laid out once per command and MainboardID, so sending only patches those two in place.
+class SdcpCommandEncoder
+{
+   private:
+    typedef struct
+    {
+        char   data[SDCP_COMMAND_FRAME_SIZE];
+        size_t length;
+        int    command;
+        size_t idOffset;
+        size_t requestIdOffset;
+        size_t timestampOffset;
+    } sdcp_frame_t;
+
+    char         mainboardID[SDCP_MAINBOARD_ID_SIZE];
+    sdcp_frame_t pauseFrame;    // prebuilt so a pause never has to lay out a frame
+    sdcp_frame_t commandFrame;  // last other command, normally the status poll
+    sdcp_frame_t *lastFrame;
+    char         requestID[SDCP_REQUEST_ID_SIZE];
+    uint64_t     rngState;
+
+    void     buildTemplate(sdcp_frame_t &frame, int command);
+    void     nextRequestID();
+    uint64_t nextRandom();
+
+   public:
+    SdcpCommandEncoder();
+
+    // Rebuilds the cached frames when the printer's MainboardID becomes known or changes
+    void setMainboardID(const char *id);
+
+    // Encodes a command with a fresh RequestID and returns the frame length. The frame and
+    // RequestID stay valid until the next call.
+    size_t encode(int command, unsigned long timestamp);
+
+    const char *frame() const { return lastFrame->data; }
+    const char *requestId() const { return requestID; }
+};
+
+#endif  // SDCP_COMMAND_H
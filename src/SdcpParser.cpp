@@ -0,0 +1,599 @@
+#include "SdcpParser.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Objects nested deeper than this are rejected; SDCP messages are at most four levels deep
+#define SDCP_MAX_DEPTH 12
+
+namespace
+{
+
+// Which object (or array) the parser is currently inside
+typedef enum
+{
+    CTX_SKIP,
+    CTX_ROOT,
+    CTX_DATA,            // Data
+    CTX_DATA_DATA,       // Data.Data
+    CTX_STATUS,          // Status
+    CTX_PRINT_INFO,      // Status.PrintInfo
+    CTX_CURRENT_STATUS,  // Status.CurrentStatus
+} sdcp_context_t;
+
+class SdcpReader
+{
+   private:
+    const char     *p;
+    const char     *end;
+    sdcp_message_t &message;
+
+    typedef struct
+    {
+        const char *data;
+        size_t      length;
+    } token_t;
+
+    static bool keyIs(const token_t &key, const char *name)
+    {
+        size_t length = strlen(name);
+        return key.length == length && memcmp(key.data, name, length) == 0;
+    }
+
+    void skipWhitespace()
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        {
+            p++;
+        }
+    }
+
+    // Reads a string starting at the opening quote. The raw (still escaped) contents are
+    // returned in raw; if out is given, the unescaped value is copied into it, truncated to size.
+    bool readString(token_t &raw, char *out, size_t size)
+    {
+        p++;  // opening quote
+        raw.data     = p;
+        size_t count = 0;
+        while (p < end && *p != '"')
+        {
+            char c = *p++;
+            if (c == '\\')
+            {
+                if (p >= end)
+                {
+                    return false;
+                }
+                c = *p++;
+                if (c == 'u')
+                {
+                    // Not used by any field we extract, keep a placeholder
+                    p += 4;
+                    c = '?';
+                }
+                else if (c == 'n')
+                {
+                    c = '\n';
+                }
+                else if (c == 't')
+                {
+                    c = '\t';
+                }
+            }
+            if (out && count + 1 < size)
+            {
+                out[count++] = c;
+            }
+        }
+        if (p >= end)
+        {
+            return false;
+        }
+        raw.length = p - raw.data;
+        p++;  // closing quote
+        if (out && size > 0)
+        {
+            out[count] = '\0';
+        }
+        return true;
+    }
+
+    // Numbers and true/false/null
+    bool readLiteral(token_t &token)
+    {
+        token.data = p;
+        while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' &&
+               *p != '\n' && *p != '\r')
+        {
+            p++;
+        }
+        token.length = p - token.data;
+        return token.length > 0;
+    }
+
+    static bool toNumber(const token_t &token, double &value)
+    {
+        char buffer[32];
+        if (token.length == 0 || token.length >= sizeof(buffer))
+        {
+            return false;
+        }
+        memcpy(buffer, token.data, token.length);
+        buffer[token.length] = '\0';
+        char *parsedEnd      = nullptr;
+        value                = strtod(buffer, &parsedEnd);
+        return parsedEnd != buffer;
+    }
+
+    static int toInt(const token_t &token)
+    {
+        double value = 0;
+        if (!toNumber(token, value))
+        {
+            // true/false behave like ArduinoJson's as<int>()
+            return (token.length == 4 && memcmp(token.data, "true", 4) == 0) ? 1 : 0;
+        }
+        return (int) value;
+    }
+
+    // "x,y,z" -> z
+    static bool coordToZ(const char *coords, float &z)
+    {
+        const char *firstComma = strchr(coords, ',');
+        if (!firstComma)
+        {
+            return false;
+        }
+        const char *secondComma = strchr(firstComma + 1, ',');
+        if (!secondComma)
+        {
+            return false;
+        }
+        z = strtof(secondComma + 1, nullptr);
+        return true;
+    }
+
+    sdcp_context_t childContext(sdcp_context_t parent, const token_t &key)
+    {
+        switch (parent)
+        {
+            case CTX_ROOT:
+                if (keyIs(key, "Data"))
+                {
+                    return CTX_DATA;
+                }
+                if (keyIs(key, "Status"))
+                {
+                    return CTX_STATUS;
+                }
+                break;
+            case CTX_DATA:
+                if (keyIs(key, "Data"))
+                {
+                    return CTX_DATA_DATA;
+                }
+                break;
+            case CTX_STATUS:
+                if (keyIs(key, "PrintInfo"))
+                {
+                    return CTX_PRINT_INFO;
+                }
+                if (keyIs(key, "CurrentStatus"))
+                {
+                    return CTX_CURRENT_STATUS;
+                }
+                break;
+            default:
+                break;
+        }
+        return CTX_SKIP;
+    }
+
+    // Data and Status are flagged as soon as they open so a truncated message is still routed;
+    // PrintInfo only once complete, as its members are applied together
+    void onObjectStart(sdcp_context_t context)
+    {
+        if (context == CTX_DATA)
+        {
+            message.fields |= SDCP_FIELD_DATA;
+        }
+        else if (context == CTX_STATUS)
+        {
+            message.fields |= SDCP_FIELD_STATUS;
+        }
+    }
+
+    void onObjectEnd(sdcp_context_t context)
+    {
+        if (context == CTX_PRINT_INFO)
+        {
+            message.fields |= SDCP_FIELD_PRINT_INFO;
+        }
+    }
+
+    bool parseString(sdcp_context_t context, const token_t &key)
+    {
+        token_t raw;
+        if ((context == CTX_ROOT || context == CTX_DATA) && keyIs(key, "MainboardID"))
+        {
+            if (!readString(raw, message.mainboardId, sizeof(message.mainboardId)))
+            {
+                return false;
+            }
+            message.fields |= SDCP_FIELD_MAINBOARD_ID;
+            return true;
+        }
+        if (context == CTX_DATA && keyIs(key, "MainboardIP"))
+        {
+            if (!readString(raw, message.mainboardIp, sizeof(message.mainboardIp)))
+            {
+                return false;
+            }
+            message.fields |= SDCP_FIELD_MAINBOARD_IP;
+            return true;
+        }
+        if (context == CTX_DATA && keyIs(key, "RequestID"))
+        {
+            if (!readString(raw, message.requestId, sizeof(message.requestId)))
+            {
+                return false;
+            }
+            message.fields |= SDCP_FIELD_REQUEST_ID;
+            return true;
+        }
+        if (context == CTX_STATUS && keyIs(key, "CurrenCoord"))
+        {
+            char coords[48];
+            if (!readString(raw, coords, sizeof(coords)))
+            {
+                return false;
+            }
+            if (coordToZ(coords, message.currentZ))
+            {
+                message.fields |= SDCP_FIELD_COORD_Z;
+            }
+            return true;
+        }
+        return readString(raw, nullptr, 0);
+    }
+
+    void onLiteral(sdcp_context_t context, const token_t &key, const token_t &value)
+    {
+        switch (context)
+        {
+            case CTX_DATA:
+                if (keyIs(key, "Cmd"))
+                {
+                    message.cmd = toInt(value);
+                    message.fields |= SDCP_FIELD_CMD;
+                }
+                break;
+            case CTX_DATA_DATA:
+                if (keyIs(key, "Ack"))
+                {
+                    message.ack = toInt(value);
+                    message.fields |= SDCP_FIELD_ACK;
+                }
+                break;
+            case CTX_PRINT_INFO:
+                if (keyIs(key, "Status"))
+                {
+                    message.printStatus = toInt(value);
+                }
+                else if (keyIs(key, "CurrentLayer"))
+                {
+                    message.currentLayer = toInt(value);
+                }
+                else if (keyIs(key, "TotalLayer"))
+                {
+                    message.totalLayer = toInt(value);
+                }
+                else if (keyIs(key, "Progress"))
+                {
+                    message.progress = toInt(value);
+                }
+                else if (keyIs(key, "CurrentTicks"))
+                {
+                    message.currentTicks = toInt(value);
+                }
+                else if (keyIs(key, "TotalTicks"))
+                {
+                    message.totalTicks = toInt(value);
+                }
+                else if (keyIs(key, "PrintSpeedPct"))
+                {
+                    message.printSpeedPct = toInt(value);
+                }
+                break;
+            case CTX_CURRENT_STATUS:
+                if (message.machineStatusCount < SDCP_MAX_MACHINE_STATUSES)
+                {
+                    message.machineStatuses[message.machineStatusCount++] = toInt(value);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Parses the value at p. key is the member name it belongs to (empty inside arrays).
+    bool parseValue(sdcp_context_t context, const token_t &key, int depth)
+    {
+        skipWhitespace();
+        if (p >= end)
+        {
+            return false;
+        }
+
+        switch (*p)
+        {
+            case '{':
+                return parseObject(childContext(context, key), depth + 1);
+            case '[':
+                return parseArray(childContext(context, key), depth + 1);
+            case '"':
+                return parseString(context, key);
+            default:
+            {
+                token_t value;
+                if (!readLiteral(value))
+                {
+                    return false;
+                }
+                onLiteral(context, key, value);
+                return true;
+            }
+        }
+    }
+
+    bool parseObject(sdcp_context_t context, int depth)
+    {
+        if (depth > SDCP_MAX_DEPTH)
+        {
+            return false;
+        }
+        p++;  // {
+        onObjectStart(context);
+        skipWhitespace();
+        if (p < end && *p == '}')
+        {
+            p++;
+            onObjectEnd(context);
+            return true;
+        }
+        while (p < end)
+        {
+            skipWhitespace();
+            if (p >= end || *p != '"')
+            {
+                return false;
+            }
+            token_t key;
+            if (!readString(key, nullptr, 0))
+            {
+                return false;
+            }
+            skipWhitespace();
+            if (p >= end || *p != ':')
+            {
+                return false;
+            }
+            p++;
+            if (!parseValue(context, key, depth))
+            {
+                return false;
+            }
+            if (context == CTX_ROOT && keyIs(key, "Id"))
+            {
+                message.fields |= SDCP_FIELD_ID;
+            }
+            skipWhitespace();
+            if (p < end && *p == ',')
+            {
+                p++;
+                continue;
+            }
+            if (p < end && *p == '}')
+            {
+                p++;
+                onObjectEnd(context);
+                return true;
+            }
+            return false;
+        }
+        return false;
+    }
+
+    bool parseArray(sdcp_context_t context, int depth)
+    {
+        if (depth > SDCP_MAX_DEPTH)
+        {
+            return false;
+        }
+        p++;  // [
+        skipWhitespace();
+        if (p < end && *p == ']')
+        {
+            p++;
+            if (context == CTX_CURRENT_STATUS)
+            {
+                message.fields |= SDCP_FIELD_CURRENT_STATUS;
+            }
+            return true;
+        }
+        token_t noKey = {"", 0};
+        while (p < end)
+        {
+            if (!parseValue(context, noKey, depth))
+            {
+                return false;
+            }
+            skipWhitespace();
+            if (p < end && *p == ',')
+            {
+                p++;
+                continue;
+            }
+            if (p < end && *p == ']')
+            {
+                p++;
+                if (context == CTX_CURRENT_STATUS)
+                {
+                    message.fields |= SDCP_FIELD_CURRENT_STATUS;
+                }
+                return true;
+            }
+            return false;
+        }
+        return false;
+    }
+
+   public:
+    SdcpReader(const char *payload, size_t length, sdcp_message_t &msg)
+        : p(payload), end(payload + length), message(msg)
+    {
+    }
+
+    bool parse()
+    {
+        skipWhitespace();
+        if (p >= end || *p != '{')
+        {
+            return false;
+        }
+        return parseObject(CTX_ROOT, 0);
+    }
+};
+
+}  // namespace
+
+bool parseSdcpMessage(const char *payload, size_t length, sdcp_message_t &message)
+{
+    memset(&message, 0, sizeof(message));
+    if (!payload || length == 0)
+    {
+        return false;
+    }
+    SdcpReader reader(payload, length, message);
+    return reader.parse();
+}
+
+namespace
+{
+
+// Members left out of hashSdcpPayload(), each with the quote and colon that end its key. All are
+// numbers.
+const char *const volatileKeys[] = {"TimeStamp\":", "TempOfHotbed\":", "TempOfNozzle\":",
+                                    "TempOfBox\":"};
+
+// Length of the volatile key starting at key (just after its opening quote), 0 if there is none
+size_t volatileKeyLength(const char *key, const char *end)
+{
+    for (const char *name : volatileKeys)
+    {
+        size_t length = strlen(name);
+        if ((size_t) (end - key) >= length && memcmp(key, name, length) == 0)
+        {
+            return length;
+        }
+    }
+    return 0;
+}
+
+bool isNumberChar(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+// MurmurHash3 (x86_32), fed in pieces
+uint32_t rotl32(uint32_t x, int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+uint32_t mixBlock(uint32_t hash, uint32_t k)
+{
+    k *= 0xcc9e2d51u;
+    k = rotl32(k, 15);
+    k *= 0x1b873593u;
+    hash ^= k;
+    hash = rotl32(hash, 13);
+    return hash * 5 + 0xe6546b64u;
+}
+
+uint32_t hashBytes(uint32_t hash, const char *data, size_t length)
+{
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4)
+    {
+        uint32_t k;
+        memcpy(&k, data + i, sizeof(k));  // unaligned loads fault on the ESP32
+        hash = mixBlock(hash, k);
+    }
+    uint32_t tail = 0;
+    for (size_t j = length; j > i; j--)
+    {
+        tail = (tail << 8) | (uint8_t) data[j - 1];
+    }
+    return i < length ? mixBlock(hash, tail) : hash;
+}
+
+}  // namespace
+
+uint32_t hashSdcpPayload(const char *payload, size_t length)
+{
+    const char *end    = payload + length;
+    const char *chunk  = payload;  // start of the bytes not hashed yet
+    const char *p      = payload;
+    uint32_t    hash   = 0;
+    size_t      hashed = 0;
+
+    // Every volatile key starts with a T, which is rare enough to search for. A key inside a
+    // string value has its quotes escaped, so it never matches.
+    while (p < end && (p = (const char *) memchr(p, 'T', end - p)) != nullptr)
+    {
+        size_t keyLength = p > payload && p[-1] == '"' ? volatileKeyLength(p, end) : 0;
+        if (keyLength == 0)
+        {
+            p++;
+            continue;
+        }
+        const char *value = p + keyLength;
+        hash   = hashBytes(hash, chunk, value - chunk);
+        hashed += value - chunk;
+        while (value < end && isNumberChar(*value))
+        {
+            value++;
+        }
+        chunk = p = value;
+    }
+    hash   = hashBytes(hash, chunk, end - chunk);
+    hashed += end - chunk;
+
+    // Finalization mix
+    hash ^= hashed;
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+// Slashes are rare in SDCP messages outside the Topic, so each one found is checked for being the
+// one in "sdcp/status/"
+bool isSdcpStatusPush(const char *payload, size_t length)
+{
+    const char *end = payload + length;
+    const char *p   = payload;
+    while (p < end && (p = (const char *) memchr(p, '/', end - p)) != nullptr)
+    {
+        if (p - payload >= 5 && end - p >= 8 && memcmp(p - 5, "\"sdcp", 5) == 0 &&
+            memcmp(p + 1, "status/", 7) == 0)
+        {
+            return true;
+        }
+        p++;
+    }
+    return false;
+}
@@ -0,0 +1,69 @@
+#ifndef SDCP_PARSER_H
+#define SDCP_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SDCP_REQUEST_ID_SIZE 33    // 32 hex characters + terminator
+#define SDCP_MAINBOARD_ID_SIZE 33  // observed IDs are 24 hex characters
+#define SDCP_MAINBOARD_IP_SIZE 16  // dotted IPv4 address + terminator
+#define SDCP_MAX_MACHINE_STATUSES 5
+
+// Bits in sdcp_message_t::fields, set once the corresponding value has been fully read (Data and
+// Status are set when the object opens)
+typedef enum
+{
+    SDCP_FIELD_ID             = 1 << 0,   // Id
+    SDCP_FIELD_DATA           = 1 << 1,   // Data
+    SDCP_FIELD_STATUS         = 1 << 2,   // Status
+    SDCP_FIELD_MAINBOARD_ID   = 1 << 3,   // MainboardID or Data.MainboardID
+    SDCP_FIELD_CMD            = 1 << 4,   // Data.Cmd
+    SDCP_FIELD_REQUEST_ID     = 1 << 5,   // Data.RequestID
+    SDCP_FIELD_ACK            = 1 << 6,   // Data.Data.Ack
+    SDCP_FIELD_CURRENT_STATUS = 1 << 7,   // Status.CurrentStatus
+    SDCP_FIELD_COORD_Z        = 1 << 8,   // Z component of Status.CurrenCoord
+    SDCP_FIELD_PRINT_INFO     = 1 << 9,   // Status.PrintInfo
+    SDCP_FIELD_MAINBOARD_IP   = 1 << 10,  // Data.MainboardIP, in discovery replies
+} sdcp_field_t;
+
+// The subset of an SDCP message that ElegooCC acts on. Missing PrintInfo members read as 0, the
+// same as they did through ArduinoJson.
+typedef struct
+{
+    uint32_t fields;
+
+    // Command acknowledgement
+    int  cmd;
+    int  ack;
+    char requestId[SDCP_REQUEST_ID_SIZE];
+    char mainboardId[SDCP_MAINBOARD_ID_SIZE];
+    char mainboardIp[SDCP_MAINBOARD_IP_SIZE];
+
+    // Status
+    int   machineStatuses[SDCP_MAX_MACHINE_STATUSES];
+    int   machineStatusCount;
+    float currentZ;
+    int   printStatus;
+    int   currentLayer;
+    int   totalLayer;
+    int   progress;
+    int   currentTicks;
+    int   totalTicks;
+    int   printSpeedPct;
+} sdcp_message_t;
+
+// Parses an SDCP websocket payload or discovery reply in a single pass without allocating, extracting only the
+// fields above and skipping everything else. There is no document size limit. Returns false if
+// the payload is malformed or truncated; fields read before the error are still reported.
+bool parseSdcpMessage(const char *payload, size_t length, sdcp_message_t &message);
+
+// Hash of a payload for spotting a message that repeats an earlier one without parsing it. The
+// values of TimeStamp and the temperatures are left out: they change between otherwise identical
+// status messages and nothing reads them. Hashes four bytes at a time, much cheaper than a parse.
+uint32_t hashSdcpPayload(const char *payload, size_t length);
+
+// True when the payload is a status push (Topic "sdcp/status/..."), found by searching for the
+// topic text without parsing. Command replies and other topics are false.
+bool isSdcpStatusPush(const char *payload, size_t length);
+
+#endif  // SDCP_PARSER_H
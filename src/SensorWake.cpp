@@ -0,0 +1,127 @@
+#include "SensorWake.h"
+
+#ifdef ESP32
+static void onDeadline(void *arg)
+{
+    static_cast<SensorWake *>(arg)->notify();
+}
+#endif
+
+SensorWake::SensorWake()
+{
+#ifdef ESP32
+    task  = nullptr;
+    timer = nullptr;
+#else
+    pending = false;
+#endif
+    armed          = false;
+    deadlineMicros = 0;
+}
+
+void SensorWake::begin()
+{
+#ifdef ESP32
+    if (!timer)
+    {
+        esp_timer_create_args_t args = {};
+        args.callback                = onDeadline;
+        args.arg                     = this;
+        args.name                    = "sensor_deadline";
+        esp_timer_create(&args, &timer);
+    }
+    task = xTaskGetCurrentTaskHandle();
+#endif
+    armed = false;
+}
+
+void SensorWake::end()
+{
+    disarm();
+#ifdef ESP32
+    task = nullptr;
+#endif
+}
+
+void SensorWake::notify()
+{
+#ifdef ESP32
+    TaskHandle_t target = task;
+    if (target)
+    {
+        xTaskNotifyGive(target);
+    }
+#else
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        pending = true;
+    }
+    wake.notify_one();
+#endif
+}
+
+void IRAM_ATTR SensorWake::notifyFromISR()
+{
+#ifdef ESP32
+    TaskHandle_t target = task;
+    if (target)
+    {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(target, &woken);
+        if (woken)
+        {
+            portYIELD_FROM_ISR();
+        }
+    }
+#else
+    // The host "interrupts" run on ordinary threads
+    notify();
+#endif
+}
+
+void SensorWake::arm(uint32_t atMicros)
+{
+    if (armed && atMicros == deadlineMicros)
+    {
+        return;
+    }
+    armed          = true;
+    deadlineMicros = atMicros;
+#ifdef ESP32
+    int32_t remaining = (int32_t) (atMicros - (uint32_t) micros());
+    esp_timer_stop(timer);
+    esp_timer_start_once(timer, remaining > 0 ? remaining : 1);
+#endif
+}
+
+void SensorWake::disarm()
+{
+    if (!armed)
+    {
+        return;
+    }
+    armed = false;
+#ifdef ESP32
+    esp_timer_stop(timer);
+#endif
+}
+
+void SensorWake::wait(uint32_t maxMs)
+{
+#ifdef ESP32
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(maxMs));
+#else
+    int64_t waitMicros = (int64_t) maxMs * 1000;
+    if (armed)
+    {
+        int32_t remaining = (int32_t) (deadlineMicros - (uint32_t) micros());
+        if (remaining < waitMicros)
+        {
+            waitMicros = remaining > 0 ? remaining : 0;
+        }
+    }
+    std::unique_lock<std::mutex> guard(lock);
+    wake.wait_for(guard, std::chrono::microseconds(waitMicros), [this] { return pending; });
+    pending = false;
+#endif
+}
@@ -0,0 +1,53 @@
+#ifndef SENSOR_WAKE_H
+#define SENSOR_WAKE_H
+
+#include <Arduino.h>
+
+#ifdef ESP32
+#include <esp_timer.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+// Wakes the sensor task the moment there is something to decide: a sensor edge (from the ISR), a
+// change of the pause gate (from loop()) or the movement deadline passing. The deadline is a
+// one-shot timer armed for when the next movement edge is due at the latest, so a stall is acted
+// on when the timeout expires instead of on the next poll. On the device the timer is an
+// esp_timer and wakeups are task notifications, on the host a condition variable.
+class SensorWake
+{
+   private:
+#ifdef ESP32
+    TaskHandle_t       task;
+    esp_timer_handle_t timer;
+#else
+    std::mutex              lock;
+    std::condition_variable wake;
+    bool                    pending;
+#endif
+    // Sensor task only
+    bool     armed;
+    uint32_t deadlineMicros;
+
+   public:
+    SensorWake();
+
+    // Binds the wakeups to the calling task, called by the sensor task before it first waits
+    void begin();
+    // Stops the timer and the wakeups, called before the sensor task goes away
+    void end();
+
+    // From any task, and from interrupts with notifyFromISR()
+    void notify();
+    void IRAM_ATTR notifyFromISR();
+
+    // Fires once at atMicros (micros() clock), replacing the deadline armed before
+    void arm(uint32_t atMicros);
+    void disarm();
+
+    // Sensor task: blocks until a wakeup, the deadline or maxMs, whichever comes first
+    void wait(uint32_t maxMs);
+};
+
+#endif  // SENSOR_WAKE_H
@@ -3,6 +3,8 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <LittleFS.h>
+#include <Preferences.h>
+#include <stddef.h>
 #include <stdlib.h>
 
 #include "Logger.h"
@@ -15,83 +17,376 @@ SettingsManager &SettingsManager::getInstance()
 
 SettingsManager::SettingsManager()
 {
-    isLoaded                     = false;
-    requestWifiReconnect         = false;
-    wifiChanged                  = false;
-    settings.ap_mode             = false;
-    settings.ssid                = "";
-    settings.passwd              = "";
-    settings.elegooip            = "";
-    settings.timeout             = 4000;
-    settings.first_layer_timeout = 8000;
-    settings.pause_on_runout     = true;
-    settings.start_print_timeout = 10000;
-    settings.enabled             = true;
-    settings.has_connected       = false;
+    isLoaded               = false;
+    requestWifiReconnect   = false;
+    wifiChanged            = false;
+    generation             = 1;  // consumers start at 0 so their first check refreshes
+    savePending            = false;
+    saveRequestedAt        = 0;
+    savedHash              = 0;
+    storedInNvs            = false;
+    storage                = {};
+    settings.ap_mode       = false;
+    settings.ssid          = "";
+    settings.passwd        = "";
+    settings.has_connected = false;
+    settings.persist_logs  = false;
+    for (printer_settings &printer : settings.printers)
+    {
+        printer.elegooip            = "";
+        printer.mainboard_id        = "";
+        printer.timeout             = 4000;
+        printer.first_layer_timeout = 8000;
+        printer.pause_on_runout     = true;
+        printer.start_print_timeout = 10000;
+        printer.enabled             = true;
+        printer.adaptive_timeout    = false;
+        printer.adaptive_quantile   = 99.0f;
+        printer.adaptive_margin     = 500;
+        printer.mm_per_pulse        = 2.88f;
+    }
+}
+
+// Layout of one printer's settings in the NVS blob
+struct settings_printer_blob
+{
+    char    elegooip[64];
+    char    mainboard_id[33];
+    uint8_t pause_on_runout;
+    uint8_t enabled;
+    uint8_t adaptive_timeout;
+    int32_t timeout;
+    int32_t first_layer_timeout;
+    int32_t start_print_timeout;
+    int32_t adaptive_margin;
+    float   adaptive_quantile;
+    float   mm_per_pulse;
+};
+
+// Layout of the settings in NVS. Bump SETTINGS_BLOB_VERSION whenever it changes; a blob with
+// an unknown version is ignored and the defaults are used instead.
+struct settings_blob
+{
+    uint16_t              version;
+    uint16_t              size;
+    char                  ssid[33];
+    char                  passwd[65];
+    uint8_t               ap_mode;
+    uint8_t               has_connected;
+    uint8_t               persist_logs;
+    settings_printer_blob printers[MAX_PRINTERS];
+
+    // Kept last, the change hash covers everything before it
+    settings_storage_stats storage;
+};
+
+static void copyString(char *out, size_t size, const String &value)
+{
+    snprintf(out, size, "%s", value.c_str());
+}
+
+static uint32_t hashBlob(const settings_blob &blob)
+{
+    // FNV-1a
+    const uint8_t *bytes = (const uint8_t *) &blob;
+    uint32_t       hash  = 2166136261u;
+    for (size_t i = 0; i < offsetof(settings_blob, storage); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void SettingsManager::pack(settings_blob &blob)
+{
+    // Zeroed so padding and unused string bytes hash the same every time
+    memset(&blob, 0, sizeof(blob));
+    blob.version = SETTINGS_BLOB_VERSION;
+    blob.size    = sizeof(blob);
+
+    std::lock_guard<std::mutex> guard(stringLock);
+    copyString(blob.ssid, sizeof(blob.ssid), settings.ssid);
+    copyString(blob.passwd, sizeof(blob.passwd), settings.passwd);
+    blob.ap_mode       = settings.ap_mode;
+    blob.has_connected = settings.has_connected;
+    blob.persist_logs  = settings.persist_logs;
+    for (int i = 0; i < MAX_PRINTERS; i++)
+    {
+        const printer_settings &printer = settings.printers[i];
+        settings_printer_blob  &out     = blob.printers[i];
+        copyString(out.elegooip, sizeof(out.elegooip), printer.elegooip);
+        copyString(out.mainboard_id, sizeof(out.mainboard_id), printer.mainboard_id);
+        out.pause_on_runout     = printer.pause_on_runout;
+        out.enabled             = printer.enabled;
+        out.adaptive_timeout    = printer.adaptive_timeout;
+        out.timeout             = printer.timeout;
+        out.first_layer_timeout = printer.first_layer_timeout;
+        out.start_print_timeout = printer.start_print_timeout;
+        out.adaptive_margin     = printer.adaptive_margin;
+        out.adaptive_quantile   = printer.adaptive_quantile;
+        out.mm_per_pulse        = printer.mm_per_pulse;
+    }
+    blob.storage = storage;
+}
+
+void SettingsManager::unpack(settings_blob &blob)
+{
+    blob.ssid[sizeof(blob.ssid) - 1]     = '\0';
+    blob.passwd[sizeof(blob.passwd) - 1] = '\0';
+
+    std::lock_guard<std::mutex> guard(stringLock);
+    settings.ssid          = blob.ssid;
+    settings.passwd        = blob.passwd;
+    settings.ap_mode       = blob.ap_mode;
+    settings.has_connected = blob.has_connected;
+    settings.persist_logs  = blob.persist_logs;
+    for (int i = 0; i < MAX_PRINTERS; i++)
+    {
+        settings_printer_blob &in      = blob.printers[i];
+        printer_settings      &printer = settings.printers[i];
+        in.elegooip[sizeof(in.elegooip) - 1]         = '\0';
+        in.mainboard_id[sizeof(in.mainboard_id) - 1] = '\0';
+
+        printer.elegooip            = in.elegooip;
+        printer.mainboard_id        = in.mainboard_id;
+        printer.pause_on_runout     = in.pause_on_runout;
+        printer.enabled             = in.enabled;
+        printer.adaptive_timeout    = in.adaptive_timeout;
+        printer.timeout             = in.timeout;
+        printer.first_layer_timeout = in.first_layer_timeout;
+        printer.start_print_timeout = in.start_print_timeout;
+        printer.adaptive_margin     = in.adaptive_margin;
+        printer.adaptive_quantile   = in.adaptive_quantile;
+        printer.mm_per_pulse        = in.mm_per_pulse;
+    }
+    storage = blob.storage;
 }
 
 bool SettingsManager::load()
 {
-    File file = LittleFS.open("/user_settings.json", "r");
+    settings_blob blob;
+    Preferences   prefs;
+    bool          found = false;
+
+    if (prefs.begin(SETTINGS_NVS_NAMESPACE, true))
+    {
+        found = prefs.getBytesLength(SETTINGS_NVS_KEY) == sizeof(blob) &&
+                prefs.getBytes(SETTINGS_NVS_KEY, &blob, sizeof(blob)) == sizeof(blob) &&
+                blob.version == SETTINGS_BLOB_VERSION;
+        prefs.end();
+    }
+
+    isLoaded    = true;
+    storedInNvs = found;
+    if (!found)
+    {
+        logger.log("No settings stored, using defaults");
+        savedHash = 0;
+        generation++;
+        return false;
+    }
+
+    unpack(blob);
+    savedHash = hashBlob(blob);
+    generation++;
+    return true;
+}
+
+bool SettingsManager::readFile(const char *path, JsonDocument &doc)
+{
+    File file = LittleFS.open(path, "r");
     if (!file)
     {
-        logger.log("Settings file not found, using defaults");
-        isLoaded = true;
         return false;
     }
 
-    StaticJsonDocument<1024> doc;
-    DeserializationError     error = deserializeJson(doc, file);
+    DeserializationError error = deserializeJson(doc, file);
     file.close();
 
     if (error)
     {
-        logger.log("Settings JSON parsing error, using defaults");
-        isLoaded = true;
+        logger.logf("Settings JSON parsing error in %s", path);
         return false;
     }
-
-    settings.ap_mode             = doc["ap_mode"] | false;
-    settings.ssid                = doc["ssid"] | "";
-    settings.passwd              = doc["passwd"] | "";
-    settings.elegooip            = doc["elegooip"] | "";
-    settings.timeout             = doc["timeout"] | 4000;
-    settings.first_layer_timeout = doc["first_layer_timeout"] | 8000;
-    settings.pause_on_runout     = doc["pause_on_runout"] | true;
-    settings.enabled             = doc["enabled"] | true;
-    settings.start_print_timeout = doc["start_print_timeout"] | 10000;
-    settings.has_connected       = doc["has_connected"] | false;
-
-    isLoaded = true;
     return true;
 }
 
-bool SettingsManager::save(bool skipWifiCheck)
+bool SettingsManager::migrateFromFile()
 {
-    String output = toJson(true);
+    if (!isLoaded)
+        load();
+    if (storedInNvs)
+    {
+        return false;
+    }
 
-    File file = LittleFS.open("/user_settings.json", "w");
-    if (!file)
+    // Older firmware saved through a temp file, which is the newest copy if the rename never ran
+    StaticJsonDocument<1024> doc;
+    if (!readFile(SETTINGS_FILE, doc) && !readFile(SETTINGS_TEMP_FILE, doc))
     {
-        logger.log("Failed to open settings file for writing");
         return false;
     }
 
-    if (file.print(output) == 0)
+    applyJson(doc.as<JsonObjectConst>());
+    storage.writes  = doc["storage"]["writes"] | 0;
+    storage.skipped = doc["storage"]["skipped"] | 0;
+    storage.bytes   = doc["storage"]["bytes"] | 0;
+    storage.erases  = doc["storage"]["erases"] | 0;
+    wifiChanged     = false;  // same credentials as before, nothing to reconnect
+
+    if (!writeBlob())
     {
-        logger.log("Failed to write settings to file");
-        file.close();
         return false;
     }
+    LittleFS.remove(SETTINGS_FILE);
+    LittleFS.remove(SETTINGS_TEMP_FILE);
+    logger.log("Settings migrated from " SETTINGS_FILE);
+    return true;
+}
+
+void SettingsManager::applyJson(JsonObjectConst json)
+{
+    if (json.containsKey("ssid"))
+        setSSID(json["ssid"].as<String>());
+    // An empty password means "unchanged", the settings page never receives the stored one
+    if (json.containsKey("passwd") && json["passwd"].as<String>().length() > 0)
+        setPassword(json["passwd"].as<String>());
+    if (json.containsKey("ap_mode"))
+        setAPMode(json["ap_mode"].as<bool>());
+    if (json.containsKey("has_connected"))
+        setHasConnected(json["has_connected"].as<bool>());
+    if (json.containsKey("persist_logs"))
+        setPersistLogs(json["persist_logs"].as<bool>());
+
+    applyPrinterJson(json, 0);
+    JsonArrayConst printers = json["printers"];
+    for (size_t i = 0; i < printers.size(); i++)
+    {
+        applyPrinterJson(printers[i], i);
+    }
+}
+
+void SettingsManager::applyPrinterJson(JsonObjectConst json, int printer)
+{
+    if (json.containsKey("elegooip"))
+    {
+        String ip = json["elegooip"].as<String>();
+        // Another address may be another printer, don't let discovery move it back
+        if (!json.containsKey("mainboard_id") && ip != getElegooIP(printer))
+            setMainboardID("", printer);
+        setElegooIP(ip, printer);
+    }
+    if (json.containsKey("mainboard_id"))
+        setMainboardID(json["mainboard_id"].as<String>(), printer);
+    if (json.containsKey("timeout"))
+        setTimeout(json["timeout"].as<int>(), printer);
+    if (json.containsKey("first_layer_timeout"))
+        setFirstLayerTimeout(json["first_layer_timeout"].as<int>(), printer);
+    if (json.containsKey("pause_on_runout"))
+        setPauseOnRunout(json["pause_on_runout"].as<bool>(), printer);
+    if (json.containsKey("start_print_timeout"))
+        setStartPrintTimeout(json["start_print_timeout"].as<int>(), printer);
+    if (json.containsKey("enabled"))
+        setEnabled(json["enabled"].as<bool>(), printer);
+    if (json.containsKey("adaptive_timeout"))
+        setAdaptiveTimeout(json["adaptive_timeout"].as<bool>(), printer);
+    if (json.containsKey("adaptive_quantile"))
+        setAdaptiveQuantile(json["adaptive_quantile"].as<float>(), printer);
+    if (json.containsKey("adaptive_margin"))
+        setAdaptiveMargin(json["adaptive_margin"].as<int>(), printer);
+    if (json.containsKey("mm_per_pulse"))
+        setMmPerPulse(json["mm_per_pulse"].as<float>(), printer);
+}
+
+void SettingsManager::save(bool skipWifiCheck)
+{
+    if (!isLoaded)
+        load();
+
+    {
+        std::lock_guard<std::mutex> guard(saveLock);
+        if (!savePending)
+        {
+            savePending     = true;
+            saveRequestedAt = millis();
+        }
+    }
 
-    file.close();
-    logger.log("Settings saved successfully");
     if (!skipWifiCheck && wifiChanged)
     {
         logger.log("WiFi changed, requesting reconnection");
         requestWifiReconnect = true;
         wifiChanged          = false;
     }
+}
+
+bool SettingsManager::flush()
+{
+    std::lock_guard<std::mutex> guard(saveLock);
+    if (!savePending)
+    {
+        return true;
+    }
+    savePending = false;
+    return writeBlob();
+}
+
+void SettingsManager::loop()
+{
+    bool due;
+    {
+        std::lock_guard<std::mutex> guard(saveLock);
+        due = savePending && millis() - saveRequestedAt >= SETTINGS_SAVE_DELAY_MS;
+    }
+    if (due)
+    {
+        flush();
+    }
+}
+
+bool SettingsManager::writeBlob()
+{
+    settings_blob blob;
+    pack(blob);
+
+    uint32_t hash = hashBlob(blob);
+    if (hash == savedHash)
+    {
+        storage.skipped++;
+        return true;
+    }
+
+    // NVS appends entries to a page and erases it once the page has filled up
+    storage.writes++;
+    if ((storage.bytes + sizeof(blob)) / SETTINGS_FLASH_BLOCK_SIZE !=
+        storage.bytes / SETTINGS_FLASH_BLOCK_SIZE)
+    {
+        storage.erases++;
+    }
+    storage.bytes += sizeof(blob);
+    blob.storage = storage;
+
+    // NVS keeps the previous value until the new one is fully written, so a power cut leaves
+    // either the old or the new settings
+    Preferences prefs;
+    if (!prefs.begin(SETTINGS_NVS_NAMESPACE, false))
+    {
+        logger.log("Failed to open settings storage for writing");
+        return false;
+    }
+    size_t written = prefs.putBytes(SETTINGS_NVS_KEY, &blob, sizeof(blob));
+    prefs.end();
+
+    if (written != sizeof(blob))
+    {
+        logger.log("Failed to write settings");
+        return false;
+    }
+
+    savedHash   = hash;
+    storedInNvs = true;
+    logger.log("Settings saved successfully");
     return true;
 }
 
@@ -106,12 +401,12 @@ const user_settings &SettingsManager::getSettings()
 
 String SettingsManager::getSSID()
 {
-    return getSettings().ssid;
+    return readString(getSettings().ssid);
 }
 
 String SettingsManager::getPassword()
 {
-    return getSettings().passwd;
+    return readString(getSettings().passwd);
 }
 
 bool SettingsManager::isAPMode()
@@ -119,142 +414,292 @@ bool SettingsManager::isAPMode()
     return getSettings().ap_mode;
 }
 
-String SettingsManager::getElegooIP()
+bool SettingsManager::getHasConnected()
+{
+    return getSettings().has_connected;
+}
+
+bool SettingsManager::getPersistLogs()
 {
-    return getSettings().elegooip;
+    return getSettings().persist_logs;
 }
 
-int SettingsManager::getTimeout()
+const printer_settings &SettingsManager::getPrinterSettings(int printer)
 {
-    return getSettings().timeout;
+    const user_settings &current = getSettings();
+    return current.printers[printer >= 0 && printer < PRINTER_COUNT ? printer : 0];
 }
 
-int SettingsManager::getFirstLayerTimeout()
+String SettingsManager::getElegooIP(int printer)
 {
-    return getSettings().first_layer_timeout;
+    return readString(getPrinterSettings(printer).elegooip);
 }
 
-bool SettingsManager::getPauseOnRunout()
+String SettingsManager::getMainboardID(int printer)
 {
-    return getSettings().pause_on_runout;
+    return readString(getPrinterSettings(printer).mainboard_id);
 }
 
-int SettingsManager::getStartPrintTimeout()
+int SettingsManager::getTimeout(int printer)
 {
-    return getSettings().start_print_timeout;
+    return getPrinterSettings(printer).timeout;
 }
 
-bool SettingsManager::getEnabled()
+int SettingsManager::getFirstLayerTimeout(int printer)
 {
-    return getSettings().enabled;
+    return getPrinterSettings(printer).first_layer_timeout;
 }
 
-bool SettingsManager::getHasConnected()
+bool SettingsManager::getPauseOnRunout(int printer)
 {
-    return getSettings().has_connected;
+    return getPrinterSettings(printer).pause_on_runout;
+}
+
+int SettingsManager::getStartPrintTimeout(int printer)
+{
+    return getPrinterSettings(printer).start_print_timeout;
+}
+
+bool SettingsManager::getEnabled(int printer)
+{
+    return getPrinterSettings(printer).enabled;
+}
+
+bool SettingsManager::getAdaptiveTimeout(int printer)
+{
+    return getPrinterSettings(printer).adaptive_timeout;
+}
+
+float SettingsManager::getAdaptiveQuantile(int printer)
+{
+    return getPrinterSettings(printer).adaptive_quantile;
+}
+
+int SettingsManager::getAdaptiveMargin(int printer)
+{
+    return getPrinterSettings(printer).adaptive_margin;
+}
+
+float SettingsManager::getMmPerPulse(int printer)
+{
+    return getPrinterSettings(printer).mm_per_pulse;
+}
+
+template <typename T>
+bool SettingsManager::change(T &field, const T &value)
+{
+    if (field == value)
+    {
+        return false;
+    }
+    field = value;
+    generation++;
+    return true;
+}
+
+bool SettingsManager::changeString(String &field, const String &value)
+{
+    std::lock_guard<std::mutex> guard(stringLock);
+    return change(field, value);
+}
+
+String SettingsManager::readString(const String &field)
+{
+    std::lock_guard<std::mutex> guard(stringLock);
+    return field;
 }
 
 void SettingsManager::setSSID(const String &ssid)
 {
     if (!isLoaded)
         load();
-    if (settings.ssid != ssid)
-    {
-        settings.ssid = ssid;
-        wifiChanged   = true;
-    }
+    if (changeString(settings.ssid, ssid))
+        wifiChanged = true;
 }
 
 void SettingsManager::setPassword(const String &password)
 {
     if (!isLoaded)
         load();
-    if (settings.passwd != password)
-    {
-        settings.passwd = password;
-        wifiChanged     = true;
-    }
+    if (changeString(settings.passwd, password))
+        wifiChanged = true;
 }
 
 void SettingsManager::setAPMode(bool apMode)
 {
     if (!isLoaded)
         load();
-    if (settings.ap_mode != apMode)
-    {
-        settings.ap_mode = apMode;
-        wifiChanged      = true;
-    }
+    if (change(settings.ap_mode, apMode))
+        wifiChanged = true;
 }
 
-void SettingsManager::setElegooIP(const String &ip)
+void SettingsManager::setHasConnected(bool hasConnected)
 {
     if (!isLoaded)
         load();
-    settings.elegooip = ip;
+    change(settings.has_connected, hasConnected);
 }
 
-void SettingsManager::setTimeout(int timeout)
+void SettingsManager::setPersistLogs(bool persistLogs)
 {
     if (!isLoaded)
         load();
-    settings.timeout = timeout;
+    change(settings.persist_logs, persistLogs);
 }
 
-void SettingsManager::setFirstLayerTimeout(int timeout)
+printer_settings *SettingsManager::printerSettings(int printer)
 {
     if (!isLoaded)
         load();
-    settings.first_layer_timeout = timeout;
+    if (printer < 0 || printer >= PRINTER_COUNT)
+    {
+        return nullptr;
+    }
+    return &settings.printers[printer];
 }
 
-void SettingsManager::setPauseOnRunout(bool pauseOnRunout)
+void SettingsManager::setElegooIP(const String &ip, int printer)
 {
-    if (!isLoaded)
-        load();
-    settings.pause_on_runout = pauseOnRunout;
+    printer_settings *target = printerSettings(printer);
+    if (!target)
+        return;
+    changeString(target->elegooip, ip);
 }
 
-void SettingsManager::setStartPrintTimeout(int timeoutMs)
+void SettingsManager::setMainboardID(const String &mainboardId, int printer)
 {
-    if (!isLoaded)
-        load();
-    settings.start_print_timeout = timeoutMs;
+    printer_settings *target = printerSettings(printer);
+    if (!target)
+        return;
+    changeString(target->mainboard_id, mainboardId);
 }
 
-void SettingsManager::setEnabled(bool enabled)
+void SettingsManager::setTimeout(int timeout, int printer)
 {
-    if (!isLoaded)
-        load();
-    settings.enabled = enabled;
+    printer_settings *target = printerSettings(printer);
+    if (!target)
+        return;
+    change(target->timeout, timeout);
 }
 
-void SettingsManager::setHasConnected(bool hasConnected)
+void SettingsManager::setFirstLayerTimeout(int timeout, int printer)
 {
-    if (!isLoaded)
-        load();
-    settings.has_connected = hasConnected;
+    printer_settings *target = printerSettings(printer);
+    if (!target)
+        return;
+    change(target->first_layer_timeout, timeout);
 }
 
-String SettingsManager::toJson(bool includePassword)
+void SettingsManager::setPauseOnRunout(bool pauseOnRunout, int printer)
 {
-    String                   output;
-    StaticJsonDocument<1024> doc;
+    printer_settings *target = printerSettings(printer);
+    if (!target)
+        return;
+    change(target->pause_on_runout, pauseOnRunout);
+}
+
+void SettingsManager::setStartPrintTimeout(int timeoutMs, int printer)
+{
+    printer_settings *target = printerSettings(printer);
+    if (!target)
+        return;
+    change(target->start_print_timeout, timeoutMs);
+}
+
+void SettingsManager::setEnabled(bool enabled, int printer)
+{
+    printer_settings *target = printerSettings(printer);
+    if (!target)
+        return;
+    change(target->enabled, enabled);
+}
 
-    doc["ap_mode"]             = settings.ap_mode;
-    doc["ssid"]                = settings.ssid;
-    doc["elegooip"]            = settings.elegooip;
-    doc["timeout"]             = settings.timeout;
-    doc["first_layer_timeout"] = settings.first_layer_timeout;
-    doc["pause_on_runout"]     = settings.pause_on_runout;
-    doc["start_print_timeout"] = settings.start_print_timeout;
-    doc["enabled"]             = settings.enabled;
-    doc["has_connected"]       = settings.has_connected;
+void SettingsManager::setAdaptiveTimeout(bool adaptiveTimeout, int printer)
+{
+    printer_settings *target = printerSettings(printer);
+    if (!target)
+        return;
+    change(target->adaptive_timeout, adaptiveTimeout);
+}
+
+void SettingsManager::setAdaptiveQuantile(float quantile, int printer)
+{
+    printer_settings *target = printerSettings(printer);
+    if (!target)
+        return;
+    // Anything under the median is no use for a timeout, and 100 has no estimate
+    if (quantile < 50.0f)
+        quantile = 50.0f;
+    if (quantile > 99.9f)
+        quantile = 99.9f;
+    change(target->adaptive_quantile, quantile);
+}
+
+void SettingsManager::setAdaptiveMargin(int marginMs, int printer)
+{
+    printer_settings *target = printerSettings(printer);
+    if (!target)
+        return;
+    change(target->adaptive_margin, marginMs);
+}
+
+void SettingsManager::setMmPerPulse(float mmPerPulse, int printer)
+{
+    printer_settings *target = printerSettings(printer);
+    // A sensor always moves some filament per pulse, keep the feed rate finite
+    if (!target || mmPerPulse <= 0.0f)
+        return;
+    change(target->mm_per_pulse, mmPerPulse);
+}
+
+void SettingsManager::fillJson(JsonDocument &doc, bool includePassword)
+{
+    std::lock_guard<std::mutex> guard(stringLock);
+    doc["ap_mode"]       = settings.ap_mode;
+    doc["ssid"]          = settings.ssid;
+    doc["has_connected"] = settings.has_connected;
+    doc["persist_logs"]  = settings.persist_logs;
+
+    JsonArray printers = doc.createNestedArray("printers");
+    for (int i = 0; i < PRINTER_COUNT; i++)
+    {
+        const printer_settings &printer = settings.printers[i];
+        JsonObject              out     = printers.createNestedObject();
+        out["elegooip"]            = printer.elegooip;
+        out["mainboard_id"]        = printer.mainboard_id;
+        out["timeout"]             = printer.timeout;
+        out["first_layer_timeout"] = printer.first_layer_timeout;
+        out["pause_on_runout"]     = printer.pause_on_runout;
+        out["start_print_timeout"] = printer.start_print_timeout;
+        out["enabled"]             = printer.enabled;
+        out["adaptive_timeout"]    = printer.adaptive_timeout;
+        out["adaptive_quantile"]   = printer.adaptive_quantile;
+        out["adaptive_margin"]     = printer.adaptive_margin;
+        out["mm_per_pulse"]        = printer.mm_per_pulse;
+    }
 
     if (includePassword)
     {
         doc["passwd"] = settings.passwd;
     }
+}
+
+void SettingsManager::fillStorageJson(JsonDocument &doc)
+{
+    JsonObject stats = doc.createNestedObject("storage");
+    stats["writes"]  = storage.writes;
+    stats["skipped"] = storage.skipped;
+    stats["bytes"]   = storage.bytes;
+    stats["erases"]  = storage.erases;
+}
+
+String SettingsManager::toJson(bool includePassword)
+{
+    String              output;
+    DynamicJsonDocument doc(SETTINGS_JSON_SIZE);
+
+    fillJson(doc, includePassword);
+    fillStorageJson(doc);
 
     serializeJson(doc, output);
     return output;
@@ -1,21 +1,69 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 
+#include <atomic>
+#include <mutex>
+
+#include "PrinterConfig.h"
+
 #ifndef SETTINGS_DATA_H
 #define SETTINGS_DATA_H
 
-struct user_settings
+// Settings are stored as a binary blob in NVS, see settings_blob in SettingsManager.cpp
+#define SETTINGS_NVS_NAMESPACE "cc_sfs"
+#define SETTINGS_NVS_KEY "settings"
+#define SETTINGS_BLOB_VERSION 1
+
+// Where older firmware kept the settings, imported once by migrateFromFile()
+#define SETTINGS_FILE "/user_settings.json"
+#define SETTINGS_TEMP_FILE "/user_settings.json.tmp"
+
+// Saves requested within this window of the first one are written together
+#define SETTINGS_SAVE_DELAY_MS 1000
+
+// Flash erase size, used to estimate erase cycles from the bytes written
+#define SETTINGS_FLASH_BLOCK_SIZE 4096
+
+// Capacity needed by SettingsManager::toJson()
+#define SETTINGS_JSON_SIZE \
+    (JSON_OBJECT_SIZE(8) + JSON_ARRAY_SIZE(PRINTER_COUNT) + PRINTER_COUNT * JSON_OBJECT_SIZE(11) + \
+     JSON_OBJECT_SIZE(4) + 512)
+
+struct settings_blob;
+
+// Settings of one monitored printer
+struct printer_settings
 {
-    String ssid;
-    String passwd;
-    bool   ap_mode;
     String elegooip;
+    String mainboard_id;  // printer last seen at elegooip, to find it again when that changes
     int    timeout;
     int    first_layer_timeout;
     bool   pause_on_runout;
     int    start_print_timeout;
     bool   enabled;
-    bool   has_connected;
+    bool   adaptive_timeout;   // learn the movement timeout from the sensor, see AdaptiveTimeout
+    float  adaptive_quantile;  // percentile of the edge intervals the timeout is based on
+    int    adaptive_margin;    // milliseconds added to that percentile
+    float  mm_per_pulse;       // filament moved per movement sensor state change
+};
+
+struct user_settings
+{
+    String           ssid;
+    String           passwd;
+    bool             ap_mode;
+    bool             has_connected;
+    bool             persist_logs;
+    printer_settings printers[MAX_PRINTERS];
+};
+
+// Lifetime flash usage of the settings, stored alongside them
+struct settings_storage_stats
+{
+    uint32_t writes;   // times the settings were written
+    uint32_t skipped;  // saves dropped because nothing had changed
+    uint32_t bytes;    // bytes written
+    uint32_t erases;   // estimated block erases
 };
 
 class SettingsManager
@@ -25,8 +73,43 @@ class SettingsManager
     bool          isLoaded;
     bool          wifiChanged;
 
+    // Bumped whenever a setting changes value, so consumers can cache values between changes
+    std::atomic<uint32_t> generation;
+
+    // Guards the String settings, web handlers set them on the async TCP task while loop() reads
+    // them. Take it through the String getters; the fields of the getSettings() and
+    // getPrinterSettings() references other than Strings can be read without it.
+    std::mutex stringLock;
+
+    // Pending save, written by loop() once SETTINGS_SAVE_DELAY_MS has passed or by flush().
+    // saveLock guards it and the write, flush() is also called from web handlers.
+    std::mutex             saveLock;
+    bool                   savePending;
+    unsigned long          saveRequestedAt;
+    uint32_t               savedHash;    // hash of the settings last read from or written to NVS
+    bool                   storedInNvs;  // false until a valid blob has been read or written
+    settings_storage_stats storage;
+
     SettingsManager();
 
+    void pack(settings_blob &blob);
+    void unpack(settings_blob &blob);
+    bool writeBlob();
+    bool readFile(const char *path, JsonDocument &doc);
+    void fillJson(JsonDocument &doc, bool includePassword);
+    void fillStorageJson(JsonDocument &doc);
+    void applyPrinterJson(JsonObjectConst json, int printer);
+
+    // Stores value and bumps the generation, only when it differs from what is stored.
+    // changeString() and readString() do their part under stringLock.
+    template <typename T>
+    bool   change(T &field, const T &value);
+    bool   changeString(String &field, const String &value);
+    String readString(const String &field);
+
+    // Settings of printer to change, null when there is no such printer
+    printer_settings *printerSettings(int printer);
+
     SettingsManager(const SettingsManager &)            = delete;
     SettingsManager &operator=(const SettingsManager &) = delete;
 
@@ -36,34 +119,80 @@ class SettingsManager
     // Flag to request WiFi reconnection with new credentials
     bool requestWifiReconnect;
 
+    // Reads the settings from NVS, falling back to defaults. Does not touch the filesystem.
     bool load();
-    bool save(bool skipWifiCheck = false);
+    // One-time import of SETTINGS_FILE from older firmware when NVS holds no settings yet.
+    // Needs the filesystem mounted; the file is removed once the settings are in NVS.
+    bool migrateFromFile();
+    // Schedules a write of the settings; writes arriving within SETTINGS_SAVE_DELAY_MS are
+    // coalesced and unchanged settings are not written at all. Call flush() to learn whether the
+    // write succeeded.
+    void save(bool skipWifiCheck = false);
+    // Writes a pending save now and returns whether the settings are stored, call before
+    // restarting or to report the result of a save
+    bool flush();
+    // Writes a pending save once it is due, called from the main loop
+    void loop();
+
+    const settings_storage_stats &getStorageStats() const
+    {
+        return storage;
+    }
 
     //  (loads if not already loaded)
     const user_settings &getSettings();
 
+    // Changes whenever the settings are loaded or a setting changes value. Hot paths should
+    // compare this against the generation they last read at and only call the getters when it
+    // differs.
+    uint32_t getGeneration() const
+    {
+        return generation.load();
+    }
+
     String getSSID();
     String getPassword();
     bool   isAPMode();
-    String getElegooIP();
-    int    getTimeout();
-    int    getFirstLayerTimeout();
-    bool   getPauseOnRunout();
-    int    getStartPrintTimeout();
-    bool   getEnabled();
     bool   getHasConnected();
+    bool   getPersistLogs();
+
+    // Per printer, 0 to PRINTER_COUNT - 1. Getters fall back to printer 0 for an unknown printer,
+    // setters ignore it.
+    const printer_settings &getPrinterSettings(int printer);
+    String                  getElegooIP(int printer = 0);
+    String                  getMainboardID(int printer = 0);
+    int                     getTimeout(int printer = 0);
+    int                     getFirstLayerTimeout(int printer = 0);
+    bool                    getPauseOnRunout(int printer = 0);
+    int                     getStartPrintTimeout(int printer = 0);
+    bool                    getEnabled(int printer = 0);
+    bool                    getAdaptiveTimeout(int printer = 0);
+    float                   getAdaptiveQuantile(int printer = 0);
+    int                     getAdaptiveMargin(int printer = 0);
+    float                   getMmPerPulse(int printer = 0);
 
     void setSSID(const String &ssid);
     void setPassword(const String &password);
     void setAPMode(bool apMode);
-    void setElegooIP(const String &ip);
-    void setTimeout(int timeout);
-    void setFirstLayerTimeout(int timeout);
-    void setPauseOnRunout(bool pauseOnRunout);
-    void setStartPrintTimeout(int timeoutMs);
-    void setEnabled(bool enabled);
     void setHasConnected(bool hasConnected);
+    void setPersistLogs(bool persistLogs);
+
+    void setElegooIP(const String &ip, int printer = 0);
+    void setMainboardID(const String &mainboardId, int printer = 0);
+    void setTimeout(int timeout, int printer = 0);
+    void setFirstLayerTimeout(int timeout, int printer = 0);
+    void setPauseOnRunout(bool pauseOnRunout, int printer = 0);
+    void setStartPrintTimeout(int timeoutMs, int printer = 0);
+    void setEnabled(bool enabled, int printer = 0);
+    void setAdaptiveTimeout(bool adaptiveTimeout, int printer = 0);
+    void setAdaptiveQuantile(float quantile, int printer = 0);
+    void setAdaptiveMargin(int marginMs, int printer = 0);
+    void setMmPerPulse(float mmPerPulse, int printer = 0);
 
+    // Applies the settings present in a JSON export, leaving the others unchanged. Printer
+    // settings come in a "printers" array; top-level ones, as in exports from before there were
+    // several printers, go to printer 0.
+    void   applyJson(JsonObjectConst json);
     String toJson(bool includePassword = true);
 };
 
@@ -0,0 +1,70 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+// Lock-free single-producer/single-consumer ring buffer.
+//
+// push() may only be called from one context (e.g. an ISR) and pop() from one other context
+// (e.g. loop()). Head and tail are free-running 32-bit counters, so the buffer never needs a
+// spare slot and size() is simply head - tail. N must be a power of two.
+template <typename T, size_t N>
+class SpscRing
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+   private:
+    T                     buffer[N];
+    std::atomic<uint32_t> head;  // next slot to write, owned by the producer
+    std::atomic<uint32_t> tail;  // next slot to read, owned by the consumer
+
+   public:
+    SpscRing() : head(0), tail(0) {}
+
+    // Producer side. Returns false (and drops the item) if the ring is full.
+    inline bool push(const T &item)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= N)
+        {
+            return false;
+        }
+        buffer[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    inline bool pop(T &item)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = buffer[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Drops everything currently queued.
+    inline void clear()
+    {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    inline size_t size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity()
+    {
+        return N;
+    }
+};
+
+#endif  // SPSC_RING_H
@@ -0,0 +1,246 @@
+#ifndef STREAMING_STATS_H
+#define STREAMING_STATS_H
+
+#include <math.h>
+#include <stdint.h>
+
+// Streaming estimate of one quantile with the P-square algorithm (Jain & Chlamtac, 1985): five
+// markers whose heights follow the minimum, p/2, p, (1+p)/2 and maximum quantiles. Fixed size and
+// O(1) per sample; exact for the first five samples.
+class P2Quantile
+{
+   private:
+    float    p;
+    uint32_t count;
+    float    heights[5];
+    int32_t  positions[5];
+    float    desired[5];
+
+    float parabolic(int i, int d) const
+    {
+        float below = (float) (positions[i] - positions[i - 1]);
+        float above = (float) (positions[i + 1] - positions[i]);
+        return heights[i] +
+               d / (float) (positions[i + 1] - positions[i - 1]) *
+                   ((below + d) * (heights[i + 1] - heights[i]) / above +
+                    (above - d) * (heights[i] - heights[i - 1]) / below);
+    }
+
+    float linear(int i, int d) const
+    {
+        return heights[i] +
+               d * (heights[i + d] - heights[i]) / (float) (positions[i + d] - positions[i]);
+    }
+
+   public:
+    explicit P2Quantile(float quantile = 0.5f) : p(quantile)
+    {
+        reset();
+    }
+
+    // Changing the quantile starts over
+    void setQuantile(float quantile)
+    {
+        p = quantile;
+        reset();
+    }
+
+    uint32_t samples() const
+    {
+        return count;
+    }
+
+    void reset()
+    {
+        count = 0;
+        for (int i = 0; i < 5; i++)
+        {
+            heights[i]   = 0;
+            positions[i] = i;
+        }
+        desired[0] = 0;
+        desired[1] = 2 * p;
+        desired[2] = 4 * p;
+        desired[3] = 2 + 2 * p;
+        desired[4] = 4;
+    }
+
+    void add(float x)
+    {
+        if (count < 5)
+        {
+            // Keep the first samples sorted, they become the initial markers
+            int i = count++;
+            while (i > 0 && heights[i - 1] > x)
+            {
+                heights[i] = heights[i - 1];
+                i--;
+            }
+            heights[i] = x;
+            return;
+        }
+        count++;
+
+        // Cell the sample falls into, stretching the extremes if it is outside them
+        int cell;
+        if (x < heights[0])
+        {
+            heights[0] = x;
+            cell       = 0;
+        }
+        else if (x >= heights[4])
+        {
+            heights[4] = x;
+            cell       = 3;
+        }
+        else
+        {
+            cell = 0;
+            while (x >= heights[cell + 1])
+            {
+                cell++;
+            }
+        }
+
+        for (int i = cell + 1; i < 5; i++)
+        {
+            positions[i]++;
+        }
+        desired[1] += p / 2;
+        desired[2] += p;
+        desired[3] += (1 + p) / 2;
+        desired[4] += 1;
+
+        // Move the middle markers that drifted a whole position from where they should be
+        for (int i = 1; i < 4; i++)
+        {
+            float drift = desired[i] - positions[i];
+            if ((drift >= 1 && positions[i + 1] - positions[i] > 1) ||
+                (drift <= -1 && positions[i - 1] - positions[i] < -1))
+            {
+                int   d      = drift > 0 ? 1 : -1;
+                float height = parabolic(i, d);
+                if (heights[i - 1] < height && height < heights[i + 1])
+                {
+                    heights[i] = height;
+                }
+                else
+                {
+                    heights[i] = linear(i, d);
+                }
+                positions[i] += d;
+            }
+        }
+    }
+
+    float value() const
+    {
+        if (count == 0)
+        {
+            return 0;
+        }
+        if (count < 5)
+        {
+            // Nearest rank among the samples seen so far
+            return heights[(int) (p * (count - 1) + 0.5f)];
+        }
+        return heights[2];
+    }
+};
+
+// Count, min, max, mean, variance (Welford) and p50/p95 (P-square) of a stream of samples in
+// fixed memory, O(1) per sample. T is the sample type, min/max are kept in it exactly.
+template <typename T>
+class StreamingStats
+{
+   private:
+    uint32_t   samples;
+    T          minimum;
+    T          maximum;
+    float      runningMean;
+    float      squaredDeviations;  // sum of squared differences from the mean
+    P2Quantile median;
+    P2Quantile upper;
+
+   public:
+    StreamingStats() : median(0.5f), upper(0.95f)
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        samples           = 0;
+        minimum           = T();
+        maximum           = T();
+        runningMean       = 0;
+        squaredDeviations = 0;
+        median.reset();
+        upper.reset();
+    }
+
+    void add(T value)
+    {
+        if (samples == 0 || value < minimum)
+        {
+            minimum = value;
+        }
+        if (samples == 0 || value > maximum)
+        {
+            maximum = value;
+        }
+        samples++;
+
+        float x     = (float) value;
+        float delta = x - runningMean;
+        runningMean += delta / samples;
+        squaredDeviations += delta * (x - runningMean);
+
+        median.add(x);
+        upper.add(x);
+    }
+
+    // Everything below is 0 while there are no samples
+    uint32_t count() const
+    {
+        return samples;
+    }
+
+    T min() const
+    {
+        return minimum;
+    }
+
+    T max() const
+    {
+        return maximum;
+    }
+
+    float mean() const
+    {
+        return runningMean;
+    }
+
+    // Sample variance
+    float variance() const
+    {
+        return samples > 1 ? squaredDeviations / (samples - 1) : 0;
+    }
+
+    float stddev() const
+    {
+        return sqrtf(variance());
+    }
+
+    float p50() const
+    {
+        return median.value();
+    }
+
+    float p95() const
+    {
+        return upper.value();
+    }
+};
+
+#endif  // STREAMING_STATS_H
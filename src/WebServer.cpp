@@ -2,8 +2,12 @@
 
 #include <AsyncJson.h>
 
-#include "ElegooCC.h"
+#include <memory>
+
 #include "Logger.h"
+#include "LoopProfiler.h"
+#include "Metrics.h"
+#include "PrinterManager.h"
 
 #define SPIFFS LittleFS
 
@@ -11,7 +15,104 @@
 extern const char* firmwareVersion;
 extern const char* chipFamily;
 
-WebServer::WebServer(int port) : server(port) {}
+static status_snapshot_t captureStatus(int printer)
+{
+    status_snapshot_t       snapshot;
+    const printer_settings& settings = settingsManager.getPrinterSettings(printer);
+    snapshot.info                    = printerManager.get(printer).getCurrentInformation();
+    snapshot.timeout                 = settings.timeout;
+    snapshot.firstLayerTimeout       = settings.first_layer_timeout;
+    snapshot.enabled                 = settings.enabled;
+    return snapshot;
+}
+
+// The printer a request is about, ?printer=<index> and printer 0 without it. Answers the request
+// with a 404 and returns null when there is no such printer.
+static ElegooCC* requestedPrinter(AsyncWebServerRequest* request)
+{
+    int index = 0;
+    if (request->hasParam("printer"))
+    {
+        index = request->getParam("printer")->value().toInt();
+    }
+    ElegooCC* printer = printerManager.find(index);
+    if (!printer)
+    {
+        request->send(404, "text/plain", "No such printer");
+    }
+    return printer;
+}
+
+// Writes the status fields that differ from previous, or all of them when previous is null
+#define STATUS_FIELD(path, member)                                \
+    do                                                            \
+    {                                                             \
+        if (!previous || current.member != previous->member)      \
+        {                                                         \
+            path = current.member;                                \
+        }                                                         \
+    } while (0)
+
+// Status keys of each tick_stats_t field, per tick_phase_t
+static const char* const tickStatKeys[TICK_PHASE_COUNT][7] = {
+    {"tickSampleCount", "avgTimeBetweenTicks", "minTickTime", "maxTickTime", "stdDevTickTime",
+     "p50TickTime", "p95TickTime"},
+    {"startTickCount", "startAvgTickTime", "startMinTickTime", "startMaxTickTime",
+     "startStdDevTickTime", "startP50TickTime", "startP95TickTime"},
+    {"firstLayerTickCount", "firstLayerAvgTickTime", "firstLayerMinTickTime",
+     "firstLayerMaxTickTime", "firstLayerStdDevTickTime", "firstLayerP50TickTime",
+     "firstLayerP95TickTime"},
+    {"laterLayersTickCount", "laterLayersAvgTickTime", "laterLayersMinTickTime",
+     "laterLayersMaxTickTime", "laterLayersStdDevTickTime", "laterLayersP50TickTime",
+     "laterLayersP95TickTime"}};
+
+static void writeStatus(JsonDocument& jsonDoc, const status_snapshot_t& current,
+                        const status_snapshot_t* previous)
+{
+    STATUS_FIELD(jsonDoc["stopped"], info.filamentStopped);
+    STATUS_FIELD(jsonDoc["filamentRunout"], info.filamentRunout);
+
+    STATUS_FIELD(jsonDoc["elegoo"]["mainboardID"], info.mainboardID);
+    if (!previous || current.info.printStatus != previous->info.printStatus)
+    {
+        jsonDoc["elegoo"]["printStatus"] = (int) current.info.printStatus;
+    }
+    STATUS_FIELD(jsonDoc["elegoo"]["isPrinting"], info.isPrinting);
+    STATUS_FIELD(jsonDoc["elegoo"]["currentLayer"], info.currentLayer);
+    STATUS_FIELD(jsonDoc["elegoo"]["totalLayer"], info.totalLayer);
+    STATUS_FIELD(jsonDoc["elegoo"]["progress"], info.progress);
+    STATUS_FIELD(jsonDoc["elegoo"]["currentTicks"], info.currentTicks);
+    STATUS_FIELD(jsonDoc["elegoo"]["totalTicks"], info.totalTicks);
+    STATUS_FIELD(jsonDoc["elegoo"]["PrintSpeedPct"], info.PrintSpeedPct);
+    STATUS_FIELD(jsonDoc["elegoo"]["isWebsocketConnected"], info.isWebsocketConnected);
+    STATUS_FIELD(jsonDoc["elegoo"]["currentZ"], info.currentZ);
+    STATUS_FIELD(jsonDoc["elegoo"]["movementTimeout"], info.movementTimeout);
+    STATUS_FIELD(jsonDoc["elegoo"]["feedRate"], info.feedRate);
+    STATUS_FIELD(jsonDoc["elegoo"]["feedRateCollapsed"], info.feedRateCollapsed);
+    // Tick statistics per phase, under flat keys
+    for (int phase = 0; phase < TICK_PHASE_COUNT; phase++)
+    {
+        const char* const* keys = tickStatKeys[phase];
+        STATUS_FIELD(jsonDoc["elegoo"][keys[0]], info.tickStats[phase].count);
+        STATUS_FIELD(jsonDoc["elegoo"][keys[1]], info.tickStats[phase].avg);
+        STATUS_FIELD(jsonDoc["elegoo"][keys[2]], info.tickStats[phase].min);
+        STATUS_FIELD(jsonDoc["elegoo"][keys[3]], info.tickStats[phase].max);
+        STATUS_FIELD(jsonDoc["elegoo"][keys[4]], info.tickStats[phase].stddev);
+        STATUS_FIELD(jsonDoc["elegoo"][keys[5]], info.tickStats[phase].p50);
+        STATUS_FIELD(jsonDoc["elegoo"][keys[6]], info.tickStats[phase].p95);
+    }
+
+    // Current timeout settings
+    STATUS_FIELD(jsonDoc["settings"]["timeout"], timeout);
+    STATUS_FIELD(jsonDoc["settings"]["first_layer_timeout"], firstLayerTimeout);
+    STATUS_FIELD(jsonDoc["settings"]["enabled"], enabled);
+}
+
+WebServer::WebServer(int port) : server(port), statusEvents("/events"), lastStatusEvents()
+{
+    lastStatusEventCheck = 0;
+    statusEventId        = 0;
+}
 
 void WebServer::begin()
 {
@@ -25,39 +126,48 @@ void WebServer::begin()
                   request->send(200, "application/json", jsonResponse);
               });
 
+    // Settings as a JSON file for backup, restored by posting it to /update_settings
+    server.on("/export_settings", HTTP_GET,
+              [](AsyncWebServerRequest* request)
+              {
+                  AsyncWebServerResponse* response = request->beginResponse(
+                      200, "application/json", settingsManager.toJson(false));
+                  response->addHeader("Content-Disposition",
+                                      "attachment; filename=\"cc_sfs_settings.json\"");
+                  request->send(response);
+              });
+
     server.addHandler(new AsyncCallbackJsonWebHandler(
         "/update_settings",
         [this](AsyncWebServerRequest* request, JsonVariant& json)
         {
+            // Also accepts a file from /export_settings, keys that are missing stay unchanged
             JsonObject jsonObj = json.as<JsonObject>();
-            settingsManager.setElegooIP(jsonObj["elegooip"].as<String>());
-            settingsManager.setSSID(jsonObj["ssid"].as<String>());
-            settingsManager.setElegooIP(jsonObj["elegooip"].as<String>());
-            settingsManager.setSSID(jsonObj["ssid"].as<String>());
-            if (jsonObj.containsKey("passwd") && jsonObj["passwd"].as<String>().length() > 0)
-            {
-                settingsManager.setPassword(jsonObj["passwd"].as<String>());
-            }
-            settingsManager.setAPMode(jsonObj["ap_mode"].as<bool>());
-            settingsManager.setTimeout(jsonObj["timeout"].as<int>());
-            settingsManager.setFirstLayerTimeout(jsonObj["first_layer_timeout"].as<int>());
-            settingsManager.setPauseOnRunout(jsonObj["pause_on_runout"].as<bool>());
-            settingsManager.setEnabled(jsonObj["enabled"].as<bool>());
-            settingsManager.setStartPrintTimeout(jsonObj["start_print_timeout"].as<int>());
-            bool saved = settingsManager.save();
+            settingsManager.applyJson(jsonObj);
+            logger.setPersistent(settingsManager.getPersistLogs());
+            // Written now rather than debounced, so the response tells whether it was stored
+            settingsManager.save();
+            bool saved = settingsManager.flush();
 
             // Return the current settings to validate they were saved
-            DynamicJsonDocument responseDoc(512);
-            responseDoc["success"]                         = saved;
-            const user_settings& currentSettings           = settingsManager.getSettings();
-            responseDoc["settings"]["timeout"]             = currentSettings.timeout;
-            responseDoc["settings"]["first_layer_timeout"] = currentSettings.first_layer_timeout;
-            responseDoc["settings"]["pause_on_runout"]     = currentSettings.pause_on_runout;
-            responseDoc["settings"]["start_print_timeout"] = currentSettings.start_print_timeout;
-            responseDoc["settings"]["enabled"]             = currentSettings.enabled;
-            responseDoc["settings"]["elegooip"]            = currentSettings.elegooip;
-            responseDoc["settings"]["ssid"]                = currentSettings.ssid;
-            responseDoc["settings"]["ap_mode"]             = currentSettings.ap_mode;
+            DynamicJsonDocument responseDoc(512 + 256 * PRINTER_COUNT);
+            responseDoc["success"]                  = saved;
+            const user_settings& currentSettings    = settingsManager.getSettings();
+            responseDoc["settings"]["ssid"]         = settingsManager.getSSID();
+            responseDoc["settings"]["ap_mode"]      = currentSettings.ap_mode;
+            responseDoc["settings"]["persist_logs"] = currentSettings.persist_logs;
+            JsonArray printers = responseDoc["settings"].createNestedArray("printers");
+            for (int i = 0; i < PRINTER_COUNT; i++)
+            {
+                const printer_settings& printer = currentSettings.printers[i];
+                JsonObject              out     = printers.createNestedObject();
+                out["timeout"]                  = printer.timeout;
+                out["first_layer_timeout"]      = printer.first_layer_timeout;
+                out["pause_on_runout"]          = printer.pause_on_runout;
+                out["start_print_timeout"]      = printer.start_print_timeout;
+                out["enabled"]                  = printer.enabled;
+                out["elegooip"]                 = settingsManager.getElegooIP(i);
+            }
 
             String jsonResponse;
             serializeJson(responseDoc, jsonResponse);
@@ -68,67 +178,158 @@ void WebServer::begin()
     // Setup ElegantOTA
     ElegantOTA.begin(&server);
 
-    // Sensor status endpoint
+    // Sensor status endpoint, the web UI falls back to polling this when /events is unavailable
     server.on("/sensor_status", HTTP_GET,
-              [this](AsyncWebServerRequest* request)
+              [](AsyncWebServerRequest* request)
               {
-                  // Add elegoo status information using singleton
-                  printer_info_t elegooStatus = elegooCC.getCurrentInformation();
+                  ElegooCC* printer = requestedPrinter(request);
+                  if (!printer)
+                  {
+                      return;
+                  }
 
                   // Increase capacity to ensure all fields (including new statistics)
                   // are serialized without truncation
-                  DynamicJsonDocument jsonDoc(1024);
-                  jsonDoc["stopped"]        = elegooStatus.filamentStopped;
-                  jsonDoc["filamentRunout"] = elegooStatus.filamentRunout;
-
-                  jsonDoc["elegoo"]["mainboardID"]          = elegooStatus.mainboardID;
-                  jsonDoc["elegoo"]["printStatus"]          = (int) elegooStatus.printStatus;
-                  jsonDoc["elegoo"]["isPrinting"]           = elegooStatus.isPrinting;
-                  jsonDoc["elegoo"]["currentLayer"]         = elegooStatus.currentLayer;
-                  jsonDoc["elegoo"]["totalLayer"]           = elegooStatus.totalLayer;
-                  jsonDoc["elegoo"]["progress"]             = elegooStatus.progress;
-                  jsonDoc["elegoo"]["currentTicks"]         = elegooStatus.currentTicks;
-                  jsonDoc["elegoo"]["totalTicks"]           = elegooStatus.totalTicks;
-                  jsonDoc["elegoo"]["PrintSpeedPct"]        = elegooStatus.PrintSpeedPct;
-                  jsonDoc["elegoo"]["isWebsocketConnected"] = elegooStatus.isWebsocketConnected;
-                  jsonDoc["elegoo"]["currentZ"]             = elegooStatus.currentZ;
-                  // Overall tick statistics
-                  jsonDoc["elegoo"]["avgTimeBetweenTicks"]  = elegooStatus.avgTimeBetweenTicks;
-                  jsonDoc["elegoo"]["minTickTime"]          = elegooStatus.minTickTime;
-                  jsonDoc["elegoo"]["maxTickTime"]          = elegooStatus.maxTickTime;
-                  jsonDoc["elegoo"]["tickSampleCount"]      = elegooStatus.tickSampleCount;
-                  // Start phase statistics
-                  jsonDoc["elegoo"]["startAvgTickTime"]     = elegooStatus.startAvgTickTime;
-                  jsonDoc["elegoo"]["startMinTickTime"]     = elegooStatus.startMinTickTime;
-                  jsonDoc["elegoo"]["startMaxTickTime"]     = elegooStatus.startMaxTickTime;
-                  jsonDoc["elegoo"]["startTickCount"]       = elegooStatus.startTickCount;
-                  // First layer statistics
-                  jsonDoc["elegoo"]["firstLayerAvgTickTime"] = elegooStatus.firstLayerAvgTickTime;
-                  jsonDoc["elegoo"]["firstLayerMinTickTime"] = elegooStatus.firstLayerMinTickTime;
-                  jsonDoc["elegoo"]["firstLayerMaxTickTime"] = elegooStatus.firstLayerMaxTickTime;
-                  jsonDoc["elegoo"]["firstLayerTickCount"]   = elegooStatus.firstLayerTickCount;
-                  // Later layers statistics
-                  jsonDoc["elegoo"]["laterLayersAvgTickTime"] = elegooStatus.laterLayersAvgTickTime;
-                  jsonDoc["elegoo"]["laterLayersMinTickTime"] = elegooStatus.laterLayersMinTickTime;
-                  jsonDoc["elegoo"]["laterLayersMaxTickTime"] = elegooStatus.laterLayersMaxTickTime;
-                  jsonDoc["elegoo"]["laterLayersTickCount"]   = elegooStatus.laterLayersTickCount;
-
-                  // Add current timeout settings
-                  const user_settings& settings              = settingsManager.getSettings();
-                  jsonDoc["settings"]["timeout"]             = settings.timeout;
-                  jsonDoc["settings"]["first_layer_timeout"] = settings.first_layer_timeout;
-                  jsonDoc["settings"]["enabled"]             = settings.enabled;
+                  DynamicJsonDocument jsonDoc(STATUS_JSON_SIZE);
+                  writeStatus(jsonDoc, captureStatus(printer->getIndex()), nullptr);
+                  jsonDoc["printer"]      = printer->getIndex();
+                  jsonDoc["printerCount"] = PRINTER_COUNT;
+
+                  String jsonResponse;
+                  serializeJson(jsonDoc, jsonResponse);
+                  request->send(200, "application/json", jsonResponse);
+              });
+
+    // Prometheus scrape target, rendered without ArduinoJson a section at a time as the response
+    // goes out, so a scrape only holds one section in memory
+    server.on("/metrics", HTTP_GET,
+              [](AsyncWebServerRequest* request)
+              {
+                  std::shared_ptr<MetricsStreamState> state =
+                      std::make_shared<MetricsStreamState>();
+                  metrics.beginMetricsStream(*state);
+                  request->send(request->beginChunkedResponse(
+                      "text/plain; version=0.0.4",
+                      [state](uint8_t* buffer, size_t maxLen, size_t index)
+                      { return metrics.streamMetrics(*state, buffer, maxLen); }));
+              });
+
+    // Pause latency histograms, per stage, for the current print and since boot
+    server.on("/pause_latency", HTTP_GET,
+              [](AsyncWebServerRequest* request)
+              {
+                  ElegooCC* printer = requestedPrinter(request);
+                  if (!printer)
+                  {
+                      return;
+                  }
+
+                  DynamicJsonDocument jsonDoc(PAUSE_LATENCY_JSON_SIZE);
+                  printer->getPauseLatency().toJson(jsonDoc);
+
+                  String jsonResponse;
+                  serializeJson(jsonDoc, jsonResponse);
+                  request->send(200, "application/json", jsonResponse);
+              });
+
+    // Movement timeouts learned per phase and speed, see AdaptiveTimeout
+    server.on("/adaptive_timeout", HTTP_GET,
+              [](AsyncWebServerRequest* request)
+              {
+                  ElegooCC* printer = requestedPrinter(request);
+                  if (!printer)
+                  {
+                      return;
+                  }
+
+                  DynamicJsonDocument jsonDoc(ADAPTIVE_TIMEOUT_JSON_SIZE);
+                  printer->getAdaptiveTimeout().toJson(jsonDoc);
+
+                  String jsonResponse;
+                  serializeJson(jsonDoc, jsonResponse);
+                  request->send(200, "application/json", jsonResponse);
+              });
+
+    // Filament feed rate and what was fed per layer, see FeedRate
+    server.on("/feed_rate", HTTP_GET,
+              [](AsyncWebServerRequest* request)
+              {
+                  ElegooCC* printer = requestedPrinter(request);
+                  if (!printer)
+                  {
+                      return;
+                  }
+
+                  DynamicJsonDocument jsonDoc(FEED_RATE_JSON_SIZE);
+                  printer->getFeedRate().toJson(jsonDoc);
 
                   String jsonResponse;
                   serializeJson(jsonDoc, jsonResponse);
                   request->send(200, "application/json", jsonResponse);
               });
 
+    // Per-stage loop() timings. Profiling is off until POST /loop_profile?enable=1, enabling it
+    // or ?reset=1 starts a new capture.
+    server.on("/loop_profile", HTTP_GET,
+              [](AsyncWebServerRequest* request)
+              {
+                  DynamicJsonDocument jsonDoc(LOOP_PROFILE_JSON_SIZE);
+                  loopProfiler.toJson(jsonDoc);
+
+                  String jsonResponse;
+                  serializeJson(jsonDoc, jsonResponse);
+                  request->send(200, "application/json", jsonResponse);
+              });
+
+    server.on("/loop_profile", HTTP_POST,
+              [](AsyncWebServerRequest* request)
+              {
+                  if (request->hasParam("enable"))
+                  {
+                      loopProfiler.setEnabled(request->getParam("enable")->value().toInt() != 0);
+                  }
+                  if (request->hasParam("reset"))
+                  {
+                      loopProfiler.reset();
+                  }
+
+                  DynamicJsonDocument jsonDoc(64);
+                  jsonDoc["success"] = true;
+                  jsonDoc["enabled"] = loopProfiler.isEnabled();
+                  String jsonResponse;
+                  serializeJson(jsonDoc, jsonResponse);
+                  request->send(200, "application/json", jsonResponse);
+              });
+
+    // Status stream: a full "snapshot" event per printer on connect, then "update" events
+    // carrying only the fields that changed. Every event names its printer.
+    statusEvents.onConnect(
+        [this](AsyncEventSourceClient* client)
+        {
+            for (int printer = 0; printer < PRINTER_COUNT; printer++)
+            {
+                DynamicJsonDocument jsonDoc(STATUS_JSON_SIZE);
+                writeStatus(jsonDoc, captureStatus(printer), nullptr);
+                jsonDoc["printer"]      = printer;
+                jsonDoc["printerCount"] = PRINTER_COUNT;
+
+                String jsonResponse;
+                serializeJson(jsonDoc, jsonResponse);
+                client->send(jsonResponse.c_str(), "snapshot", ++statusEventId, 1000);
+            }
+        });
+    server.addHandler(&statusEvents);
+
     // Reset device-side tick statistics
     server.on("/reset_stats", HTTP_POST,
               [](AsyncWebServerRequest* request)
               {
-                  elegooCC.resetTickStats();
+                  ElegooCC* printer = requestedPrinter(request);
+                  if (!printer)
+                  {
+                      return;
+                  }
+                  printer->resetTickStats();
 
                   DynamicJsonDocument jsonDoc(64);
                   jsonDoc["success"] = true;
@@ -137,12 +338,40 @@ void WebServer::begin()
                   request->send(200, "application/json", jsonResponse);
               });
 
-    // Logs endpoint
+    // Logs endpoint, /logs?since=<seq> returns only records newer than seq. The JSON is written
+    // straight out of the log arena a chunk at a time. /logs?page=<n> returns persisted segment n
+    // (0 is the newest) as tab separated text.
     server.on("/logs", HTTP_GET,
               [](AsyncWebServerRequest* request)
               {
-                  String jsonResponse = logger.getLogsAsJson();
-                  request->send(200, "application/json", jsonResponse);
+                  if (request->hasParam("page"))
+                  {
+                      uint32_t generation;
+                      int      page = request->getParam("page")->value().toInt();
+                      if (!logger.findPersistedPage(page, generation))
+                      {
+                          request->send(404, "text/plain", "No such log page");
+                          return;
+                      }
+                      // Read a piece at a time by generation, so a segment rotated out while it
+                      // is being sent ends the response instead of serving the new one
+                      request->send(request->beginChunkedResponse(
+                          "text/plain", [generation](uint8_t* buffer, size_t maxLen, size_t index)
+                          { return logger.readPersistedPage(generation, index, buffer, maxLen); }));
+                      return;
+                  }
+
+                  uint32_t since = 0;
+                  if (request->hasParam("since"))
+                  {
+                      since = strtoul(request->getParam("since")->value().c_str(), nullptr, 10);
+                  }
+
+                  std::shared_ptr<LogStreamState> state = std::make_shared<LogStreamState>();
+                  logger.beginLogStream(*state, since);
+                  request->send(request->beginChunkedResponse(
+                      "application/json", [state](uint8_t* buffer, size_t maxLen, size_t index)
+                      { return logger.streamLogsJson(*state, buffer, maxLen); }));
               });
 
     // Version endpoint
@@ -166,7 +395,43 @@ void WebServer::begin()
     server.serveStatic("/", SPIFFS, "/").setDefaultFile("index.htm").setCacheControl("no-cache");
 }
 
+void WebServer::publishStatusChanges()
+{
+    unsigned long currentTime = millis();
+    if (currentTime - lastStatusEventCheck < STATUS_EVENT_INTERVAL_MS)
+    {
+        return;
+    }
+    lastStatusEventCheck = currentTime;
+
+    // Skip the comparison while nobody is listening. A stale baseline only means the first update
+    // after a subscriber connects repeats a few fields its snapshot already had.
+    if (statusEvents.count() == 0)
+    {
+        return;
+    }
+
+    for (int printer = 0; printer < PRINTER_COUNT; printer++)
+    {
+        status_snapshot_t current = captureStatus(printer);
+
+        DynamicJsonDocument jsonDoc(STATUS_JSON_SIZE);
+        writeStatus(jsonDoc, current, &lastStatusEvents[printer]);
+        lastStatusEvents[printer] = current;
+        if (jsonDoc.size() == 0)
+        {
+            continue;
+        }
+        jsonDoc["printer"] = printer;
+
+        String jsonResponse;
+        serializeJson(jsonDoc, jsonResponse);
+        statusEvents.send(jsonResponse.c_str(), "update", ++statusEventId);
+    }
+}
+
 void WebServer::loop()
 {
     ElegantOTA.loop();
+    publishStatusChanges();
 }
\ No newline at end of file
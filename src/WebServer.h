@@ -8,15 +8,40 @@
 #include <ElegantOTA.h>
 #include <LittleFS.h>
 
+#include "ElegooCC.h"
+#include "Metrics.h"
+#include "PrinterConfig.h"
 #include "SettingsManager.h"
 
 // Define SPIFFS as LittleFS
 #define SPIFFS LittleFS
 
+// How often changed status fields are pushed to /events subscribers
+#define STATUS_EVENT_INTERVAL_MS 50
+
+// Capacity of the status document, /status and /events snapshots carry every field
+#define STATUS_JSON_SIZE 1536
+
+// Everything the status page shows, compared field by field to build /events deltas
+typedef struct
+{
+    printer_info_t info;
+    int            timeout;
+    int            firstLayerTimeout;
+    bool           enabled;
+} status_snapshot_t;
+
 class WebServer
 {
    private:
-    AsyncWebServer server;
+    AsyncWebServer   server;
+    AsyncEventSource statusEvents;
+
+    status_snapshot_t lastStatusEvents[PRINTER_COUNT];
+    unsigned long     lastStatusEventCheck;
+    uint32_t          statusEventId;
+
+    void publishStatusChanges();
 
    public:
     WebServer(int port = 80);
@@ -0,0 +1,203 @@
+#include "WifiManager.h"
+
+#include <ESPmDNS.h>
+
+#include "Logger.h"
+#include "SettingsManager.h"
+
+WifiManager &WifiManager::getInstance()
+{
+    static WifiManager instance;
+    return instance;
+}
+
+WifiManager::WifiManager()
+{
+    state          = WIFI_STATE_IDLE;
+    attempt        = WIFI_ATTEMPT_STARTUP;
+    attemptStart   = 0;
+    attemptTimeout = 0;
+    lastCheck      = 0;
+    gotIP          = false;
+    lostConnection = false;
+}
+
+void WifiManager::begin()
+{
+    WiFi.onEvent([this](WiFiEvent_t event, WiFiEventInfo_t info) { this->onEvent(event); });
+
+    if (settingsManager.isAPMode())
+    {
+        startAP();
+        logger.log("Wifi setup in AP mode");
+    }
+    else
+    {
+        startStation(WIFI_ATTEMPT_STARTUP, WIFI_CONNECT_TIMEOUT);
+    }
+}
+
+void WifiManager::onEvent(WiFiEvent_t event)
+{
+    switch (event)
+    {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            gotIP = true;
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+        case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+            lostConnection = true;
+            break;
+        default:
+            break;
+    }
+}
+
+void WifiManager::startAP()
+{
+    logger.log("Starting AP mode");
+    WiFi.softAP("ElegooXBTTSFS20", "elegooccsfs20");
+    // Stop mDNS as it's not needed in AP mode
+    MDNS.end();
+    state = WIFI_STATE_AP;
+}
+
+void WifiManager::startStation(wifi_attempt_t kind, unsigned long timeout)
+{
+    const char *action = kind == WIFI_ATTEMPT_STARTUP ? "Connecting to" : "Reconnecting to";
+    logger.logf("%s WiFi: %s", action, settingsManager.getSSID().c_str());
+
+    // Events from the connection being replaced must not count against this attempt
+    gotIP          = false;
+    lostConnection = false;
+
+    WiFi.begin(settingsManager.getSSID().c_str(), settingsManager.getPassword().c_str());
+    state          = WIFI_STATE_CONNECTING;
+    attempt        = kind;
+    attemptStart   = millis();
+    attemptTimeout = timeout;
+}
+
+void WifiManager::applyCredentials()
+{
+    logger.log("Applying new WiFi credentials...");
+
+    // Clean up any existing connections first. The station radio stays on: turning it off
+    // finishes in the background, and WiFi.begin() right after would race the shutdown.
+    WiFi.softAPdisconnect(true);
+    WiFi.disconnect(false);
+
+    // Check if we're switching to AP mode
+    if (settingsManager.isAPMode())
+    {
+        logger.log("Switching to AP mode");
+        startAP();
+        return;
+    }
+
+    // We're switching to or staying in station mode
+    logger.log("Connecting to WiFi station mode with new credentials...");
+    startStation(WIFI_ATTEMPT_CREDENTIALS, WIFI_CONNECT_TIMEOUT);
+}
+
+void WifiManager::handleConnected()
+{
+    logger.log(attempt == WIFI_ATTEMPT_RECONNECT ? "WiFi reconnected successfully"
+                                                 : "WiFi Connected");
+    state = WIFI_STATE_CONNECTED;
+
+    // Mark that WiFi has successfully connected at least once
+    if (!settingsManager.getHasConnected())
+    {
+        settingsManager.setHasConnected(true);
+        settingsManager.save();
+        logger.log("First successful WiFi connection recorded");
+    }
+
+    // Start/restart mDNS for station mode
+    MDNS.end();
+    if (!MDNS.begin("ccxsfs20"))
+    {
+        logger.log("Error setting up MDNS responder!");
+    }
+}
+
+// If wifi fails, revert to AP mode and restart (only if never connected before)
+void WifiManager::handleAttemptFailed()
+{
+    state     = WIFI_STATE_DISCONNECTED;
+    lastCheck = millis();
+
+    if (attempt == WIFI_ATTEMPT_CREDENTIALS)
+    {
+        logger.log("Failed to connect with new WiFi credentials");
+        return;
+    }
+
+    // Only revert to AP mode if WiFi has never successfully connected
+    if (!settingsManager.getHasConnected())
+    {
+        settingsManager.setAPMode(true);
+        settingsManager.save();
+        if (settingsManager.flush())
+        {
+            logger.log("Failed to connect to wifi, reverted to AP mode (first connection attempt)");
+        }
+        else
+        {
+            logger.log("Failed to update settings");
+        }
+
+        Serial.flush();  // Give time for serial output
+        ESP.restart();
+    }
+    else
+    {
+        logger.log("WiFi connection failed, retrying in 30 seconds");
+    }
+}
+
+void WifiManager::loop()
+{
+    unsigned long currentTime = millis();
+
+    switch (state)
+    {
+        case WIFI_STATE_CONNECTING:
+            if (gotIP.exchange(false))
+            {
+                lostConnection = false;
+                handleConnected();
+            }
+            else if (currentTime - attemptStart >= attemptTimeout)
+            {
+                handleAttemptFailed();
+            }
+            break;
+
+        case WIFI_STATE_CONNECTED:
+            if (lostConnection.exchange(false))
+            {
+                logger.log("WiFi disconnected, attempting to reconnect...");
+                startStation(WIFI_ATTEMPT_RECONNECT, WIFI_RECONNECT_TIMEOUT);
+            }
+            break;
+
+        case WIFI_STATE_DISCONNECTED:
+            // The driver may reconnect on its own between our retries
+            if (gotIP.exchange(false))
+            {
+                attempt = WIFI_ATTEMPT_RECONNECT;
+                handleConnected();
+            }
+            else if (currentTime - lastCheck >= WIFI_CHECK_INTERVAL)
+            {
+                startStation(WIFI_ATTEMPT_RECONNECT, WIFI_RECONNECT_TIMEOUT);
+            }
+            break;
+
+        case WIFI_STATE_IDLE:
+        case WIFI_STATE_AP:
+            break;
+    }
+}
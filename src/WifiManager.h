@@ -0,0 +1,77 @@
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#include <atomic>
+
+#define WIFI_CHECK_INTERVAL 30000     // Retry a lost connection every 30 seconds
+#define WIFI_CONNECT_TIMEOUT 30000    // Wait 30 seconds for a connection with new settings
+#define WIFI_RECONNECT_TIMEOUT 10000  // Wait 10 seconds for a reconnection
+
+typedef enum
+{
+    WIFI_STATE_IDLE,          // begin() not called yet
+    WIFI_STATE_AP,            // running the setup access point
+    WIFI_STATE_CONNECTING,    // station connection in progress
+    WIFI_STATE_CONNECTED,     // station connected with an IP address
+    WIFI_STATE_DISCONNECTED,  // station connection lost or failed, retried periodically
+} wifi_state_t;
+
+typedef enum
+{
+    WIFI_ATTEMPT_STARTUP,      // first connection after boot
+    WIFI_ATTEMPT_CREDENTIALS,  // connection with newly entered credentials
+    WIFI_ATTEMPT_RECONNECT,    // periodic retry after the connection was lost
+} wifi_attempt_t;
+
+// Brings up and keeps up the network without blocking the main loop. WiFi events only set
+// flags; every state change happens in loop().
+class WifiManager
+{
+   private:
+    wifi_state_t   state;
+    wifi_attempt_t attempt;
+    unsigned long  attemptStart;
+    unsigned long  attemptTimeout;
+    unsigned long  lastCheck;
+
+    // Set from the WiFi event task
+    std::atomic<bool> gotIP;
+    std::atomic<bool> lostConnection;
+
+    WifiManager();
+
+    WifiManager(const WifiManager &)            = delete;
+    WifiManager &operator=(const WifiManager &) = delete;
+
+    void onEvent(WiFiEvent_t event);
+    void startAP();
+    void startStation(wifi_attempt_t kind, unsigned long timeout);
+    void handleConnected();
+    void handleAttemptFailed();
+
+   public:
+    static WifiManager &getInstance();
+
+    // Starts the access point or the station connection from the stored settings
+    void begin();
+    void loop();
+
+    // Drops the current connection and connects with the stored settings again
+    void applyCredentials();
+
+    wifi_state_t getState() const
+    {
+        return state;
+    }
+    bool isConnected() const
+    {
+        return state == WIFI_STATE_CONNECTED;
+    }
+};
+
+#define wifiManager WifiManager::getInstance()
+
+#endif  // WIFI_MANAGER_H
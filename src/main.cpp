@@ -1,12 +1,14 @@
 #include <Arduino.h>
-#include <ESPmDNS.h>
 #include <WiFi.h>
 
-#include "ElegooCC.h"
 #include "LittleFS.h"
 #include "Logger.h"
+#include "LoopProfiler.h"
+#include "Metrics.h"
+#include "PrinterManager.h"
 #include "SettingsManager.h"
 #include "WebServer.h"
+#include "WifiManager.h"
 #include "improv.h"
 #include "time.h"
 
@@ -29,20 +31,13 @@
 const char* firmwareVersion = GET_VERSION_STRING(FIRMWARE_VERSION_RAW, "dev");
 const char* chipFamily      = GET_VERSION_STRING(CHIP_FAMILY_RAW, "Unknown");
 
-#define WIFI_CHECK_INTERVAL 30000     // Check WiFi every 30 seconds
-#define WIFI_RECONNECT_TIMEOUT 10000  // Wait 10 seconds for reconnection
-#define NTP_SYNC_INTERVAL 3600000     // Re-sync with NTP every hour (3600000 ms)
+#define NTP_SYNC_INTERVAL 3600000  // Re-sync with NTP every hour (3600000 ms)
 
 // NTP server to request epoch time
 const char* ntpServer = "pool.ntp.org";
 
 WebServer webServer(80);
 
-// Variables to track WiFi connection monitoring
-unsigned long lastWifiCheck      = 0;
-unsigned long wifiReconnectStart = 0;
-bool          isReconnecting     = false;
-
 // These things get setup in the loop, not setup, so we need to track if they've happened
 bool isWifiSetup      = false;
 bool isElegooSetup    = false;
@@ -53,198 +48,15 @@ bool isNtpSetup       = false;
 uint8_t x_buffer[16];
 uint8_t x_position = 0;
 
+// Set while improv waits for the connection with the credentials it sent
+bool isImprovProvisioning = false;
+
 // Variables to track NTP synchronization
 unsigned long lastNTPSyncAttempt = 0;
 
-// If wifi fails, revert to AP mode and restart (only if never connected before);
-void failWifi()
-{
-    // Only revert to AP mode if WiFi has never successfully connected
-    if (!settingsManager.getHasConnected())
-    {
-        settingsManager.setAPMode(true);
-        if (settingsManager.save())
-        {
-            logger.log("Failed to connect to wifi, reverted to AP mode (first connection attempt)");
-        }
-        else
-        {
-            logger.log("Failed to update settings");
-        }
-
-        delay(1000);  // Give time for serial output
-        ESP.restart();
-    }
-    else
-    {
-        logger.log("WiFi connection failed, retrying in 30 seconds");
-        // Don't restart, just continue trying to reconnect in checkWifiConnection()
-    }
-}
-
-void startAPMode()
-{
-    logger.log("Starting AP mode");
-    WiFi.softAP("ElegooXBTTSFS20", "elegooccsfs20");
-    // Stop mDNS as it's not needed in AP mode
-    MDNS.end();
-}
-
-void handleSuccessfulWifiConnection()
-{
-    logger.log("WiFi Connected");
-
-    // Mark that WiFi has successfully connected at least once
-    if (!settingsManager.getHasConnected())
-    {
-        settingsManager.setHasConnected(true);
-        settingsManager.save();
-        logger.log("First successful WiFi connection recorded");
-    }
-
-    // Reset any reconnection state
-    isReconnecting = false;
-
-    // Start/restart mDNS for station mode
-    MDNS.end();
-    if (!MDNS.begin("ccxsfs20"))
-    {
-        logger.log("Error setting up MDNS responder!");
-    }
-}
-
-bool connectToWifiStation(bool isReconnect = false)
-{
-    const char* action = isReconnect ? "Reconnecting to" : "Connecting to";
-    logger.logf("%s WiFi: %s", action, settingsManager.getSSID().c_str());
-
-    WiFi.begin(settingsManager.getSSID().c_str(), settingsManager.getPassword().c_str());
-
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 30)
-    {
-        Serial.print('.');
-        delay(1000);
-        attempts++;
-    }
-
-    Serial.println();
-
-    if (WiFi.status() == WL_CONNECTED)
-    {
-        handleSuccessfulWifiConnection();
-        return true;
-    }
-    else
-    {
-        if (isReconnect)
-        {
-            logger.log("Failed to connect with new WiFi credentials");
-        }
-        else
-        {
-            failWifi();
-        }
-        return false;
-    }
-}
-
-void cleanupWifiConnections()
-{
-    // Stop AP mode if it was running
-    WiFi.softAPdisconnect(true);
-    // Disconnect from any existing station connection
-    WiFi.disconnect(true);
-    delay(1000);
-}
-
-bool wifiSetup()
-{
-    if (settingsManager.isAPMode())
-    {
-        startAPMode();
-        logger.log("Wifi setup in AP mode");
-        return false;
-    }
-    else
-    {
-        return connectToWifiStation(false);
-    }
-}
-
-bool reconnectWifiWithNewCredentials()
-{
-    logger.log("Applying new WiFi credentials...");
-
-    // Clean up any existing connections first
-    cleanupWifiConnections();
-
-    // Check if we're switching to AP mode
-    if (settingsManager.isAPMode())
-    {
-        logger.log("Switching to AP mode");
-        startAPMode();
-        return false;
-    }
-
-    // We're switching to or staying in station mode
-    logger.log("Connecting to WiFi station mode with new credentials...");
-    return connectToWifiStation(true);
-}
-
-void checkWifiConnection()
-{
-    logger.log("Checking WiFi connection");
-
-    // Skip check if already in AP mode
-    if (settingsManager.isAPMode())
-    {
-        logger.log("Skipping WiFi check in AP mode");
-        return;
-    }
-
-    // Check if WiFi is connected
-    if (WiFi.status() != WL_CONNECTED)
-    {
-        if (!isReconnecting)
-        {
-            logger.log("WiFi disconnected, attempting to reconnect...");
-            WiFi.begin(settingsManager.getSSID().c_str(), settingsManager.getPassword().c_str());
-            wifiReconnectStart = millis();
-            isReconnecting     = true;
-        }
-        else
-        {
-            // Check if reconnection timeout has elapsed
-            if (millis() - wifiReconnectStart >= WIFI_RECONNECT_TIMEOUT)
-            {
-                failWifi();
-            }
-        }
-    }
-    else
-    {
-        // WiFi is connected, reset reconnection state
-        if (isReconnecting)
-        {
-            logger.log("WiFi reconnected successfully");
-            isReconnecting = false;
-
-            // Mark that WiFi has successfully connected at least once
-            if (!settingsManager.getHasConnected())
-            {
-                settingsManager.setHasConnected(true);
-                settingsManager.save();
-            }
-        }
-    }
-}
-
 void setup()
 {
     // put your setup code here, to run once:
-    pinMode(FILAMENT_RUNOUT_PIN, INPUT_PULLUP);
-    pinMode(MOVEMENT_SENSOR_PIN, INPUT_PULLUP);
     Serial.begin(115200);
 
     // Initialize logging system
@@ -252,12 +64,24 @@ void setup()
     logger.logf("Firmware version: %s", firmwareVersion);
     logger.logf("Chip family: %s", chipFamily);
 
-    SPIFFS.begin();  // note: this must be done before wifi/server setup
-    logger.log("Filesystem initialized");
-
-    // Load settings early
+    // Load settings early, they live in NVS and do not wait on the filesystem
     settingsManager.load();
     logger.log("Settings Manager Loaded");
+
+    if (SPIFFS.begin())  // note: this must be done before wifi/server setup
+    {
+        logger.log("Filesystem initialized");
+        settingsManager.migrateFromFile();
+    }
+    else
+    {
+        logger.log("Filesystem mount failed, continuing without it");
+    }
+    logger.setPersistent(settingsManager.getPersistLogs());
+
+    // Sensors start once the settings are in, the task judges movement by them
+    printerManager.beginSensors();
+    printerManager.startSensorTask();
 }
 
 void syncTimeWithNTP(unsigned long currentTime)
@@ -349,18 +173,9 @@ bool onImprovCommandCallback(improv::ImprovCommand cmd)
             settingsManager.setAPMode(false);
             settingsManager.save(true);  // skip wifi check, we're about to try connecting
 
-            if (reconnectWifiWithNewCredentials())  // connectWifi(cmd.ssid, cmd.password)
-            {
-                improv::set_state(improv::STATE_PROVISIONED);
-                std::vector<uint8_t> data =
-                    improv::build_rpc_response(improv::WIFI_SETTINGS, getLocalUrl(), false);
-                improv::send_response(data);
-            }
-            else
-            {
-                improv::set_state(improv::STATE_STOPPED);
-                improv::set_error(improv::Error::ERROR_UNABLE_TO_CONNECT);
-            }
+            // The result is reported from checkImprovProvisioning() once the attempt finishes
+            wifiManager.applyCredentials();
+            isImprovProvisioning = true;
 
             break;
         }
@@ -417,22 +232,49 @@ bool handleImprovWifi()
     return false;
 }
 
+void checkImprovProvisioning()
+{
+    if (!isImprovProvisioning || wifiManager.getState() == WIFI_STATE_CONNECTING)
+    {
+        return;
+    }
+    isImprovProvisioning = false;
+
+    if (wifiManager.isConnected())
+    {
+        improv::set_state(improv::STATE_PROVISIONED);
+        std::vector<uint8_t> data =
+            improv::build_rpc_response(improv::WIFI_SETTINGS, getLocalUrl(), false);
+        improv::send_response(data);
+    }
+    else
+    {
+        improv::set_state(improv::STATE_STOPPED);
+        improv::set_error(improv::Error::ERROR_UNABLE_TO_CONNECT);
+    }
+}
+
 void loop()
 {
+    metrics.recordLoop();
+    loopProfiler.beginIteration();
+
     // handling immprovWifi should be the first thing we do
     if (handleImprovWifi())
     {
         // if we handled serial data, don't return so we don't bother with the rest of the setup
+        loopProfiler.lap(LOOP_STAGE_IMPROV);
+        loopProfiler.endIteration();
         return;
     }
-    unsigned long currentTime     = millis();
-    bool          isWifiConnected = !settingsManager.isAPMode() && WiFi.status() == WL_CONNECTED;
+    loopProfiler.lap(LOOP_STAGE_IMPROV);
+    unsigned long currentTime = millis();
 
     if (!isWifiSetup)
     {
-        isWifiSetup = wifiSetup();
+        wifiManager.begin();
         isWifiSetup = true;
-        logger.log("Wifi setup complete");
+        logger.log("Wifi setup started");
         return;  //
     }
     if (!isWebServerSetup)
@@ -448,18 +290,23 @@ void loop()
     if (settingsManager.requestWifiReconnect)
     {
         settingsManager.requestWifiReconnect = false;
-        reconnectWifiWithNewCredentials();
+        wifiManager.applyCredentials();
     }
 
-    if (isWifiConnected)
+    wifiManager.loop();
+    loopProfiler.lap(LOOP_STAGE_WIFI);
+    checkImprovProvisioning();
+    loopProfiler.lap(LOOP_STAGE_IMPROV);
+
+    if (wifiManager.isConnected())
     {
         if (!isElegooSetup)
         {
-            elegooCC.setup();
+            printerManager.setup();
             logger.log("Elegoo setup complete");
             isElegooSetup = true;
         }
-        elegooCC.loop();
+        printerManager.loop();
 
         if (!isNtpSetup)
         {
@@ -472,11 +319,18 @@ void loop()
         {
             syncTimeWithNTP(currentTime);
         }
+        loopProfiler.lap(LOOP_STAGE_NTP);
     }
-    else if (currentTime - lastWifiCheck >= WIFI_CHECK_INTERVAL)
+    else
     {
-        checkWifiConnection();
+        // The printers' loop() isn't running, so their pause gates would go stale
+        printerManager.disarm();
     }
 
     webServer.loop();
+    loopProfiler.lap(LOOP_STAGE_WEBSERVER);
+    settingsManager.loop();
+    logger.loop();
+    loopProfiler.lap(LOOP_STAGE_HOUSEKEEP);
+    loopProfiler.endIteration();
 }
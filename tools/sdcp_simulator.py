@@ -0,0 +1,553 @@
+#!/usr/bin/env python3
+"""
+Local SDCP printer simulator for developing and load-testing the firmware without a printer.
+
+Speaks the Centauri Carbon's SDCP websocket protocol on ws://<host>:3030/websocket:
+  - pushes "Status" messages (CurrentStatus, PrintInfo, CurrenCoord)
+  - acknowledges commands 0/1/128/129/130/131/132 with the matching RequestID
+  - answers the firmware's "ping" text frames with "pong"
+  - answers "M99999" discovery broadcasts on UDP port 3000 with its MainboardID and address
+
+Timelines:
+  synthetic   (default) heat, level, then print --layers layers at --layer-seconds each
+  --replay F  replay a recording (JSON lines: {"t": seconds, "msg": {...}})
+  --record-from IP  connect to a real printer and record its status stream to --out
+
+--speed scales simulated time (1x-1000x). --flood N replaces the timeline pacing with N status
+messages per second of wall time, each with fresh ticks/coords, to stress webSocketEvent and
+handleStatus. Pause commands are timestamped against the last status sent so pause latency under
+load can be read off the summary printed on exit.
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import asyncio
+import base64
+import hashlib
+import json
+import os
+import random
+import signal
+import struct
+import sys
+import time
+
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+# SDCP constants (see src/ElegooCC.h)
+PRINT_IDLE = 0
+PRINT_PAUSING = 5
+PRINT_PAUSED = 6
+PRINT_STOPPED = 8
+PRINT_COMPLETE = 9
+PRINT_PRINTING = 13
+PRINT_HEATING = 16
+PRINT_BED_LEVELING = 20
+
+MACHINE_IDLE = 0
+MACHINE_PRINTING = 1
+
+CMD_STATUS = 0
+CMD_ATTRIBUTES = 1
+CMD_START_PRINT = 128
+CMD_PAUSE_PRINT = 129
+CMD_STOP_PRINT = 130
+CMD_CONTINUE_PRINT = 131
+CMD_STOP_FEEDING_MATERIAL = 132
+
+
+# --- minimal RFC 6455 framing -------------------------------------------------------------------
+
+
+def encode_frame(payload, opcode=0x1, mask=False):
+    header = bytearray([0x80 | opcode])
+    length = len(payload)
+    mask_bit = 0x80 if mask else 0
+    if length < 126:
+        header.append(mask_bit | length)
+    elif length <= 0xFFFF:
+        header.append(mask_bit | 126)
+        header += struct.pack(">H", length)
+    else:
+        header.append(mask_bit | 127)
+        header += struct.pack(">Q", length)
+    if not mask:
+        return bytes(header) + payload
+    key = os.urandom(4)
+    masked = bytes(b ^ key[i & 3] for i, b in enumerate(payload))
+    return bytes(header) + key + masked
+
+
+async def read_frame(reader):
+    """Returns (opcode, payload) or None when the connection closed."""
+    try:
+        head = await reader.readexactly(2)
+        opcode = head[0] & 0x0F
+        masked = head[1] & 0x80
+        length = head[1] & 0x7F
+        if length == 126:
+            length = struct.unpack(">H", await reader.readexactly(2))[0]
+        elif length == 127:
+            length = struct.unpack(">Q", await reader.readexactly(8))[0]
+        key = await reader.readexactly(4) if masked else None
+        payload = await reader.readexactly(length)
+    except (asyncio.IncompleteReadError, ConnectionError):
+        return None
+    if key:
+        payload = bytes(b ^ key[i & 3] for i, b in enumerate(payload))
+    return opcode, payload
+
+
+# --- printer model --------------------------------------------------------------------------------
+
+
+class Printer:
+    def __init__(self, args):
+        self.args = args
+        self.mainboard_id = args.mainboard_id
+        self.print_status = PRINT_IDLE
+        self.machine_status = [MACHINE_IDLE]
+        self.layer = 0
+        self.total_layers = args.layers
+        self.ticks = 0
+        self.total_ticks = int(args.layers * args.layer_seconds)
+        self.speed_pct = 100
+        self.coord = [0.0, 0.0, 0.0]
+        self.filename = "simulated.gcode"
+        self.sim_time = 0.0
+        self.print_time = 0.0
+        self.print_started_at = None
+        self.pause_requested_at = None
+        self.recorded = None  # raw status dict overriding the model during replays
+
+    def status_message(self):
+        if self.recorded is not None:
+            msg = dict(self.recorded)
+            msg["MainboardID"] = self.mainboard_id
+            msg["TimeStamp"] = int(time.time())
+            return msg
+        progress = int(100 * self.ticks / self.total_ticks) if self.total_ticks else 0
+        return {
+            "Status": {
+                "CurrentStatus": list(self.machine_status),
+                "TimeLapseStatus": 0,
+                "PlatFormType": 0,
+                "TempOfHotbed": 60.0,
+                "TempOfNozzle": 220.0 if self.print_status != PRINT_IDLE else 25.0,
+                "TempOfBox": 30.0,
+                "CurrenCoord": "%.2f,%.2f,%.2f" % tuple(self.coord),
+                "CurrentFanSpeed": {"ModelFan": 100, "AuxiliaryFan": 0, "BoxFan": 0},
+                "ZOffset": 0.0,
+                "PrintInfo": {
+                    "Status": self.print_status,
+                    "CurrentLayer": self.layer,
+                    "TotalLayer": self.total_layers,
+                    "CurrentTicks": self.ticks,
+                    "TotalTicks": self.total_ticks,
+                    "Filename": self.filename,
+                    "ErrorNumber": 0,
+                    "TaskId": "00000000-0000-0000-0000-000000000000",
+                    "PrintSpeedPct": self.speed_pct,
+                    "Progress": progress,
+                },
+            },
+            "MainboardID": self.mainboard_id,
+            "TimeStamp": int(time.time()),
+            "Topic": "sdcp/status/%s" % self.mainboard_id,
+        }
+
+    def start_print(self):
+        self.print_status = PRINT_HEATING
+        self.machine_status = [MACHINE_PRINTING]
+        self.layer = 0
+        self.ticks = 0
+        self.print_time = 0.0
+        self.coord = [0.0, 0.0, 0.0]
+        self.print_started_at = self.sim_time
+        self.pause_requested_at = None
+
+    def advance(self, dt):
+        """Moves the synthetic timeline forward by dt simulated seconds."""
+        self.sim_time += dt
+        if self.recorded is not None or self.print_started_at is None:
+            return
+        elapsed = self.sim_time - self.print_started_at
+        if self.print_status == PRINT_HEATING and elapsed >= self.args.heat_seconds:
+            self.print_status = PRINT_BED_LEVELING
+        elif self.print_status == PRINT_BED_LEVELING and elapsed >= self.args.heat_seconds + 5:
+            self.print_status = PRINT_PRINTING
+            self.layer = 1
+        elif self.print_status == PRINT_PAUSING:
+            if self.sim_time - self.pause_requested_at >= self.args.pause_seconds:
+                self.print_status = PRINT_PAUSED
+        elif self.print_status == PRINT_PRINTING:
+            self.print_time += dt
+            self.ticks = min(self.total_ticks, int(self.print_time))
+            self.layer = min(self.total_layers, 1 + int(self.ticks / self.args.layer_seconds))
+            self.coord = [
+                round(random.uniform(20, 230), 2),
+                round(random.uniform(20, 230), 2),
+                round(self.layer * self.args.layer_height, 2),
+            ]
+            if self.ticks >= self.total_ticks:
+                self.print_status = PRINT_COMPLETE
+                self.machine_status = [MACHINE_IDLE]
+                self.print_started_at = None
+
+    def handle_command(self, cmd):
+        if cmd == CMD_START_PRINT:
+            self.start_print()
+        elif cmd == CMD_PAUSE_PRINT and self.print_status == PRINT_PRINTING:
+            self.print_status = PRINT_PAUSING
+            self.pause_requested_at = self.sim_time
+        elif cmd == CMD_CONTINUE_PRINT and self.print_status in (PRINT_PAUSING, PRINT_PAUSED):
+            self.print_status = PRINT_PRINTING
+        elif cmd == CMD_STOP_PRINT:
+            self.print_status = PRINT_STOPPED
+            self.machine_status = [MACHINE_IDLE]
+            self.print_started_at = None
+
+
+# --- discovery ------------------------------------------------------------------------------------
+
+
+class Discovery(asyncio.DatagramProtocol):
+    """Answers SDCP discovery broadcasts the way the printer does."""
+
+    def __init__(self, sim):
+        self.sim = sim
+        self.transport = None
+
+    def connection_made(self, transport):
+        self.transport = transport
+
+    def datagram_received(self, data, addr):
+        if data.strip() != b"M99999":
+            return
+        args = self.sim.args
+        reply = {
+            "Id": "simulator",
+            "Data": {
+                "Name": "Simulated Centauri Carbon",
+                "MachineName": "Centauri Carbon",
+                "BrandName": "ELEGOO",
+                "MainboardIP": args.advertise_ip,
+                "MainboardID": self.sim.printer.mainboard_id,
+                "ProtocolVersion": "V3.0.0",
+                "FirmwareVersion": "V1.1.25",
+            },
+        }
+        self.transport.sendto(json.dumps(reply, separators=(",", ":")).encode(), addr)
+        self.sim.log("discovery request from %s:%d" % addr)
+
+
+# --- server ---------------------------------------------------------------------------------------
+
+
+class Simulator:
+    def __init__(self, args):
+        self.args = args
+        self.printer = Printer(args)
+        self.clients = set()
+        self.sent = 0
+        self.sent_bytes = 0
+        self.commands = {}
+        self.pauses = []  # (wall time, seconds since previous status, status messages sent)
+        self.last_status_wall = None
+        self.started_wall = time.monotonic()
+
+    def log(self, text):
+        if not self.args.quiet:
+            print("[%8.3f] %s" % (time.monotonic() - self.started_wall, text), flush=True)
+
+    async def send_json(self, writer, msg):
+        data = json.dumps(msg, separators=(",", ":")).encode()
+        writer.write(encode_frame(data))
+        self.sent_bytes += len(data)
+
+    async def broadcast_status(self):
+        if not self.clients:
+            return
+        msg = self.printer.status_message()
+        for writer in list(self.clients):
+            try:
+                await self.send_json(writer, msg)
+                await writer.drain()
+            except ConnectionError:
+                self.clients.discard(writer)
+        self.sent += 1
+        self.last_status_wall = time.monotonic()
+
+    async def ack(self, writer, request):
+        data = request.get("Data", {})
+        cmd = data.get("Cmd")
+        response = {
+            "Id": request.get("Id", ""),
+            "Data": {
+                "Cmd": cmd,
+                "Data": {"Ack": 0},
+                "RequestID": data.get("RequestID", ""),
+                "MainboardID": self.printer.mainboard_id,
+                "TimeStamp": int(time.time()),
+            },
+            "Topic": "sdcp/response/%s" % self.printer.mainboard_id,
+        }
+        await self.send_json(writer, response)
+        await writer.drain()
+
+    async def handle_client(self, reader, writer):
+        peer = writer.get_extra_info("peername")
+        try:
+            request = await reader.readuntil(b"\r\n\r\n")
+        except (asyncio.IncompleteReadError, asyncio.LimitOverrunError, ConnectionError):
+            writer.close()
+            return
+        lines = request.decode(errors="replace").split("\r\n")
+        path = lines[0].split(" ")[1] if len(lines[0].split(" ")) > 1 else ""
+        headers = {}
+        for line in lines[1:]:
+            if ":" in line:
+                key, value = line.split(":", 1)
+                headers[key.strip().lower()] = value.strip()
+        if path != "/websocket" or "sec-websocket-key" not in headers:
+            writer.write(b"HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n")
+            await writer.drain()
+            writer.close()
+            return
+        accept = base64.b64encode(
+            hashlib.sha1((headers["sec-websocket-key"] + WS_GUID).encode()).digest()
+        ).decode()
+        writer.write(
+            (
+                "HTTP/1.1 101 Switching Protocols\r\n"
+                "Upgrade: websocket\r\n"
+                "Connection: Upgrade\r\n"
+                "Sec-WebSocket-Accept: %s\r\n\r\n" % accept
+            ).encode()
+        )
+        await writer.drain()
+        self.clients.add(writer)
+        self.log("client connected %s" % (peer,))
+
+        while True:
+            frame = await read_frame(reader)
+            if frame is None:
+                break
+            opcode, payload = frame
+            if opcode == 0x8:
+                break
+            if opcode == 0x9:
+                writer.write(encode_frame(payload, 0xA))
+                continue
+            if opcode != 0x1:
+                continue
+            text = payload.decode(errors="replace")
+            if text == "ping":
+                writer.write(encode_frame(b"pong"))
+                continue
+            try:
+                request = json.loads(text)
+                cmd = request["Data"]["Cmd"]
+            except (ValueError, KeyError, TypeError):
+                self.log("unparseable message: %s" % text[:120])
+                continue
+            await self.on_command(writer, request, cmd)
+
+        self.clients.discard(writer)
+        writer.close()
+        self.log("client disconnected %s" % (peer,))
+
+    async def on_command(self, writer, request, cmd):
+        now = time.monotonic()
+        self.commands[cmd] = self.commands.get(cmd, 0) + 1
+        if cmd != CMD_STATUS:
+            self.log("command %d request %s" % (cmd, request["Data"].get("RequestID", "")))
+        if cmd == CMD_PAUSE_PRINT:
+            since_status = now - self.last_status_wall if self.last_status_wall else 0
+            self.pauses.append((now - self.started_wall, since_status, self.sent))
+            self.log("pause received %.1f ms after the last status message" % (since_status * 1000))
+        self.printer.handle_command(cmd)
+        await self.ack(writer, request)
+        if cmd == CMD_STATUS:
+            await self.send_json(writer, self.printer.status_message())
+            await writer.drain()
+
+    async def run_timeline(self):
+        args = self.args
+        if args.replay:
+            await self.replay(args.replay)
+            return
+        if args.auto_start:
+            self.printer.start_print()
+        if args.flood:
+            await self.flood(args.flood)
+            return
+        tick = 0.05
+        next_push = 0.0
+        while True:
+            await asyncio.sleep(tick)
+            self.printer.advance(tick * args.speed)
+            if self.printer.sim_time >= next_push:
+                await self.broadcast_status()
+                next_push = self.printer.sim_time + args.push_interval
+
+    async def flood(self, rate):
+        interval = 1.0 / rate
+        next_send = time.monotonic()
+        while True:
+            if not self.clients:
+                await asyncio.sleep(0.05)
+                next_send = time.monotonic()
+                continue
+            self.printer.advance(interval * self.args.speed)
+            await self.broadcast_status()
+            next_send += interval
+            delay = next_send - time.monotonic()
+            if delay > 0:
+                await asyncio.sleep(delay)
+            elif self.sent % 64 == 0:
+                await asyncio.sleep(0)
+
+    async def replay(self, path):
+        with open(path) as f:
+            entries = [json.loads(line) for line in f if line.strip()]
+        while not self.clients:
+            await asyncio.sleep(0.05)
+        self.log("replaying %d messages from %s at %gx" % (len(entries), path, self.args.speed))
+        start = time.monotonic()
+        first = entries[0]["t"] if entries else 0
+        for entry in entries:
+            due = start + (entry["t"] - first) / self.args.speed
+            delay = due - time.monotonic()
+            if delay > 0:
+                await asyncio.sleep(delay)
+            self.printer.recorded = entry["msg"]
+            await self.broadcast_status()
+        self.log("replay finished")
+
+    def summary(self):
+        wall = time.monotonic() - self.started_wall
+        print("\n--- simulator summary ---")
+        print("status messages sent: %d (%.0f/s, %.1f KB/s)" % (
+            self.sent, self.sent / wall if wall else 0, self.sent_bytes / 1024 / wall if wall else 0))
+        for cmd in sorted(self.commands):
+            print("command %3d received: %d" % (cmd, self.commands[cmd]))
+        for at, since_status, sent in self.pauses:
+            print("pause at %.3f s: %.1f ms after last status, %d statuses sent before it" % (
+                at, since_status * 1000, sent))
+
+
+# --- recorder -------------------------------------------------------------------------------------
+
+
+async def record(args):
+    reader, writer = await asyncio.open_connection(args.record_from, 3030)
+    key = base64.b64encode(os.urandom(16)).decode()
+    writer.write(
+        (
+            "GET /websocket HTTP/1.1\r\nHost: %s:3030\r\nUpgrade: websocket\r\n"
+            "Connection: Upgrade\r\nSec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n"
+            % (args.record_from, key)
+        ).encode()
+    )
+    await reader.readuntil(b"\r\n\r\n")
+    start = time.monotonic()
+    count = 0
+    with open(args.out, "w") as out:
+        while True:
+            frame = await read_frame(reader)
+            if frame is None:
+                break
+            opcode, payload = frame
+            if opcode != 0x1:
+                continue
+            try:
+                msg = json.loads(payload)
+            except ValueError:
+                continue
+            if "Status" not in msg:
+                continue
+            out.write(json.dumps({"t": round(time.monotonic() - start, 3), "msg": msg}) + "\n")
+            out.flush()
+            count += 1
+            print("\rrecorded %d status messages" % count, end="", flush=True)
+
+
+# --- entry point ----------------------------------------------------------------------------------
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="0.0.0.0", help="listen address (default 0.0.0.0)")
+    parser.add_argument("--port", type=int, default=3030, help="listen port (default 3030)")
+    parser.add_argument("--discovery-port", type=int, default=3000,
+                        help="UDP port answering discovery broadcasts, 0 to disable (default 3000)")
+    parser.add_argument("--advertise-ip", help="MainboardIP in discovery replies (default --host, or 127.0.0.1)")
+    parser.add_argument("--mainboard-id", default="5153494d3030303030303031", help="MainboardID to report")
+    parser.add_argument("--speed", type=float, default=1.0, help="simulated seconds per wall second, 1-1000")
+    parser.add_argument("--push-interval", type=float, default=1.0,
+                        help="simulated seconds between pushed status messages (default 1)")
+    parser.add_argument("--layers", type=int, default=200, help="synthetic print layer count")
+    parser.add_argument("--layer-seconds", type=float, default=30.0, help="synthetic seconds per layer")
+    parser.add_argument("--layer-height", type=float, default=0.2, help="synthetic layer height in mm")
+    parser.add_argument("--heat-seconds", type=float, default=20.0, help="synthetic heating phase length")
+    parser.add_argument("--pause-seconds", type=float, default=2.0, help="time spent PAUSING before PAUSED")
+    parser.add_argument("--auto-start", action="store_true", help="start the synthetic print immediately")
+    parser.add_argument("--flood", type=int, metavar="N", help="send N status messages per wall second")
+    parser.add_argument("--replay", metavar="FILE", help="replay a recorded status stream")
+    parser.add_argument("--record-from", metavar="IP", help="record a real printer's status stream")
+    parser.add_argument("--out", default="recording.jsonl", help="recording output file")
+    parser.add_argument("--quiet", action="store_true", help="only print the summary")
+    args = parser.parse_args()
+    if not 1 <= args.speed <= 1000:
+        parser.error("--speed must be between 1 and 1000")
+    if args.advertise_ip is None:
+        args.advertise_ip = "127.0.0.1" if args.host == "0.0.0.0" else args.host
+    return args
+
+
+def main():
+    args = parse_args()
+    if args.record_from:
+        try:
+            asyncio.run(record(args))
+        except KeyboardInterrupt:
+            print()
+        return
+
+    sim = Simulator(args)
+
+    async def run():
+        server = await asyncio.start_server(sim.handle_client, args.host, args.port)
+        sim.log("SDCP simulator listening on ws://%s:%d/websocket" % (args.host, args.port))
+        loop = asyncio.get_running_loop()
+        discovery = None
+        if args.discovery_port:
+            # Broadcasts only reach a socket bound to the wildcard address
+            discovery, _ = await loop.create_datagram_endpoint(
+                lambda: Discovery(sim), local_addr=("0.0.0.0", args.discovery_port), reuse_port=True)
+        stop = loop.create_future()
+        for sig in (signal.SIGINT, signal.SIGTERM):
+            try:
+                loop.add_signal_handler(sig, stop.set_result, None)
+            except NotImplementedError:
+                pass
+        timeline = asyncio.ensure_future(sim.run_timeline())
+        async with server:
+            await asyncio.wait([stop, timeline], return_when=asyncio.FIRST_COMPLETED)
+            if args.replay and timeline.done():
+                await asyncio.wait([stop])
+        timeline.cancel()
+        if discovery:
+            discovery.close()
+
+    try:
+        asyncio.run(run())
+    except KeyboardInterrupt:
+        pass
+    sim.summary()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
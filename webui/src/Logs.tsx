@@ -1,7 +1,7 @@
 import { createSignal, onMount, onCleanup, createEffect } from 'solid-js'
 
 interface LogEntry {
-  uuid: string
+  seq: number
   timestamp: number
   message: string
 }
@@ -11,7 +11,11 @@ function Logs() {
   const [logs, setLogs] = createSignal<LogEntry[]>([])
   const [error, setError] = createSignal('')
   const [isAtBottom, setIsAtBottom] = createSignal(true)
+  const [olderLogs, setOlderLogs] = createSignal<LogEntry[]>([])
+  const [olderPage, setOlderPage] = createSignal(0)
+  const [noOlderLogs, setNoOlderLogs] = createSignal(false)
   let intervalId: number | null = null
+  let lastSeq = 0
   let logContainerRef: HTMLDivElement | undefined
 
   const formatTimestamp = (timestamp: number): string => {
@@ -25,30 +29,27 @@ function Logs() {
 
   const fetchLogs = async () => {
     try {
-      const response = await fetch('/logs')
+      const response = await fetch(`/logs?since=${lastSeq}`)
       if (!response.ok) {
         throw new Error(`Failed to fetch logs: ${response.status} ${response.statusText}`)
       }
       const logData = await response.json() as {
+        latest: number
         logs: LogEntry[]
       }
 
-      const existingUuids = new Set(logs().map(log => log.uuid))
-
-      const parsedLogs: LogEntry[] = []
-      for (const line of logData.logs) {
-        if (!existingUuids.has(line.uuid)) {
-          parsedLogs.push(line)
-          existingUuids.add(line.uuid)
-        }
+      if (logData.latest < lastSeq) {
+        // Sequence numbers restart from 1 when the device reboots, fetch everything again
+        lastSeq = 0
+        setLogs([])
+        await fetchLogs()
+        return
       }
 
-      if (parsedLogs.length > 0) {
-        // Add new logs to existing logs and sort by timestamp (newest first)
-        const allLogs = [...logs(), ...parsedLogs].sort((a, b) =>
-          new Date(a.timestamp).getTime() - new Date(b.timestamp).getTime()
-        )
-        setLogs(allLogs)
+      if (logData.logs.length > 0) {
+        // Entries arrive oldest first and only newer than lastSeq, so appending keeps them in order
+        setLogs([...logs(), ...logData.logs])
+        lastSeq = logData.logs[logData.logs.length - 1].seq
       }
 
       setError('')
@@ -60,6 +61,29 @@ function Logs() {
     }
   }
 
+  // Persisted segments come back newest first, one per page, as "seq\ttimestamp\tmessage" lines
+  const loadOlderLogs = async () => {
+    try {
+      const response = await fetch(`/logs?page=${olderPage()}`)
+      if (response.status === 404) {
+        setNoOlderLogs(true)
+        return
+      }
+      if (!response.ok) {
+        throw new Error(`Failed to fetch logs: ${response.status} ${response.statusText}`)
+      }
+      const text = await response.text()
+      const entries: LogEntry[] = text.split('\n').filter(line => line.length > 0).map(line => {
+        const [seq, timestamp, ...message] = line.split('\t')
+        return { seq: Number(seq), timestamp: Number(timestamp), message: message.join('\t') }
+      })
+      setOlderLogs([...entries, ...olderLogs()])
+      setOlderPage(olderPage() + 1)
+    } catch (err: any) {
+      setError(`Error fetching logs: ${err.message || 'Unknown error'}`)
+    }
+  }
+
   const startAutoRefresh = () => {
     if (intervalId) clearInterval(intervalId)
     intervalId = setInterval(fetchLogs, 5000) // Refresh every 5 seconds
@@ -139,9 +163,25 @@ function Logs() {
         </div>
       )}
 
-      <div class="mt-4 text-sm text-base-content/70">
+      <div class="mt-4 text-sm text-base-content/70 flex items-center justify-between">
         <p>Logs are automatically refreshed every 5 seconds.</p>
+        {!noOlderLogs() && (
+          <button class="btn btn-sm btn-soft" onClick={loadOlderLogs}>Load saved logs</button>
+        )}
       </div>
+
+      {olderLogs().length > 0 && (
+        <div class="mt-4">
+          <h3 class="font-bold mb-2">Saved logs</h3>
+          <div class="max-h-160 overflow-y-auto bg-black text-green-400 p-4 rounded font-mono text-sm border border-gray-600">
+            {olderLogs().map((log) => (
+              <div class="whitespace-pre-wrap">
+                <span class="text-green-800">{formatTimestamp(log.timestamp)}:</span> {log.message}
+              </div>
+            ))}
+          </div>
+        </div>
+      )}
     </div>
   )
 }
@@ -1,5 +1,19 @@
 import { createSignal, onMount } from 'solid-js'
 
+// Settings the device keeps for each printer it monitors
+type PrinterSettings = {
+  elegooip: string
+  timeout: number
+  first_layer_timeout: number
+  pause_on_runout: boolean
+  start_print_timeout: number
+  enabled: boolean
+  adaptive_timeout: boolean
+  adaptive_quantile: number
+  adaptive_margin: number
+  mm_per_pulse: number
+}
+
 function Settings() {
   const [ssid, setSsid] = createSignal('')
   const [password, setPassword] = createSignal('')
@@ -13,7 +27,30 @@ function Settings() {
   const [apMode, setApMode] = createSignal<boolean | null>(null);
   const [pauseOnRunout, setPauseOnRunout] = createSignal(true);
   const [enabled, setEnabled] = createSignal(true);
+  const [persistLogs, setPersistLogs] = createSignal(false);
+  const [adaptiveTimeout, setAdaptiveTimeout] = createSignal(false);
+  const [adaptiveQuantile, setAdaptiveQuantile] = createSignal<number | string>(99)
+  const [adaptiveMargin, setAdaptiveMargin] = createSignal<number | string>(500)
+  const [mmPerPulse, setMmPerPulse] = createSignal<number | string>(2.88)
   const [invalidFields, setInvalidFields] = createSignal<string[]>([]);
+  // The fields above edit printers()[printer()]
+  const [printers, setPrinters] = createSignal<PrinterSettings[]>([])
+  const [printer, setPrinter] = createSignal(0)
+
+  const showPrinter = (index: number) => {
+    const settings = printers()[index]
+    setPrinter(index)
+    setElegooip(settings.elegooip || '')
+    setTimeoutValue(settings.timeout || 2000)
+    setFirstLayerTimeout(settings.first_layer_timeout || 4000)
+    setStartPrintTimeout(settings.start_print_timeout || 10000)
+    setPauseOnRunout(settings.pause_on_runout !== undefined ? settings.pause_on_runout : true)
+    setEnabled(settings.enabled !== undefined ? settings.enabled : true)
+    setAdaptiveTimeout(settings.adaptive_timeout ?? false)
+    setAdaptiveQuantile(settings.adaptive_quantile ?? 99)
+    setAdaptiveMargin(settings.adaptive_margin ?? 500)
+    setMmPerPulse(settings.mm_per_pulse ?? 2.88)
+  }
   // Load settings from the server and scan for WiFi networks
   onMount(async () => {
     try {
@@ -29,13 +66,11 @@ function Settings() {
       setSsid(settings.ssid || '')
       // Password won't be loaded from server for security
       setPassword('')
-      setElegooip(settings.elegooip || '')
-      setTimeoutValue(settings.timeout || 2000)
-      setFirstLayerTimeout(settings.first_layer_timeout || 4000)
-      setStartPrintTimeout(settings.start_print_timeout || 10000)
       setApMode(settings.ap_mode || null)
-      setPauseOnRunout(settings.pause_on_runout !== undefined ? settings.pause_on_runout : true)
-      setEnabled(settings.enabled !== undefined ? settings.enabled : true)
+      setPersistLogs(settings.persist_logs ?? false)
+      // Firmware from before multiple printers has the printer settings at the top level
+      setPrinters(settings.printers ?? [settings])
+      showPrinter(0)
 
       setError('')
     } catch (err: any) {
@@ -47,46 +82,104 @@ function Settings() {
   })
 
 
-  const handleSave = async () => {
-    try {
-      setSaveSuccess(false)
-      setError('')
-      setInvalidFields([])
-
-      // Validate all numeric fields are present and in correct range
-      const errors: string[] = []
-      const invalid: string[] = []
-
-      const timeoutVal = timeout()
-      if (timeoutVal === '' || timeoutVal === undefined) {
-        errors.push('Movement Sensor Timeout is required')
-        invalid.push('timeout')
-      } else if (typeof timeoutVal === 'number' && (timeoutVal < 100 || timeoutVal > 30000)) {
-        errors.push(`Movement Sensor Timeout must be between 100 and 30000 ms (current: ${timeoutVal})`)
-        invalid.push('timeout')
-      }
+  // Validates the fields of the printer being edited and stores them in printers(). Returns false
+  // and shows what is wrong when they are not valid.
+  const storePrinter = () => {
+    setError('')
+    setInvalidFields([])
 
-      const firstLayerTimeoutVal = firstLayerTimeout()
-      if (firstLayerTimeoutVal === '' || firstLayerTimeoutVal === undefined) {
-        errors.push('First Layer Timeout is required')
-        invalid.push('firstLayerTimeout')
-      } else if (typeof firstLayerTimeoutVal === 'number' && (firstLayerTimeoutVal < 100 || firstLayerTimeoutVal > 60000)) {
-        errors.push(`First Layer Timeout must be between 100 and 60000 ms (current: ${firstLayerTimeoutVal})`)
-        invalid.push('firstLayerTimeout')
-      }
+    // Validate all numeric fields are present and in correct range
+    const errors: string[] = []
+    const invalid: string[] = []
 
-      const startPrintTimeoutVal = startPrintTimeout()
-      if (startPrintTimeoutVal === '' || startPrintTimeoutVal === undefined) {
-        errors.push('Start Print Timeout is required')
-        invalid.push('startPrintTimeout')
-      } else if (typeof startPrintTimeoutVal === 'number' && (startPrintTimeoutVal < 1000 || startPrintTimeoutVal > 60000)) {
-        errors.push(`Start Print Timeout must be between 1000 and 60000 ms (current: ${startPrintTimeoutVal})`)
-        invalid.push('startPrintTimeout')
-      }
+    const timeoutVal = timeout()
+    if (timeoutVal === '' || timeoutVal === undefined) {
+      errors.push('Movement Sensor Timeout is required')
+      invalid.push('timeout')
+    } else if (typeof timeoutVal === 'number' && (timeoutVal < 100 || timeoutVal > 30000)) {
+      errors.push(`Movement Sensor Timeout must be between 100 and 30000 ms (current: ${timeoutVal})`)
+      invalid.push('timeout')
+    }
+
+    const firstLayerTimeoutVal = firstLayerTimeout()
+    if (firstLayerTimeoutVal === '' || firstLayerTimeoutVal === undefined) {
+      errors.push('First Layer Timeout is required')
+      invalid.push('firstLayerTimeout')
+    } else if (typeof firstLayerTimeoutVal === 'number' && (firstLayerTimeoutVal < 100 || firstLayerTimeoutVal > 60000)) {
+      errors.push(`First Layer Timeout must be between 100 and 60000 ms (current: ${firstLayerTimeoutVal})`)
+      invalid.push('firstLayerTimeout')
+    }
+
+    const startPrintTimeoutVal = startPrintTimeout()
+    if (startPrintTimeoutVal === '' || startPrintTimeoutVal === undefined) {
+      errors.push('Start Print Timeout is required')
+      invalid.push('startPrintTimeout')
+    } else if (typeof startPrintTimeoutVal === 'number' && (startPrintTimeoutVal < 1000 || startPrintTimeoutVal > 60000)) {
+      errors.push(`Start Print Timeout must be between 1000 and 60000 ms (current: ${startPrintTimeoutVal})`)
+      invalid.push('startPrintTimeout')
+    }
+
+    const adaptiveQuantileVal = adaptiveQuantile()
+    if (adaptiveQuantileVal === '' || adaptiveQuantileVal === undefined) {
+      errors.push('Adaptive Timeout Percentile is required')
+      invalid.push('adaptiveQuantile')
+    } else if (typeof adaptiveQuantileVal === 'number' && (adaptiveQuantileVal < 50 || adaptiveQuantileVal > 99.9)) {
+      errors.push(`Adaptive Timeout Percentile must be between 50 and 99.9 (current: ${adaptiveQuantileVal})`)
+      invalid.push('adaptiveQuantile')
+    }
+
+    const adaptiveMarginVal = adaptiveMargin()
+    if (adaptiveMarginVal === '' || adaptiveMarginVal === undefined) {
+      errors.push('Adaptive Timeout Margin is required')
+      invalid.push('adaptiveMargin')
+    } else if (typeof adaptiveMarginVal === 'number' && (adaptiveMarginVal < 0 || adaptiveMarginVal > 30000)) {
+      errors.push(`Adaptive Timeout Margin must be between 0 and 30000 ms (current: ${adaptiveMarginVal})`)
+      invalid.push('adaptiveMargin')
+    }
+
+    const mmPerPulseVal = mmPerPulse()
+    if (mmPerPulseVal === '' || mmPerPulseVal === undefined) {
+      errors.push('Filament Per Pulse is required')
+      invalid.push('mmPerPulse')
+    } else if (typeof mmPerPulseVal === 'number' && (mmPerPulseVal < 0.1 || mmPerPulseVal > 50)) {
+      errors.push(`Filament Per Pulse must be between 0.1 and 50 mm (current: ${mmPerPulseVal})`)
+      invalid.push('mmPerPulse')
+    }
 
-      if (errors.length > 0) {
-        setInvalidFields(invalid)
-        setError(errors.join('\n'))
+    if (errors.length > 0) {
+      setInvalidFields(invalid)
+      setError(errors.join('\n'))
+      return false
+    }
+
+    const updated = [...printers()]
+    updated[printer()] = {
+      elegooip: elegooip(),
+      timeout: typeof timeoutVal === 'string' ? parseInt(timeoutVal) : timeoutVal,
+      first_layer_timeout: typeof firstLayerTimeoutVal === 'string' ? parseInt(firstLayerTimeoutVal) : firstLayerTimeoutVal,
+      pause_on_runout: pauseOnRunout(),
+      start_print_timeout: typeof startPrintTimeoutVal === 'string' ? parseInt(startPrintTimeoutVal) : startPrintTimeoutVal,
+      enabled: enabled(),
+      adaptive_timeout: adaptiveTimeout(),
+      adaptive_quantile: typeof adaptiveQuantileVal === 'string' ? parseFloat(adaptiveQuantileVal) : adaptiveQuantileVal,
+      adaptive_margin: typeof adaptiveMarginVal === 'string' ? parseInt(adaptiveMarginVal) : adaptiveMarginVal,
+      mm_per_pulse: typeof mmPerPulseVal === 'string' ? parseFloat(mmPerPulseVal) : mmPerPulseVal,
+    }
+    setPrinters(updated)
+    return true
+  }
+
+  const selectPrinter = (index: number) => {
+    // Stay on the current printer until its fields are valid, so nothing typed is lost
+    if (storePrinter()) {
+      showPrinter(index)
+    }
+  }
+
+  const handleSave = async () => {
+    try {
+      setSaveSuccess(false)
+      if (!storePrinter()) {
         return
       }
 
@@ -94,12 +187,8 @@ function Settings() {
         ssid: ssid(),
         passwd: password(),
         ap_mode: false,
-        elegooip: elegooip(),
-        timeout: typeof timeoutVal === 'string' ? parseInt(timeoutVal) : timeoutVal,
-        first_layer_timeout: typeof firstLayerTimeoutVal === 'string' ? parseInt(firstLayerTimeoutVal) : firstLayerTimeoutVal,
-        pause_on_runout: pauseOnRunout(),
-        start_print_timeout: typeof startPrintTimeoutVal === 'string' ? parseInt(startPrintTimeoutVal) : startPrintTimeoutVal,
-        enabled: enabled(),
+        persist_logs: persistLogs(),
+        printers: printers(),
       }
 
       let lastError = ''
@@ -128,24 +217,16 @@ function Settings() {
 
           // Validate that settings were actually saved by checking key values
           const mismatch = []
-          if (responseData.settings.timeout !== timeoutVal) {
-            mismatch.push(`timeout (got ${responseData.settings.timeout}, expected ${timeoutVal})`)
-          }
-          if (responseData.settings.first_layer_timeout !== firstLayerTimeoutVal) {
-            mismatch.push(`first_layer_timeout (got ${responseData.settings.first_layer_timeout}, expected ${firstLayerTimeoutVal})`)
-          }
-          if (responseData.settings.pause_on_runout !== pauseOnRunout()) {
-            mismatch.push(`pause_on_runout (got ${responseData.settings.pause_on_runout}, expected ${pauseOnRunout()})`)
-          }
-          if (responseData.settings.start_print_timeout !== startPrintTimeoutVal) {
-            mismatch.push(`start_print_timeout (got ${responseData.settings.start_print_timeout}, expected ${startPrintTimeoutVal})`)
-          }
-          if (responseData.settings.enabled !== enabled()) {
-            mismatch.push(`enabled (got ${responseData.settings.enabled}, expected ${enabled()})`)
-          }
-          if (responseData.settings.elegooip !== elegooip()) {
-            mismatch.push(`elegooip (got ${responseData.settings.elegooip}, expected ${elegooip()})`)
-          }
+          const keys = ['timeout', 'first_layer_timeout', 'pause_on_runout', 'start_print_timeout', 'enabled', 'elegooip'] as const
+          settings.printers.forEach((expected, index) => {
+            const saved = responseData.settings.printers?.[index] ?? {}
+            for (const key of keys) {
+              if (saved[key] !== expected[key]) {
+                const name = settings.printers.length > 1 ? `printer ${index + 1} ${key}` : key
+                mismatch.push(`${name} (got ${saved[key]}, expected ${expected[key]})`)
+              }
+            }
+          })
           if (responseData.settings.ssid !== ssid()) {
             mismatch.push(`ssid (got ${responseData.settings.ssid}, expected ${ssid()})`)
           }
@@ -249,6 +330,25 @@ function Settings() {
 
           <h2 class="text-lg font-bold mb-4 mt-10">Device Settings</h2>
 
+          {printers().length > 1 && (
+            <fieldset class="fieldset">
+              <legend class="fieldset-legend">Printer</legend>
+              <select
+                class="select"
+                value={printer()}
+                onChange={(e) => {
+                  selectPrinter(parseInt(e.target.value))
+                  e.target.value = String(printer())
+                }}
+              >
+                {printers().map((_, i) => (
+                  <option value={i}>Printer {i + 1}</option>
+                ))}
+              </select>
+              <p class="label">The settings below are for this printer, Persistent Logs applies to the device</p>
+            </fieldset>
+          )}
+
 
           <fieldset class="fieldset">
             <legend class="fieldset-legend">Elegoo Centauri Carbon IP Address</legend>
@@ -260,6 +360,7 @@ function Settings() {
               placeholder="xxx.xxx.xxx.xxx"
               class="input"
             />
+            <p class="label">Leave empty to find the printer on the network. It is found again if its address changes.</p>
           </fieldset>
 
 
@@ -293,6 +394,66 @@ function Settings() {
             <p class="label">Timeout in milliseconds for first layer</p>
           </fieldset>
 
+          <fieldset class="fieldset">
+            <legend class="fieldset-legend">Adaptive Timeout</legend>
+            <label class="label cursor-pointer">
+              <input
+                type="checkbox"
+                id="adaptiveTimeout"
+                checked={adaptiveTimeout()}
+                onChange={(e) => setAdaptiveTimeout(e.target.checked)}
+                class="checkbox checkbox-accent"
+              />
+              <span class="label-text">Learn the timeout from the movement sensor during each print, per layer phase and print speed. The timeouts above remain the upper limit.</span>
+
+            </label>
+          </fieldset>
+
+          <fieldset class="fieldset">
+            <legend class="fieldset-legend">Adaptive Timeout Percentile</legend>
+            <input
+              type="number"
+              id="adaptiveQuantile"
+              value={adaptiveQuantile()}
+              onInput={(e) => setAdaptiveQuantile(e.target.value)}
+              min="50"
+              max="99.9"
+              step="0.1"
+              class={`input ${invalidFields().includes('adaptiveQuantile') ? 'input-error' : ''}`}
+            />
+            <p class="label">Percentile of the time between sensor pulses the learned timeout is based on</p>
+          </fieldset>
+
+          <fieldset class="fieldset">
+            <legend class="fieldset-legend">Adaptive Timeout Margin</legend>
+            <input
+              type="number"
+              id="adaptiveMargin"
+              value={adaptiveMargin()}
+              onInput={(e) => setAdaptiveMargin(e.target.value)}
+              min="0"
+              max="30000"
+              step="100"
+              class={`input ${invalidFields().includes('adaptiveMargin') ? 'input-error' : ''}`}
+            />
+            <p class="label">Milliseconds added to that percentile</p>
+          </fieldset>
+
+          <fieldset class="fieldset">
+            <legend class="fieldset-legend">Filament Per Pulse</legend>
+            <input
+              type="number"
+              id="mmPerPulse"
+              value={mmPerPulse()}
+              onInput={(e) => setMmPerPulse(e.target.value)}
+              min="0.1"
+              max="50"
+              step="0.01"
+              class={`input ${invalidFields().includes('mmPerPulse') ? 'input-error' : ''}`}
+            />
+            <p class="label">Millimeters of filament between two changes of the movement sensor signal, used for the feed rate</p>
+          </fieldset>
+
           <fieldset class="fieldset">
             <legend class="fieldset-legend">Start Print Timeout</legend>
             <input
@@ -338,6 +499,21 @@ function Settings() {
             </label>
           </fieldset>
 
+          <fieldset class="fieldset">
+            <legend class="fieldset-legend">Persistent Logs</legend>
+            <label class="label cursor-pointer">
+              <input
+                type="checkbox"
+                id="persistLogs"
+                checked={persistLogs()}
+                onChange={(e) => setPersistLogs(e.target.checked)}
+                class="checkbox checkbox-accent"
+              />
+              <span class="label-text">Keep the last 64 KB of logs on flash so they survive a reboot</span>
+
+            </label>
+          </fieldset>
+
           <button
             class="btn btn-accent btn-soft mt-10"
             onClick={handleSave}
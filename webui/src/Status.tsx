@@ -26,6 +26,9 @@ const PRINT_STATUS_MAP = {
 function Status() {
 
   const [loading, setLoading] = createSignal(false)
+  // Printer shown, the device may monitor several
+  const [printer, setPrinter] = createSignal(0)
+  const [printerCount, setPrinterCount] = createSignal(1)
   const [lastMovementTime, setLastMovementTime] = createSignal<number>(Date.now())
   const [elapsedTime, setElapsedTime] = createSignal<number>(0)
   const [sensorStatus, setSensorStatus] = createSignal<any>({
@@ -43,22 +46,37 @@ function Status() {
       PrintSpeedPct: 0,
       isWebsocketConnected: false,
       currentZ: 0,
+      movementTimeout: 0,
+      feedRate: 0,
+      feedRateCollapsed: false,
       avgTimeBetweenTicks: 0,
       minTickTime: 0,
       maxTickTime: 0,
       tickSampleCount: 0,
+      stdDevTickTime: 0,
+      p50TickTime: 0,
+      p95TickTime: 0,
       startAvgTickTime: 0,
       startMinTickTime: 0,
       startMaxTickTime: 0,
       startTickCount: 0,
+      startStdDevTickTime: 0,
+      startP50TickTime: 0,
+      startP95TickTime: 0,
       firstLayerAvgTickTime: 0,
       firstLayerMinTickTime: 0,
       firstLayerMaxTickTime: 0,
       firstLayerTickCount: 0,
+      firstLayerStdDevTickTime: 0,
+      firstLayerP50TickTime: 0,
+      firstLayerP95TickTime: 0,
       laterLayersAvgTickTime: 0,
       laterLayersMinTickTime: 0,
       laterLayersMaxTickTime: 0,
       laterLayersTickCount: 0,
+      laterLayersStdDevTickTime: 0,
+      laterLayersP50TickTime: 0,
+      laterLayersP95TickTime: 0,
     },
     settings: {
       timeout: 0,
@@ -67,39 +85,75 @@ function Status() {
     }
   })
 
-  const refreshSensorStatus = async () => {
-    try {
-      const response = await fetch('/sensor_status')
-      if (!response.ok) throw new Error('Failed to fetch')
-      const data = await response.json()
-
-      // Track movement state for elapsed time timer - only when actively printing
-      const isPrinting = data.elegoo?.isPrinting && data.elegoo?.printStatus === 13
-      const wasMoving = !sensorStatus().stopped
-      const isMoving = !data.stopped
+  const applySensorStatus = (data: any) => {
+    // Track movement state for elapsed time timer - only when actively printing
+    const isPrinting = data.elegoo?.isPrinting && data.elegoo?.printStatus === 13
+    const wasMoving = !sensorStatus().stopped
+    const isMoving = !data.stopped
 
-      if (isPrinting) {
-        if (wasMoving && !isMoving) {
-          // Movement just stopped during active printing - start the timer
-          setLastMovementTime(Date.now())
-        } else if (!wasMoving && isMoving) {
-          // Movement resumed during active printing - reset timer
-          setLastMovementTime(Date.now())
-          setElapsedTime(0)
-        }
-      } else {
-        // Not actively printing - ensure timer is reset
+    if (isPrinting) {
+      if (wasMoving && !isMoving) {
+        // Movement just stopped during active printing - start the timer
+        setLastMovementTime(Date.now())
+      } else if (!wasMoving && isMoving) {
+        // Movement resumed during active printing - reset timer
+        setLastMovementTime(Date.now())
         setElapsedTime(0)
       }
+    } else {
+      // Not actively printing - ensure timer is reset
+      setElapsedTime(0)
+    }
 
-      setSensorStatus(data)
-      setLoading(false)
+    setSensorStatus(data)
+    setLoading(false)
+  }
+
+  const refreshSensorStatus = async () => {
+    try {
+      const response = await fetch(`/sensor_status?printer=${printer()}`)
+      if (!response.ok) throw new Error('Failed to fetch')
+      const data = await response.json()
+      setPrinterCount(data.printerCount ?? 1)
+      applySensorStatus(data)
     } catch (error) {
       console.error('Sensor status error:', error)
       setLoading(false)
     }
   }
 
+  // /events sends a full snapshot per printer on connect, then updates holding only the changed
+  // fields. The latest status of every printer is kept so switching between them is instant.
+  const printerStatuses: Record<number, any> = {}
+  const mergeSensorStatus = (current: any, update: any) => ({
+    ...current,
+    ...update,
+    elegoo: { ...current?.elegoo, ...update.elegoo },
+    settings: { ...current?.settings, ...update.settings },
+  })
+  const receiveSensorStatus = (data: any, snapshot: boolean) => {
+    const index = data.printer ?? 0
+    if (data.printerCount) {
+      setPrinterCount(data.printerCount)
+    }
+    printerStatuses[index] = snapshot ? data : mergeSensorStatus(printerStatuses[index], data)
+    if (index === printer()) {
+      applySensorStatus(printerStatuses[index])
+    }
+  }
+
+  const selectPrinter = (index: number) => {
+    setPrinter(index)
+    setLastMovementTime(Date.now())
+    setElapsedTime(0)
+    if (printerStatuses[index]) {
+      applySensorStatus(printerStatuses[index])
+    } else {
+      setLoading(true)
+      refreshSensorStatus()
+    }
+  }
+
   // Get the active timeout value
   // Only treat as "first layer" if the printer is actively printing and the
   // currentLayer or currentZ indicate the first layer. If not printing, fall
@@ -114,7 +168,11 @@ function Status() {
 
     // Only treat as first layer when printer is printing and layer is 1 or below
     const isFirstLayer = isPrinting && (typeof layer === 'number' && layer <= 1)
-    const activeTimeout = isFirstLayer ? firstLayerTimeout : timeout
+    // While printing the device reports the timeout it uses, which may have been learned
+    const deviceTimeout = status.elegoo?.movementTimeout
+    const activeTimeout = isPrinting && deviceTimeout > 0
+      ? deviceTimeout
+      : (isFirstLayer ? firstLayerTimeout : timeout)
 
     console.log('getActiveTimeout:', {
       isPrinting,
@@ -144,16 +202,42 @@ function Status() {
 
   onMount(async () => {
     setLoading(true)
-    refreshSensorStatus()
 
-    // Refresh sensor status every 2.5 seconds
-    const statusIntervalId = setInterval(refreshSensorStatus, 2500)
+    // Poll every 2.5 seconds while the event stream is unavailable
+    let statusIntervalId: number | null = null
+    const startPolling = () => {
+      if (statusIntervalId === null) {
+        refreshSensorStatus()
+        statusIntervalId = setInterval(refreshSensorStatus, 2500)
+      }
+    }
+    const stopPolling = () => {
+      if (statusIntervalId !== null) {
+        clearInterval(statusIntervalId)
+        statusIntervalId = null
+      }
+    }
+
+    let events: EventSource | null = null
+    if (typeof EventSource !== 'undefined') {
+      // EventSource reconnects on its own; poll in the meantime
+      events = new EventSource('/events')
+      events.addEventListener('snapshot', (e) => {
+        stopPolling()
+        receiveSensorStatus(JSON.parse((e as MessageEvent).data), true)
+      })
+      events.addEventListener('update', (e) => receiveSensorStatus(JSON.parse((e as MessageEvent).data), false))
+      events.onerror = startPolling
+    } else {
+      startPolling()
+    }
 
     // Update elapsed time every 100ms for smooth display
     const timerIntervalId = setInterval(updateElapsedTime, 100)
 
     onCleanup(() => {
-      clearInterval(statusIntervalId)
+      events?.close()
+      stopPolling()
       clearInterval(timerIntervalId)
     })
   })
@@ -164,6 +248,17 @@ function Status() {
           <div class="flex items-center gap-2 mb-2">
             <h2 class="text-xl font-semibold">Status</h2>
             {loading() && <span class="loading loading-spinner loading-sm"></span>}
+            {printerCount() > 1 && (
+              <select
+                class="select select-sm w-auto ml-auto"
+                value={printer()}
+                onChange={(e) => selectPrinter(parseInt(e.target.value))}
+              >
+                {Array.from({ length: printerCount() }, (_, i) => (
+                  <option value={i}>Printer {i + 1}</option>
+                ))}
+              </select>
+            )}
           </div>
           <div class="stats w-full shadow bg-base-200">
             {sensorStatus().elegoo.isWebsocketConnected && <>
@@ -259,6 +354,13 @@ function Status() {
                     {Math.round(elapsedTime())} / {getActiveTimeout()} ms
                   </p>
                 </div>
+                <div>
+                  <h3 class="font-bold">Feed Rate</h3>
+                  <p class={`font-mono ${sensorStatus().elegoo.feedRateCollapsed ? 'text-error font-bold' : ''}`}>
+                    {(sensorStatus().elegoo.feedRate ?? 0).toFixed(2)} mm/s
+                    {sensorStatus().elegoo.feedRateCollapsed ? ' (collapsed)' : ''}
+                  </p>
+                </div>
               </div>
             </div>
           </div>
@@ -293,6 +395,22 @@ function Status() {
                           : 'N/A'}
                       </p>
                     </div>
+                    <div>
+                      <h3 class="font-bold">Std Dev</h3>
+                      <p class="font-mono text-lg">
+                        {sensorStatus().elegoo.tickSampleCount > 0
+                          ? `${(sensorStatus().elegoo.stdDevTickTime / 1000).toFixed(2)}s`
+                          : 'N/A'}
+                      </p>
+                    </div>
+                    <div>
+                      <h3 class="font-bold">p50 / p95</h3>
+                      <p class="font-mono text-lg">
+                        {sensorStatus().elegoo.tickSampleCount > 0
+                          ? `${(sensorStatus().elegoo.p50TickTime / 1000).toFixed(2)}s / ${(sensorStatus().elegoo.p95TickTime / 1000).toFixed(2)}s`
+                          : 'N/A'}
+                      </p>
+                    </div>
                   </div>
                 </div>
 
@@ -319,6 +437,18 @@ function Status() {
                           {(sensorStatus().elegoo.startMinTickTime / 1000).toFixed(2)}s / {(sensorStatus().elegoo.startMaxTickTime / 1000).toFixed(2)}s
                         </p>
                       </div>
+                      <div>
+                        <h3 class="font-bold">Std Dev</h3>
+                        <p class="font-mono text-lg">
+                          {(sensorStatus().elegoo.startStdDevTickTime / 1000).toFixed(2)}s
+                        </p>
+                      </div>
+                      <div>
+                        <h3 class="font-bold">p50 / p95</h3>
+                        <p class="font-mono text-lg">
+                          {(sensorStatus().elegoo.startP50TickTime / 1000).toFixed(2)}s / {(sensorStatus().elegoo.startP95TickTime / 1000).toFixed(2)}s
+                        </p>
+                      </div>
                     </div>
                   )}
                 </div>
@@ -346,6 +476,18 @@ function Status() {
                           {(sensorStatus().elegoo.firstLayerMinTickTime / 1000).toFixed(2)}s / {(sensorStatus().elegoo.firstLayerMaxTickTime / 1000).toFixed(2)}s
                         </p>
                       </div>
+                      <div>
+                        <h3 class="font-bold">Std Dev</h3>
+                        <p class="font-mono text-lg">
+                          {(sensorStatus().elegoo.firstLayerStdDevTickTime / 1000).toFixed(2)}s
+                        </p>
+                      </div>
+                      <div>
+                        <h3 class="font-bold">p50 / p95</h3>
+                        <p class="font-mono text-lg">
+                          {(sensorStatus().elegoo.firstLayerP50TickTime / 1000).toFixed(2)}s / {(sensorStatus().elegoo.firstLayerP95TickTime / 1000).toFixed(2)}s
+                        </p>
+                      </div>
                     </div>
                   )}
                 </div>
@@ -373,6 +515,18 @@ function Status() {
                           {(sensorStatus().elegoo.laterLayersMinTickTime / 1000).toFixed(2)}s / {(sensorStatus().elegoo.laterLayersMaxTickTime / 1000).toFixed(2)}s
                         </p>
                       </div>
+                      <div>
+                        <h3 class="font-bold">Std Dev</h3>
+                        <p class="font-mono text-lg">
+                          {(sensorStatus().elegoo.laterLayersStdDevTickTime / 1000).toFixed(2)}s
+                        </p>
+                      </div>
+                      <div>
+                        <h3 class="font-bold">p50 / p95</h3>
+                        <p class="font-mono text-lg">
+                          {(sensorStatus().elegoo.laterLayersP50TickTime / 1000).toFixed(2)}s / {(sensorStatus().elegoo.laterLayersP95TickTime / 1000).toFixed(2)}s
+                        </p>
+                      </div>
                     </div>
                   )}
                 </div>
@@ -383,7 +537,7 @@ function Status() {
                     class="btn btn-sm btn-accent"
                     onClick={async () => {
                       try {
-                        await fetch('/reset_stats', { method: 'POST' })
+                        await fetch(`/reset_stats?printer=${printer()}`, { method: 'POST' })
                         // Refresh to show cleared stats
                         await refreshSensorStatus()
                       } catch (e) {